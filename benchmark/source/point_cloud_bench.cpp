@@ -0,0 +1,427 @@
+#include "ColorMap.h"
+#include "NormalEstimation.h"
+#include "OutlierRemoval.h"
+#include "PointCloud.h"
+#include "SpatialIndex.h"
+#include "SyntheticCloud.h"
+#include "VoxelGrid.h"
+#include <benchmark/benchmark.h>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+namespace fs = std::filesystem;
+
+// Clouds are identified by their point count. The bunny has 100k points; the
+// synthetic sizes are 10M and 100M. 100M clouds are only used when
+// POINT_CLOUD_BENCH_LARGE is set, since they take several GB and minutes to prepare.
+
+static const std::string bunny_points  = std::string(POINT_CLOUD_TEST_DATA_DIR) + "/bunny100k.xyz";
+static const std::string bunny_normals = std::string(POINT_CLOUD_TEST_DATA_DIR) + "/bunny100k.normals";
+
+static bool large_enabled() {
+  return std::getenv("POINT_CLOUD_BENCH_LARGE") != nullptr;
+}
+
+static SyntheticCloudOptions synthetic_options(size_t count) {
+  SyntheticCloudOptions options;
+  options.count   = count;
+  options.seed    = 42;
+  options.extent  = 2.0f;
+  options.normals = true;
+  options.colors  = true;
+  return options;
+}
+
+/** uniform points in a 2x2x2 cube with random unit normals, the same for every run */
+static const PointCloud& synthetic_cloud(size_t count) {
+  static std::map<size_t, PointCloud> cache;
+  auto                                it = cache.find(count);
+  if (it != cache.end())
+    return it->second;
+  return cache[count] = generate_synthetic_cloud(synthetic_options(count));
+}
+
+/** whether the file at `path` holds exactly `count` lines, one per point */
+static bool holds_points(const fs::path& path, size_t count) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  std::vector<char> buffer(1 << 20);
+  size_t            lines = 0;
+  while (file.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || file.gcount() > 0)
+    lines += static_cast<size_t>(std::count(buffer.begin(), buffer.begin() + file.gcount(), '\n'));
+  return lines == count;
+}
+
+/**
+ * @brief write the synthetic `kind` (xyz, normals or colors) of `count` points as a plain text file once, returning its path
+ * @details The file name holds the generator version and every option, so files from an older generator or other options are not reused.
+ * A cached file is checked once per run to hold `count` lines, and written again if it does not.
+ */
+static std::string synthetic_file(size_t count, const char* kind) {
+  fs::path dir = fs::temp_directory_path() / "point_cloud_viewer_bench";
+  fs::create_directories(dir);
+  const SyntheticCloudOptions options = synthetic_options(count);
+  const std::string           stem    = fmt::format("v{}_{}_{}_{}_{}_{}{}{}", SYNTHETIC_CLOUD_VERSION, options.count, static_cast<int>(options.distribution),
+                                                     options.seed, options.extent, options.clusters, options.normals ? "n" : "", options.colors ? "c" : "");
+  fs::path                     path = dir / (stem + "." + kind);
+  static std::set<std::string> checked;
+  if (checked.insert(path.string()).second && !holds_points(path, count)) {
+    if (fs::exists(path))
+      spdlog::warn("Rewriting incomplete synthetic cloud {}", path.string());
+    write_synthetic_cloud(options, path.string());
+  }
+  return path.string();
+}
+
+static std::string input_file(size_t count, const char* kind) {
+  if (count == 100000 && std::string(kind) == "xyz")
+    return bunny_points;
+  if (count == 100000 && std::string(kind) == "normals")
+    return bunny_normals;
+  return synthetic_file(count, kind);
+}
+
+static void set_processed(benchmark::State& state, size_t count) {
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+  state.counters["points"] = static_cast<double>(count);
+}
+
+// ---------------------------------- loaders ----------------------------------
+
+static void BM_LoadPoints(benchmark::State& state) {
+  const auto  count    = static_cast<size_t>(state.range(0));
+  std::string filename = input_file(count, "xyz");
+  for (auto _ : state) {
+    PointCloud cloud;
+    cloud.load_points(filename);
+    benchmark::DoNotOptimize(cloud.points.data());
+  }
+  set_processed(state, count);
+}
+
+static void BM_LoadNormals(benchmark::State& state) {
+  const auto  count    = static_cast<size_t>(state.range(0));
+  std::string filename = input_file(count, "normals");
+  for (auto _ : state) {
+    PointCloud cloud;
+    cloud.load_normals(filename);
+    benchmark::DoNotOptimize(cloud.normals.data());
+  }
+  set_processed(state, count);
+}
+
+static void BM_LoadColors(benchmark::State& state) {
+  const auto  count    = static_cast<size_t>(state.range(0));
+  std::string filename = input_file(count, "colors");
+  for (auto _ : state) {
+    PointCloud cloud;
+    cloud.load_colors(filename);
+    benchmark::DoNotOptimize(cloud.colors.data());
+  }
+  set_processed(state, count);
+}
+
+// --------------------------------- transforms ---------------------------------
+
+static const PointCloud& cloud_for(size_t count) {
+  static PointCloud bunny;
+  if (count != 100000)
+    return synthetic_cloud(count);
+  if (bunny.points.empty())
+    bunny.load_points(bunny_points).load_normals(bunny_normals);
+  return bunny;
+}
+
+static void BM_UpdateBBox(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  PointCloud cloud;
+  cloud.points = cloud_for(count).points;
+  for (auto _ : state) {
+    cloud.update_bbox();
+    benchmark::DoNotOptimize(cloud.get_bbox_min());
+  }
+  set_processed(state, count);
+}
+
+static void BM_TransformedBounds(benchmark::State& state) {
+  const auto  count = static_cast<size_t>(state.range(0));
+  const auto& cloud = cloud_for(count);
+  glm::mat4   model(1.0f);
+  float       angle = 0.0f;
+  for (auto _ : state) {
+    // a rotation about z, different every iteration
+    angle += 0.1f;
+    model[0][0] = std::cos(angle);
+    model[0][1] = std::sin(angle);
+    model[1][0] = -std::sin(angle);
+    model[1][1] = std::cos(angle);
+    benchmark::DoNotOptimize(cloud.get_transformed_bounds(model));
+  }
+  set_processed(state, count);
+}
+
+static void BM_ColorsFromNormals(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  PointCloud cloud;
+  cloud.normals = cloud_for(count).normals;
+  for (auto _ : state) {
+    cloud.set_colors_from_normals();
+    benchmark::DoNotOptimize(cloud.colors.data());
+  }
+  set_processed(state, count);
+}
+
+// the CPU fallback of the point shader, used by the compute and software renderers
+static void BM_ShadeHeight(benchmark::State& state) {
+  const auto&     cloud = cloud_for(static_cast<size_t>(state.range(0)));
+  ShadingSettings settings;
+  settings.mode     = Shading::Height;
+  settings.range[0] = cloud.get_bbox_min().z;
+  settings.range[1] = cloud.get_bbox_max().z;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(shade_points(cloud, glm::mat4(1.0f), settings).data());
+  set_processed(state, cloud.points.size());
+}
+
+// -------------------------------- spatial index --------------------------------
+
+static void BM_BuildIndex(benchmark::State& state) {
+  const auto  count  = static_cast<size_t>(state.range(0));
+  const auto& points = cloud_for(count).points;
+  for (auto _ : state) {
+    SpatialIndex index(points);
+    benchmark::DoNotOptimize(index.get_nodes().data());
+  }
+  set_processed(state, count);
+}
+
+static void BM_EstimateNormals(benchmark::State& state) {
+  const auto   count  = static_cast<size_t>(state.range(0));
+  const auto&  points = cloud_for(count).points;
+  SpatialIndex index(points);
+  for (auto _ : state) {
+    auto normals = estimate_normals(points, index, 16);
+    benchmark::DoNotOptimize(normals.data());
+  }
+  set_processed(state, count);
+}
+
+// ---------------------------------- queries ----------------------------------
+// Each query runs against the cloud's kd-tree and against a scan of every point, around points
+// picked across the cloud. Boxes are 5% of the cloud on each side, spheres hold about 64 points.
+
+static float radius_holding(const PointCloud& cloud, float points) {
+  const glm::vec3 extent = cloud.get_bbox_max() - cloud.get_bbox_min();
+  return std::cbrt(points * extent.x * extent.y * extent.z / static_cast<float>(cloud.points.size()) * 3.0f / (4.0f * 3.14159265f));
+}
+
+static void BM_QueryBox(benchmark::State& state) {
+  const auto      count = static_cast<size_t>(state.range(0));
+  const auto&     cloud = cloud_for(count);
+  const bool      brute = state.range(1) != 0;
+  const glm::vec3 half  = (cloud.get_bbox_max() - cloud.get_bbox_min()) * 0.025f;
+  cloud.get_index();
+  size_t i = 0, found = 0;
+  for (auto _ : state) {
+    const glm::vec3 min = cloud.points[i] - half, max = cloud.points[i] + half;
+    if (brute) {
+      found = 0;
+      for (const auto& p : cloud.points)
+        found += p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x && p.y <= max.y && p.z <= max.z;
+    } else {
+      found = cloud.query_box(min, max).size();
+    }
+    benchmark::DoNotOptimize(found);
+    i = (i + 7919) % count;
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+static void BM_QueryRadius(benchmark::State& state) {
+  const auto  count  = static_cast<size_t>(state.range(0));
+  const auto& cloud  = cloud_for(count);
+  const bool  brute  = state.range(1) != 0;
+  const float radius = radius_holding(cloud, 64.0f);
+  cloud.get_index();
+  size_t i = 0, found = 0;
+  for (auto _ : state) {
+    const glm::vec3 center = cloud.points[i];
+    if (brute) {
+      found = 0;
+      for (const auto& p : cloud.points)
+        found += glm::dot(p - center, p - center) <= radius * radius;
+    } else {
+      found = cloud.query_radius(center, radius).size();
+    }
+    benchmark::DoNotOptimize(found);
+    i = (i + 7919) % count;
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+static void BM_QueryKnn(benchmark::State& state) {
+  const auto                           count = static_cast<size_t>(state.range(0));
+  const auto&                          cloud = cloud_for(count);
+  const bool                           brute = state.range(1) != 0;
+  std::vector<SpatialIndex::Neighbour> all;
+  cloud.get_index();
+  size_t i = 0;
+  for (auto _ : state) {
+    const glm::vec3 query = cloud.points[i];
+    if (brute) {
+      all.resize(count);
+      for (size_t j = 0; j < count; j++)
+        all[j] = { glm::dot(cloud.points[j] - query, cloud.points[j] - query), static_cast<uint32_t>(j) };
+      std::partial_sort(all.begin(), all.begin() + 16, all.end(), [](const auto& a, const auto& b) { return a.distance2 < b.distance2; });
+      benchmark::DoNotOptimize(all.data());
+    } else {
+      auto neighbours = cloud.query_knn(query, 16);
+      benchmark::DoNotOptimize(neighbours.data());
+    }
+    i = (i + 7919) % count;
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+static void BM_QueryRay(benchmark::State& state) {
+  const auto      count  = static_cast<size_t>(state.range(0));
+  const auto&     cloud  = cloud_for(count);
+  const bool      brute  = state.range(1) != 0;
+  const float     radius = radius_holding(cloud, 4.0f);
+  const glm::vec3 center = (cloud.get_bbox_min() + cloud.get_bbox_max()) * 0.5f;
+  cloud.get_index();
+  size_t i = 0, found = 0;
+  for (auto _ : state) {
+    // from outside the cloud through one of its points, like a pick ray
+    const glm::vec3 direction = glm::normalize(cloud.points[i] - center + glm::vec3(1e-3f));
+    const glm::vec3 origin    = cloud.points[i] - direction * glm::length(cloud.get_bbox_max() - cloud.get_bbox_min());
+    if (brute) {
+      found = 0;
+      for (const auto& p : cloud.points) {
+        const float     t = std::max(glm::dot(p - origin, direction), 0.0f);
+        const glm::vec3 r = p - (origin + t * direction);
+        found += glm::dot(r, r) <= radius * radius;
+      }
+    } else {
+      found = cloud.query_ray(origin, direction, radius).size();
+    }
+    benchmark::DoNotOptimize(found);
+    i = (i + 7919) % count;
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+/** the same radius queries from several threads at once, on one shared index */
+static void BM_QueryRadiusConcurrent(benchmark::State& state) {
+  const auto  count  = static_cast<size_t>(state.range(0));
+  const auto& cloud  = cloud_for(count);
+  const float radius = radius_holding(cloud, 64.0f);
+  size_t      i      = static_cast<size_t>(state.thread_index()) * 104729 % count, found = 0;
+  for (auto _ : state) {
+    found = cloud.query_radius(cloud.points[i], radius).size();
+    benchmark::DoNotOptimize(found);
+    i = (i + 7919) % count;
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// ---------------------------------- filters ----------------------------------
+
+static void BM_VoxelGrid(benchmark::State& state) {
+  const auto  count = static_cast<size_t>(state.range(0));
+  const auto& cloud = cloud_for(count);
+  // about 8 points per voxel for the uniform synthetic clouds
+  const float leaf_size = glm::length(cloud.get_bbox_max() - cloud.get_bbox_min()) / std::cbrt(static_cast<float>(count) / 8.0f) / 1.7f;
+  for (auto _ : state) {
+    PointCloud filtered = voxel_grid_filter(cloud, leaf_size);
+    benchmark::DoNotOptimize(filtered.points.data());
+  }
+  set_processed(state, count);
+}
+
+static void BM_StatisticalOutliers(benchmark::State& state) {
+  const auto   count  = static_cast<size_t>(state.range(0));
+  const auto&  points = cloud_for(count).points;
+  SpatialIndex index(points);
+  for (auto _ : state) {
+    auto keep = statistical_outlier_mask(points, index, 16, 2.0f);
+    benchmark::DoNotOptimize(keep.data());
+  }
+  set_processed(state, count);
+}
+
+static void BM_RadiusOutliers(benchmark::State& state) {
+  const auto   count  = static_cast<size_t>(state.range(0));
+  const auto&  cloud  = cloud_for(count);
+  SpatialIndex index(cloud.points);
+  // a radius holding about 16 points for the uniform synthetic clouds
+  const glm::vec3 extent = cloud.get_bbox_max() - cloud.get_bbox_min();
+  const float     radius = std::cbrt(16.0f * extent.x * extent.y * extent.z / static_cast<float>(count) * 3.0f / (4.0f * 3.14159265f));
+  for (auto _ : state) {
+    auto keep = radius_outlier_mask(cloud.points, index, radius, 4);
+    benchmark::DoNotOptimize(keep.data());
+  }
+  set_processed(state, count);
+}
+
+// ------------------------------------------------------------------------------
+
+static void file_sizes(benchmark::internal::Benchmark* b) {
+  b->Arg(100000)->Arg(10000000);
+  if (large_enabled())
+    b->Arg(100000000);
+  b->Unit(benchmark::kMillisecond);
+}
+
+static void memory_sizes(benchmark::internal::Benchmark* b) {
+  b->Arg(100000)->Arg(10000000);
+  if (large_enabled())
+    b->Arg(100000000);
+  b->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+/** every cloud size, indexed (second argument 0) and brute force (1) */
+static void query_sizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "points", "brute" });
+  for (int64_t count : { int64_t(100000), int64_t(10000000), int64_t(100000000) })
+    if (count < 100000000 || large_enabled())
+      b->Args({ count, 0 })->Args({ count, 1 });
+  b->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK(BM_LoadPoints)->Apply(file_sizes);
+BENCHMARK(BM_LoadNormals)->Apply(file_sizes);
+BENCHMARK(BM_LoadColors)->Apply(file_sizes);
+BENCHMARK(BM_UpdateBBox)->Apply(memory_sizes);
+BENCHMARK(BM_TransformedBounds)->Apply(memory_sizes);
+BENCHMARK(BM_ColorsFromNormals)->Apply(memory_sizes);
+BENCHMARK(BM_ShadeHeight)->Apply(memory_sizes);
+BENCHMARK(BM_BuildIndex)->Apply(memory_sizes);
+BENCHMARK(BM_QueryBox)->Apply(query_sizes);
+BENCHMARK(BM_QueryRadius)->Apply(query_sizes);
+BENCHMARK(BM_QueryKnn)->Apply(query_sizes);
+BENCHMARK(BM_QueryRay)->Apply(query_sizes);
+BENCHMARK(BM_QueryRadiusConcurrent)->Arg(100000)->Arg(10000000)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_EstimateNormals)->Apply(memory_sizes);
+BENCHMARK(BM_VoxelGrid)->Apply(memory_sizes);
+BENCHMARK(BM_StatisticalOutliers)->Apply(memory_sizes);
+BENCHMARK(BM_RadiusOutliers)->Apply(memory_sizes);
+
+int main(int argc, char** argv) {
+  spdlog::set_level(spdlog::level::level_enum::warn);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,6 @@
+include(CMakeFindDependencyMacro)
+find_dependency(glm)
+find_dependency(spdlog)
+find_dependency(Threads)
+
+include("${CMAKE_CURRENT_LIST_DIR}/point_cloud_viewerTargets.cmake")
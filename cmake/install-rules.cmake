@@ -1,8 +1,88 @@
+if(PROJECT_IS_TOP_LEVEL)
+  set(
+      CMAKE_INSTALL_INCLUDEDIR "include/point_cloud_viewer-${PROJECT_VERSION}"
+      CACHE PATH ""
+  )
+endif()
+
+include(CMakePackageConfigHelpers)
+include(GNUInstallDirs)
+
+# find_package(<package>) call for consumers to find this project
+set(package point_cloud_viewer)
+
 install(
-    TARGETS point_cloud_viewer_exe
+    TARGETS point_cloud_viewer_exe point_cloud_generator_exe
     RUNTIME COMPONENT point_cloud_viewer_Runtime
 )
 
+# the headers of point_cloud_core, which include each other by file name
+install(
+    FILES
+    source/Bounds.h
+    source/ColorMap.h
+    source/FileWatcher.h
+    source/NormalEstimation.h
+    source/OutlierRemoval.h
+    source/Parallel.h
+    source/PlyReader.h
+    source/PointAttributes.h
+    source/PointCloud.h
+    source/Profiler.h
+    source/SpatialIndex.h
+    source/SyntheticCloud.h
+    source/TileSet.h
+    source/VoxelGrid.h
+    DESTINATION "${CMAKE_INSTALL_INCLUDEDIR}"
+    COMPONENT point_cloud_viewer_Development
+)
+
+install(
+    TARGETS point_cloud_core
+    EXPORT point_cloud_viewerTargets
+    RUNTIME #
+    COMPONENT point_cloud_viewer_Runtime
+    LIBRARY #
+    COMPONENT point_cloud_viewer_Runtime
+    NAMELINK_COMPONENT point_cloud_viewer_Development
+    ARCHIVE #
+    COMPONENT point_cloud_viewer_Development
+    INCLUDES #
+    DESTINATION "${CMAKE_INSTALL_INCLUDEDIR}"
+)
+
+write_basic_package_version_file(
+    "${package}ConfigVersion.cmake"
+    COMPATIBILITY SameMajorVersion
+)
+
+# Allow package maintainers to freely override the path for the configs
+set(
+    point_cloud_viewer_INSTALL_CMAKEDIR "${CMAKE_INSTALL_LIBDIR}/cmake/${package}"
+    CACHE PATH "CMake package config location relative to the install prefix"
+)
+mark_as_advanced(point_cloud_viewer_INSTALL_CMAKEDIR)
+
+install(
+    FILES cmake/install-config.cmake
+    DESTINATION "${point_cloud_viewer_INSTALL_CMAKEDIR}"
+    RENAME "${package}Config.cmake"
+    COMPONENT point_cloud_viewer_Development
+)
+
+install(
+    FILES "${PROJECT_BINARY_DIR}/${package}ConfigVersion.cmake"
+    DESTINATION "${point_cloud_viewer_INSTALL_CMAKEDIR}"
+    COMPONENT point_cloud_viewer_Development
+)
+
+install(
+    EXPORT point_cloud_viewerTargets
+    NAMESPACE point_cloud_viewer::
+    DESTINATION "${point_cloud_viewer_INSTALL_CMAKEDIR}"
+    COMPONENT point_cloud_viewer_Development
+)
+
 if(PROJECT_IS_TOP_LEVEL)
   include(CPack)
 endif()
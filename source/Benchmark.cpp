@@ -0,0 +1,119 @@
+#include "Benchmark.h"
+#include "Profiler.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+CameraPath::CameraPath(std::vector<CameraKeyframe> keyframes_)
+    : keyframes { std::move(keyframes_) } {
+  std::stable_sort(keyframes.begin(), keyframes.end(), [](const auto& a, const auto& b) { return a.time < b.time; });
+}
+
+CameraPath CameraPath::load(const std::string& filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    spdlog::critical("Could not open camera path file {}", filename);
+    throw std::runtime_error("failed to load camera path.");
+  }
+
+  std::vector<CameraKeyframe> keyframes;
+  std::string                 line;
+  while (std::getline(file, line)) {
+    auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#')
+      continue;
+    std::istringstream stream(line);
+    CameraKeyframe     keyframe {};
+    if (!(stream >> keyframe.time >> keyframe.theta >> keyframe.phi >> keyframe.distance)) {
+      spdlog::critical("Invalid camera keyframe \"{}\" in {}, expected: time theta phi distance", line, filename);
+      throw std::runtime_error("failed to load camera path.");
+    }
+    keyframes.push_back(keyframe);
+  }
+  if (keyframes.empty()) {
+    spdlog::critical("Camera path file {} has no keyframes", filename);
+    throw std::runtime_error("failed to load camera path.");
+  }
+  spdlog::debug("Loaded {} camera keyframes from {}", keyframes.size(), filename);
+  return CameraPath(std::move(keyframes));
+}
+
+CameraPath CameraPath::orbit() {
+  const float phi = static_cast<float>(M_PI) / 3.0f;
+  return CameraPath({
+      { 0.00f, 0.0f, phi, -1.0f },
+      { 0.25f, static_cast<float>(M_PI_2), phi, -1.0f },
+      { 0.50f, static_cast<float>(M_PI), phi, -1.0f },
+      { 0.75f, static_cast<float>(M_PI + M_PI_2), phi, -1.0f },
+      { 1.00f, static_cast<float>(2.0 * M_PI), phi, -1.0f },
+  });
+}
+
+Camera CameraPath::sample(float t, Camera camera, float default_distance) const {
+  if (keyframes.empty())
+    return camera;
+
+  auto distance_of = [&](const CameraKeyframe& k) { return k.distance > 0 ? k.distance : default_distance; };
+
+  const float time = keyframes.front().time + std::clamp(t, 0.0f, 1.0f) * (keyframes.back().time - keyframes.front().time);
+  auto        next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float value, const auto& k) { return value < k.time; });
+  if (next == keyframes.begin() || next == keyframes.end()) {
+    const auto& k   = next == keyframes.end() ? keyframes.back() : keyframes.front();
+    camera.theta    = k.theta;
+    camera.phi      = k.phi;
+    camera.distance = distance_of(k);
+    return camera;
+  }
+
+  const auto& a    = *(next - 1);
+  const auto& b    = *next;
+  const float span = b.time - a.time;
+  const float s    = span > 0 ? (time - a.time) / span : 1.0f;
+  camera.theta     = a.theta + s * (b.theta - a.theta);
+  camera.phi       = a.phi + s * (b.phi - a.phi);
+  camera.distance  = distance_of(a) + s * (distance_of(b) - distance_of(a));
+  return camera;
+}
+
+bool BenchmarkReport::write_json(const std::string& filename) const {
+  std::ofstream file;
+  if (filename != "-") {
+    file.open(filename);
+    if (!file.is_open()) {
+      spdlog::error("Could not write benchmark report to file {}", filename);
+      return false;
+    }
+  }
+  std::ostream& out = filename == "-" ? std::cout : file;
+
+  std::vector<double> sorted = frame_ms;
+  std::sort(sorted.begin(), sorted.end());
+  auto percentile = [&](double p) {
+    return sorted.empty() ? 0.0 : sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5)];
+  };
+  const double mean = sorted.empty() ? 0.0 : std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size());
+
+  out << std::fixed << std::setprecision(3);
+  out << "{\n  \"renderer\": ";
+  write_json_string(out, renderer);
+  out << ",\n  \"gl_renderer\": ";
+  write_json_string(out, gl_renderer);
+  out << ",\n  \"points\": " << points;
+  out << ",\n  \"width\": " << width << ",\n  \"height\": " << height;
+  out << ",\n  \"frames\": " << sorted.size();
+  out << ",\n  \"frame_ms\": {";
+  out << "\"mean\": " << mean << ", \"min\": " << percentile(0.0) << ", \"p50\": " << percentile(0.50)
+      << ", \"p90\": " << percentile(0.90) << ", \"p95\": " << percentile(0.95) << ", \"p99\": " << percentile(0.99)
+      << ", \"max\": " << percentile(1.0) << "}";
+  out << ",\n  \"points_per_second\": " << std::setprecision(0) << (mean > 0 ? static_cast<double>(points) / (mean / 1000.0) : 0.0);
+  out << "\n}\n";
+
+  if (filename != "-")
+    spdlog::info("Wrote benchmark report of {} frames to {}", sorted.size(), filename);
+  return static_cast<bool>(out);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Camera.h"
+#include <string>
+#include <vector>
+
+/** @brief one camera pose of a `CameraPath`, `time` in arbitrary increasing units */
+struct CameraKeyframe {
+  float time;
+  float theta;
+  float phi;
+  float distance; // <= 0 means the default distance of the cloud, its bounding box diagonal
+};
+
+/**
+ * @brief camera keyframes replayed by the frame-time benchmark
+ * @details Keyframe files are plain text, one `time theta phi distance` keyframe per line, with the
+ * same angles as `Camera`. Lines starting with `#` are comments. Poses in between are
+ * interpolated linearly.
+ */
+class CameraPath {
+ private:
+  std::vector<CameraKeyframe> keyframes;
+
+ public:
+  CameraPath() = default;
+  explicit CameraPath(std::vector<CameraKeyframe> keyframes_);
+
+  /** read a keyframe file, throws `std::runtime_error` when it can't be read or has no keyframes */
+  static CameraPath load(const std::string& filename);
+  /** one turn around the cloud at the default distance, the path used when no file is given */
+  static CameraPath orbit();
+
+  /**
+   * @brief pose at `t` in [0, 1] along the whole path
+   * @param camera fov and center are kept, theta, phi and distance are replaced
+   * @param default_distance used for keyframes without a distance
+   */
+  Camera sample(float t, Camera camera, float default_distance) const;
+
+  inline const std::vector<CameraKeyframe>& get_keyframes() const { return keyframes; }
+};
+
+/** @brief frame times of one benchmark run and what was rendered */
+struct BenchmarkReport {
+  std::string         renderer;    // render mode name
+  std::string         gl_renderer; // GL_RENDERER string, e.g. "llvmpipe (LLVM 15.0.7, 256 bits)"
+  size_t              points { 0 };
+  int                 width { 0 }, height { 0 };
+  std::vector<double> frame_ms;
+
+  /**
+   * @brief write the report as JSON: run parameters, frame-time percentiles and points per second
+   * @param filename output file, `-` for stdout
+   */
+  bool write_json(const std::string& filename) const;
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <limits>
+
+/** @brief axis-aligned bounds, empty when `min` > `max` */
+struct Bounds {
+  glm::vec3 min { std::numeric_limits<float>::max() };
+  glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+  inline void extend(const glm::vec3& p) {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+  inline void extend(const Bounds& b) {
+    min = glm::min(min, b.min);
+    max = glm::max(max, b.max);
+  }
+  inline bool empty() const { return min.x > max.x; }
+};
+
+/** @brief how much of a region a spatial query or a clip volume selects */
+enum class Coverage {
+  None,    ///< nothing inside the region is selected
+  Partial, ///< some points may be selected, look closer
+  All,     ///< every point inside the region is selected
+};
@@ -0,0 +1,32 @@
+#pragma once
+#define _USE_MATH_DEFINES
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <math.h>
+
+/**
+ * @brief orbit camera looking at `center`, placed on a sphere of radius `distance`.
+ * @details `theta` is the azimuth around +Z and `phi` the polar angle from +Z, both in radians.
+ */
+struct Camera {
+  float     fov { 45.0f };
+  float     distance { -1.0f };
+  float     theta {};
+  float     phi { static_cast<float>(M_PI_2) };
+  glm::vec3 center { 0.0f };
+
+  inline glm::vec3 get_position() const {
+    float camera_x = distance * sin(phi) * cos(theta);
+    float camera_y = distance * sin(phi) * sin(theta);
+    float camera_z = distance * cos(phi);
+    return glm::vec3(camera_x, camera_y, camera_z) + center;
+  }
+
+  inline glm::mat4 get_view() const {
+    return glm::lookAt(get_position(), center, glm::vec3(0.0f, 0.0f, 1.0f));
+  }
+
+  inline glm::mat4 get_projection(float aspect) const {
+    return glm::perspective(glm::radians(fov), aspect, 0.1f, distance * 2.0f);
+  }
+};
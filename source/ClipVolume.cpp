@@ -0,0 +1,189 @@
+#include "ClipVolume.h"
+#include "Parallel.h"
+#include "Shader.h"
+#include <spdlog/fmt/fmt.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const char* const clip_shape_names[static_cast<int>(ClipShape::Count)] = { "Box", "Plane", "Cylinder" };
+
+const char* const clip_volume_glsl = R"(
+#define MAX_CLIP_VOLUMES 8
+uniform int  clip_count;
+uniform int  clip_shape[MAX_CLIP_VOLUMES];  // `ClipShape`: box, plane, cylinder
+uniform int  clip_invert[MAX_CLIP_VOLUMES];
+uniform vec3 clip_center[MAX_CLIP_VOLUMES];
+uniform vec3 clip_size[MAX_CLIP_VOLUMES];
+uniform vec3 clip_normal[MAX_CLIP_VOLUMES]; // unit length
+
+bool clip_inside(int v, vec3 p)
+{
+    vec3 d = p - clip_center[v];
+    if (clip_shape[v] == 0)
+        return all(lessThanEqual(abs(d), clip_size[v]));
+    float h = dot(d, clip_normal[v]);
+    if (clip_shape[v] == 1)
+        return h >= 0.0;
+    vec3 r = d - h * clip_normal[v];
+    return abs(h) <= clip_size[v].y && dot(r, r) <= clip_size[v].x * clip_size[v].x;
+}
+
+bool clip_keeps(vec3 p)
+{
+    for (int v = 0; v < clip_count; v++)
+        if (clip_inside(v, p) == (clip_invert[v] != 0))
+            return false;
+    return true;
+}
+)";
+
+/** the unit normal of `volume`, +z when it is degenerate */
+static glm::vec3 unit_normal(const ClipVolume& volume) {
+  const float length = glm::length(volume.normal);
+  return length > 0.0f ? volume.normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+static bool inside(const ClipVolume& volume, const glm::vec3& p) {
+  const glm::vec3 d = p - volume.center;
+  if (volume.shape == ClipShape::Box)
+    return std::abs(d.x) <= volume.size.x && std::abs(d.y) <= volume.size.y && std::abs(d.z) <= volume.size.z;
+  const glm::vec3 n = unit_normal(volume);
+  const float     h = glm::dot(d, n);
+  if (volume.shape == ClipShape::Plane)
+    return h >= 0.0f;
+  const glm::vec3 r = d - h * n;
+  return std::abs(h) <= volume.size.y && glm::dot(r, r) <= volume.size.x * volume.size.x;
+}
+
+/** how much of the world-space box [`min`, `max`] lies inside `volume`, ignoring `invert` */
+static Coverage inside(const ClipVolume& volume, const glm::vec3& min, const glm::vec3& max) {
+  const glm::vec3 center = (min + max) * 0.5f;
+  const glm::vec3 half   = (max - min) * 0.5f;
+  if (volume.shape == ClipShape::Box) {
+    const glm::vec3 lo = volume.center - volume.size, hi = volume.center + volume.size;
+    if (glm::any(glm::lessThan(max, lo)) || glm::any(glm::greaterThan(min, hi)))
+      return Coverage::None;
+    if (glm::all(glm::greaterThanEqual(min, lo)) && glm::all(glm::lessThanEqual(max, hi)))
+      return Coverage::All;
+    return Coverage::Partial;
+  }
+
+  // signed distance of the box center along the normal, and how far the box reaches along it
+  const glm::vec3 n     = unit_normal(volume);
+  const float     h     = glm::dot(center - volume.center, n);
+  const float     reach = glm::dot(glm::abs(n), half);
+  if (volume.shape == ClipShape::Plane)
+    return h - reach >= 0.0f ? Coverage::All : (h + reach < 0.0f ? Coverage::None : Coverage::Partial);
+
+  if (h - reach > volume.size.y || h + reach < -volume.size.y)
+    return Coverage::None;
+  const glm::vec3 r      = center - volume.center - h * n;
+  const float     radius = glm::length(half);
+  if (glm::length(r) - radius > volume.size.x)
+    return Coverage::None;
+  // the cylinder is convex, so it holds the box when it holds every corner
+  for (int corner = 0; corner < 8; corner++) {
+    const glm::vec3 p(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+    if (!inside(volume, p))
+      return Coverage::Partial;
+  }
+  return Coverage::All;
+}
+
+void clip_set_uniforms(GLuint program, const std::vector<ClipVolume>& volumes) {
+  int count = 0;
+  for (const auto& volume : volumes) {
+    if (!volume.enabled || count == MAX_CLIP_VOLUMES)
+      continue;
+    shader_set_uniform(program, fmt::format("clip_shape[{}]", count).c_str(), static_cast<int>(volume.shape));
+    shader_set_uniform(program, fmt::format("clip_invert[{}]", count).c_str(), volume.invert ? 1 : 0);
+    shader_set_uniform(program, fmt::format("clip_center[{}]", count).c_str(), volume.center);
+    shader_set_uniform(program, fmt::format("clip_size[{}]", count).c_str(), volume.size);
+    shader_set_uniform(program, fmt::format("clip_normal[{}]", count).c_str(), unit_normal(volume));
+    count++;
+  }
+  shader_set_uniform(program, "clip_count", count);
+}
+
+bool clip_keeps(const std::vector<ClipVolume>& volumes, const glm::vec3& p) {
+  int count = 0;
+  for (const auto& volume : volumes) {
+    if (!volume.enabled || count++ == MAX_CLIP_VOLUMES)
+      continue;
+    if (inside(volume, p) == volume.invert)
+      return false;
+  }
+  return true;
+}
+
+Coverage clip_classify(const std::vector<ClipVolume>& volumes, const Bounds& bounds, const glm::mat4& model) {
+  // world bounds of the transformed box, looser than the points but enough to decide most chunks
+  glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+  for (int corner = 0; corner < 8; corner++) {
+    const glm::vec3 p(corner & 1 ? bounds.max.x : bounds.min.x, corner & 2 ? bounds.max.y : bounds.min.y, corner & 4 ? bounds.max.z : bounds.min.z);
+    const glm::vec3 w = glm::vec3(model * glm::vec4(p, 1.0f));
+    min               = glm::min(min, w);
+    max               = glm::max(max, w);
+  }
+
+  Coverage result = Coverage::All;
+  int      count  = 0;
+  for (const auto& volume : volumes) {
+    if (!volume.enabled || count++ == MAX_CLIP_VOLUMES)
+      continue;
+    Coverage coverage = inside(volume, min, max);
+    if (volume.invert && coverage != Coverage::Partial)
+      coverage = coverage == Coverage::All ? Coverage::None : Coverage::All;
+    if (coverage == Coverage::None)
+      return Coverage::None;
+    if (coverage == Coverage::Partial)
+      result = Coverage::Partial;
+  }
+  return result;
+}
+
+std::vector<uint32_t> clip_select(const SpatialIndex& index, const std::vector<ClipVolume>& volumes, const glm::mat4& model) {
+  const auto& nodes = index.get_nodes();
+  const auto& order = index.get_order();
+  if (nodes.empty())
+    return {};
+
+  // the subtrees below one level are walked in parallel, each into its own list
+  const uint32_t                     level = std::min<uint32_t>(index.get_depth(), 8);
+  const size_t                       first = (size_t(1) << level) - 1;
+  const size_t                       count = size_t(1) << level;
+  std::vector<std::vector<uint32_t>> selected(count);
+  parallel_for(0, count, [&](size_t begin, size_t end) {
+    std::vector<uint32_t> stack;
+    for (size_t s = begin; s < end; s++) {
+      stack.assign(1, static_cast<uint32_t>(first + s));
+      while (!stack.empty()) {
+        const uint32_t            node = stack.back();
+        const SpatialIndex::Node& n    = nodes[node];
+        stack.pop_back();
+        if (n.begin >= n.end)
+          continue;
+        const Coverage coverage = clip_classify(volumes, Bounds { n.min, n.max }, model);
+        if (coverage == Coverage::None)
+          continue;
+        if (coverage == Coverage::All) {
+          selected[s].insert(selected[s].end(), order.begin() + n.begin, order.begin() + n.end);
+        } else if (!index.is_leaf(node)) {
+          stack.push_back(2 * node + 2);
+          stack.push_back(2 * node + 1);
+        } else {
+          for (uint32_t i = n.begin; i < n.end; i++)
+            if (clip_keeps(volumes, glm::vec3(model * glm::vec4(index.get_point(i), 1.0f))))
+              selected[s].push_back(order[i]);
+        }
+      }
+    }
+  }, 1);
+
+  std::vector<uint32_t> result;
+  for (const auto& part : selected)
+    result.insert(result.end(), part.begin(), part.end());
+  std::sort(result.begin(), result.end());
+  return result;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "PointCloud.h"
+#include "SpatialIndex.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/** @brief shape of a clip volume */
+enum class ClipShape {
+  Box,      ///< axis-aligned box around `center`, `size` holds the half extents
+  Plane,    ///< half space through `center` on the side `normal` points to
+  Cylinder, ///< around the axis `normal` through `center`, `size.x` is the radius and `size.y` the half height
+  Count,
+};
+
+extern const char* const clip_shape_names[static_cast<int>(ClipShape::Count)];
+
+/**
+ * @brief region of world space, after the model transform, that keeps the points inside it
+ * @details With `invert` the volume hides the points inside it instead. A point is shown when every
+ * enabled volume keeps it.
+ */
+struct ClipVolume {
+  ClipShape shape { ClipShape::Box };
+  bool      enabled { true };
+  bool      invert { false };
+  glm::vec3 center { 0.0f };
+  glm::vec3 size { 1.0f };
+  glm::vec3 normal { 0.0f, 0.0f, 1.0f };
+};
+
+/** the shaders evaluate at most this many enabled volumes, the rest are ignored */
+static constexpr int MAX_CLIP_VOLUMES = 8;
+
+/**
+ * @brief GLSL declarations of the clip uniforms and of `bool clip_keeps(vec3 world_position)`
+ * @details Insert after the `#version` line of any shader that draws the cloud; the position is in
+ * world space, after the model transform of the cloud being drawn, so one set of uniforms serves
+ * every cloud of the scene. Set the uniforms with `clip_set_uniforms`.
+ */
+extern const char* const clip_volume_glsl;
+
+/** upload the enabled `volumes` to the clip uniforms of `program`, which must be in use */
+void clip_set_uniforms(GLuint program, const std::vector<ClipVolume>& volumes);
+
+/** true when every enabled volume keeps the world-space point `p`, same test as the shader */
+bool clip_keeps(const std::vector<ClipVolume>& volumes, const glm::vec3& p);
+
+/**
+ * @brief which of the points inside the model-space `bounds` the enabled volumes keep
+ * @details Conservative: `Coverage::None` and `Coverage::All` are exact answers, `Coverage::Partial`
+ * only means the box could not be decided as a whole.
+ */
+Coverage clip_classify(const std::vector<ClipVolume>& volumes, const Bounds& bounds, const glm::mat4& model);
+
+/**
+ * @brief indices of the points of `index` kept by the enabled volumes, in increasing order
+ * @details Walks the kd-tree: subtrees outside the volumes are skipped, subtrees inside them are
+ * taken without testing their points, only the leaves on the boundary are scanned.
+ */
+std::vector<uint32_t> clip_select(const SpatialIndex& index, const std::vector<ClipVolume>& volumes, const glm::mat4& model);
@@ -0,0 +1,116 @@
+#include "ColorMap.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+const char* const colormap_names[] = { "Viridis", "Magma", "Jet", "Gray" };
+const char* const shading_names[]  = { "RGB", "Normal", "Height", "Scalar" };
+
+namespace {
+struct Stop {
+  float    t;
+  uint32_t rgb;
+};
+
+// matplotlib's viridis and magma at 11 evenly spaced points
+const Stop viridis[] = { { 0.0f, 0x440154 }, { 0.1f, 0x482475 }, { 0.2f, 0x414487 }, { 0.3f, 0x355f8d }, { 0.4f, 0x2a788e }, { 0.5f, 0x21918c },
+                         { 0.6f, 0x22a884 }, { 0.7f, 0x44bf70 }, { 0.8f, 0x7ad151 }, { 0.9f, 0xbddf26 }, { 1.0f, 0xfde725 } };
+const Stop magma[]   = { { 0.0f, 0x000004 }, { 0.1f, 0x140e36 }, { 0.2f, 0x3b0f70 }, { 0.3f, 0x641a80 }, { 0.4f, 0x8c2981 }, { 0.5f, 0xb73779 },
+                         { 0.6f, 0xde4968 }, { 0.7f, 0xf7705c }, { 0.8f, 0xfe9f6d }, { 0.9f, 0xfecf92 }, { 1.0f, 0xfcfdbf } };
+const Stop jet[]     = { { 0.0f, 0x000080 }, { 0.125f, 0x0000ff }, { 0.375f, 0x00ffff }, { 0.625f, 0xffff00 }, { 0.875f, 0xff0000 }, { 1.0f, 0x800000 } };
+const Stop gray[]    = { { 0.0f, 0x000000 }, { 1.0f, 0xffffff } };
+
+inline glm::vec3 unpack(uint32_t rgb) {
+  return glm::vec3(static_cast<float>((rgb >> 16) & 0xff), static_cast<float>((rgb >> 8) & 0xff), static_cast<float>(rgb & 0xff)) / 255.0f;
+}
+
+template <size_t N>
+glm::vec3 interpolate(const Stop (&stops)[N], float t) {
+  size_t i = 1;
+  while (i < N - 1 && stops[i].t < t)
+    i++;
+  const float s = (t - stops[i - 1].t) / (stops[i].t - stops[i - 1].t);
+  return glm::mix(unpack(stops[i - 1].rgb), unpack(stops[i].rgb), std::clamp(s, 0.0f, 1.0f));
+}
+} // namespace
+
+glm::vec3 colormap_sample(ColorMap map, float t) {
+  t = std::isnan(t) ? 0.0f : std::clamp(t, 0.0f, 1.0f);
+  switch (map) {
+  case ColorMap::Viridis:
+    return interpolate(viridis, t);
+  case ColorMap::Magma:
+    return interpolate(magma, t);
+  case ColorMap::Jet:
+    return interpolate(jet, t);
+  default:
+    return interpolate(gray, t);
+  }
+}
+
+std::vector<glm::vec3> colormap_table(int width) {
+  const int              maps = static_cast<int>(ColorMap::Count);
+  std::vector<glm::vec3> table(static_cast<size_t>(maps * width));
+  for (int m = 0; m < maps; m++)
+    for (int i = 0; i < width; i++)
+      table[static_cast<size_t>(m * width + i)] = colormap_sample(static_cast<ColorMap>(m), width > 1 ? static_cast<float>(i) / static_cast<float>(width - 1) : 0.0f);
+  return table;
+}
+
+std::vector<glm::vec3> shade_points(const PointCloud& cloud, const glm::mat4& model, const ShadingSettings& settings) {
+  const auto&            points = cloud.get_points();
+  std::vector<glm::vec3> colors(points.size(), glm::vec3(0.0f));
+  const float            scale  = settings.range[1] > settings.range[0] ? 1.0f / (settings.range[1] - settings.range[0]) : 0.0f;
+  const int              axis   = std::clamp(settings.height_axis, 0, 2);
+  const glm::mat3        rotation(model);
+
+  // the same 256 texels, interpolated linearly, as the colormap texture of the GPU path
+  constexpr int          lut_size = 256;
+  std::vector<glm::vec3> lut(lut_size);
+  for (int i = 0; i < lut_size; i++)
+    lut[static_cast<size_t>(i)] = colormap_sample(settings.colormap, static_cast<float>(i) / (lut_size - 1));
+  auto lookup = [&](float value) {
+    float t = (value - settings.range[0]) * scale;
+    t       = std::isnan(t) ? 0.0f : std::clamp(t, 0.0f, 1.0f) * (lut_size - 1);
+    const int i = std::min(static_cast<int>(t), lut_size - 2);
+    return glm::mix(lut[static_cast<size_t>(i)], lut[static_cast<size_t>(i) + 1], t - static_cast<float>(i));
+  };
+
+  parallel_for(0, points.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      switch (settings.mode) {
+      case Shading::Rgb:
+        if (i < cloud.colors.size())
+          colors[i] = cloud.colors[i];
+        break;
+      case Shading::Normal:
+        if (i < cloud.normals.size()) {
+          const glm::vec3 n      = rotation * cloud.normals[i];
+          const float     length = glm::length(n);
+          colors[i]              = length > 0.0f ? (n / length + 1.0f) / 2.0f : glm::vec3(0.5f);
+        }
+        break;
+      case Shading::Height: {
+        const glm::vec3& p      = points[i];
+        const float      height = model[0][axis] * p.x + model[1][axis] * p.y + model[2][axis] * p.z + model[3][axis];
+        colors[i]               = lookup(height);
+        break;
+      }
+      default:
+        break;
+      }
+    }
+  }, 1 << 14);
+
+  const size_t attribute = static_cast<size_t>(std::max(settings.attribute, 0));
+  if (settings.mode == Shading::Scalar && attribute < cloud.attributes.size() && cloud.attributes[attribute].size() == points.size()) {
+    const size_t components = static_cast<size_t>(cloud.attributes[attribute].get_components());
+    cloud.attributes[attribute].visit([&](const auto* values) {
+      parallel_for(0, points.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+          colors[i] = lookup(static_cast<float>(values[i * components]));
+      }, 1 << 14);
+    });
+  }
+  return colors;
+}
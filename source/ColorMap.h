@@ -0,0 +1,59 @@
+#pragma once
+#include "PointCloud.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+/** @brief lookup tables that turn a scalar in [0, 1] into a color */
+enum class ColorMap {
+  Viridis, ///< perceptually uniform, readable in grayscale and by color-blind viewers
+  Magma,   ///< perceptually uniform, black to light yellow
+  Jet,     ///< rainbow, common in lidar tools but not perceptually uniform
+  Gray,
+  Count,
+};
+
+extern const char* const colormap_names[static_cast<int>(ColorMap::Count)];
+
+/** @brief which per-point value decides the color */
+enum class Shading {
+  Rgb,    ///< the loaded colors
+  Normal, ///< the normal after the model transform, each component mapped from [-1, 1] to [0, 1]
+  Height, ///< one world coordinate through the colormap
+  Scalar, ///< the first component of an entry of `PointCloud::attributes` through the colormap
+  Count,
+};
+
+extern const char* const shading_names[static_cast<int>(Shading::Count)];
+
+/**
+ * @brief everything the point shader needs to color a point, only uniforms on the GPU
+ * @details Plain 4-byte fields, so the settings map directly onto uniforms.
+ */
+struct ShadingSettings {
+  Shading  mode { Shading::Rgb };
+  ColorMap colormap { ColorMap::Viridis };
+  float    range[2] { 0.0f, 1.0f }; // values mapped to the ends of the colormap
+  int      height_axis { 2 };       // world axis used by `Shading::Height`
+  int      attribute { 0 };         // index in `PointCloud::attributes` used by `Shading::Scalar`
+
+  bool operator==(const ShadingSettings& other) const {
+    return mode == other.mode && colormap == other.colormap && range[0] == other.range[0] && range[1] == other.range[1]
+        && height_axis == other.height_axis && attribute == other.attribute;
+  }
+};
+
+/** color of `map` at `t`, clamped to [0, 1], interpolated linearly between the stops */
+glm::vec3 colormap_sample(ColorMap map, float t);
+
+/**
+ * @brief every colormap sampled at `width` evenly spaced points, one row per map
+ * @details Row `m` is the texture row of `ColorMap(m)`; the first and last texels hold the ends
+ * of the map, so shaders address texel centers with `(t * (width - 1) + 0.5) / width`.
+ */
+std::vector<glm::vec3> colormap_table(int width);
+
+/**
+ * @brief the colors the point shader would produce, for the renderers that take baked colors
+ * @details Runs in parallel; points missing the attribute of the shading mode are black.
+ */
+std::vector<glm::vec3> shade_points(const PointCloud& cloud, const glm::mat4& model, const ShadingSettings& settings);
@@ -0,0 +1,206 @@
+#include "ComputeRasterizer.h"
+#include "Shader.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+static const char* rasterizeShader = R"(
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) readonly buffer Positions { float positions[]; };
+layout(std430, binding = 1) readonly buffer Colors { float colors[]; };
+#ifdef PASS_PACKED
+layout(std430, binding = 2) buffer Framebuffer { uint64_t pixels[]; };
+#else
+layout(std430, binding = 2) buffer Framebuffer { uint pixels[]; }; // (rgba8, depth) pairs
+#endif
+
+uniform mat4  mvp;
+uniform ivec2 viewport_size;
+uniform uint  point_count;
+uniform int   splat;
+
+void main()
+{
+    uint stride = gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+    for (uint i = gl_GlobalInvocationID.x; i < point_count; i += stride) {
+        vec4 clip = mvp * vec4(positions[3u * i], positions[3u * i + 1u], positions[3u * i + 2u], 1.0);
+        if (clip.w <= 0.0)
+            continue;
+        vec3 ndc = clip.xyz / clip.w;
+        if (ndc.z < -1.0 || ndc.z > 1.0 || any(greaterThan(abs(ndc.xy), vec2(2.0))))
+            continue;
+        ivec2 corner = ivec2(floor((ndc.xy * 0.5 + 0.5) * vec2(viewport_size))) - (splat - 1) / 2;
+        uint  depth  = floatBitsToUint(ndc.z * 0.5 + 0.5);
+#ifndef PASS_DEPTH
+        vec3 color = vec3(colors[3u * i], colors[3u * i + 1u], colors[3u * i + 2u]);
+        uint rgba = packUnorm4x8(vec4(color, 1.0));
+#endif
+        for (int dy = 0; dy < splat; dy++) {
+            for (int dx = 0; dx < splat; dx++) {
+                ivec2 p = corner + ivec2(dx, dy);
+                if (any(lessThan(p, ivec2(0))) || any(greaterThanEqual(p, viewport_size)))
+                    continue;
+                uint index = uint(p.y * viewport_size.x + p.x);
+#if defined(PASS_PACKED)
+                atomicMin(pixels[index], packUint2x32(uvec2(rgba, depth)));
+#elif defined(PASS_DEPTH)
+                atomicMin(pixels[2u * index + 1u], depth);
+#else
+                if (pixels[2u * index + 1u] == depth)
+                    pixels[2u * index] = rgba;
+#endif
+            }
+        }
+    }
+}
+)";
+
+static const char* resolveVertexShader = R"(#version 450 core
+
+void main()
+{
+    vec2 p      = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+    )";
+
+static const char* resolveFragmentShader = R"(#version 450 core
+
+layout(std430, binding = 2) readonly buffer Framebuffer { uint pixels[]; };
+layout(location = 0) out vec4 FragColor;
+
+uniform ivec2 viewport_origin;
+uniform ivec2 viewport_size;
+
+void main()
+{
+    ivec2 p     = ivec2(gl_FragCoord.xy) - viewport_origin;
+    uint  index = uint(p.y * viewport_size.x + p.x);
+    uint  depth = pixels[2u * index + 1u];
+    if (depth == 0xFFFFFFFFu)
+        discard;
+    FragColor    = unpackUnorm4x8(pixels[2u * index]);
+    gl_FragDepth = uintBitsToFloat(depth);
+}
+    )";
+
+static GLuint compile_pass(const char* defines) {
+  std::string source = std::string("#version 450 core\n") + defines + rasterizeShader;
+  return create_compute_program(source.c_str());
+}
+
+ComputeRasterizer::~ComputeRasterizer() {
+  if (!initialized)
+    return;
+  delete_programs();
+  glDeleteVertexArrays(1, &resolve_vao);
+  glDeleteBuffers(1, &framebuffer_ssbo);
+}
+
+void ComputeRasterizer::delete_programs() {
+  // deleting program 0 is silently ignored
+  for (GLuint* program : { &rasterize_program, &depth_program, &color_program, &resolve_program }) {
+    glDeleteProgram(*program);
+    *program = 0;
+  }
+}
+
+bool ComputeRasterizer::init() {
+  if (initialized)
+    return true;
+  if (!GLAD_GL_VERSION_4_3) {
+    spdlog::warn("Compute rasterizer needs OpenGL 4.3");
+    return false;
+  }
+
+  int64_atomics = gl_has_extension("GL_ARB_gpu_shader_int64") && gl_has_extension("GL_NV_shader_atomic_int64");
+  if (int64_atomics) {
+    rasterize_program = compile_pass("#extension GL_ARB_gpu_shader_int64 : require\n"
+                                     "#extension GL_NV_shader_atomic_int64 : require\n"
+                                     "#define PASS_PACKED\n");
+    int64_atomics     = rasterize_program != 0;
+  }
+  if (!int64_atomics) {
+    spdlog::info("64-bit atomics unavailable, compute rasterizer uses a depth pass and a color pass");
+    depth_program = compile_pass("#define PASS_DEPTH\n");
+    color_program = compile_pass("#define PASS_COLOR\n");
+    if (!depth_program || !color_program) {
+      delete_programs();
+      return false;
+    }
+  }
+  resolve_program = create_shader_program(resolveVertexShader, resolveFragmentShader);
+  if (!resolve_program) {
+    delete_programs();
+    return false;
+  }
+
+  glGenVertexArrays(1, &resolve_vao);
+  glGenBuffers(1, &framebuffer_ssbo);
+  initialized = true;
+  return true;
+}
+
+void ComputeRasterizer::resize(int width_, int height_) {
+  width_  = std::max(1, width_);
+  height_ = std::max(1, height_);
+  if (width_ == width && height_ == height)
+    return;
+  width  = width_;
+  height = height_;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, framebuffer_ssbo);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(width) * height * 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ComputeRasterizer::dispatch(GLuint program, GLuint position_buffer, GLuint color_buffer, GLsizei count, const glm::mat4& mvp, float point_size) {
+  glUseProgram(program);
+  shader_set_uniform(program, "mvp", mvp);
+  shader_set_uniform(program, "viewport_size", glm::ivec2(width, height));
+  shader_set_uniform(program, "point_count", static_cast<GLuint>(count));
+  shader_set_uniform(program, "splat", std::max(1, static_cast<int>(std::lround(point_size))));
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, position_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, color_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, framebuffer_ssbo);
+  // the shader strides over the points, so the group count can stay under the dispatch limit
+  GLuint groups = std::min<GLuint>((static_cast<GLuint>(count) + 255) / 256, 65535);
+  glDispatchCompute(groups, 1, 1);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void ComputeRasterizer::clear() {
+  if (!initialized)
+    return;
+  const GLuint empty_pixel[2] { 0, 0xFFFFFFFFu };
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, framebuffer_ssbo);
+  glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, empty_pixel);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void ComputeRasterizer::render(GLuint position_buffer, GLuint color_buffer, GLsizei count, const glm::mat4& mvp, float point_size) {
+  if (!initialized || count <= 0)
+    return;
+
+  if (int64_atomics) {
+    dispatch(rasterize_program, position_buffer, color_buffer, count, mvp, point_size);
+  } else {
+    dispatch(depth_program, position_buffer, color_buffer, count, mvp, point_size);
+    dispatch(color_program, position_buffer, color_buffer, count, mvp, point_size);
+  }
+}
+
+void ComputeRasterizer::resolve(int x, int y) {
+  if (!initialized)
+    return;
+  glUseProgram(resolve_program);
+  shader_set_uniform(resolve_program, "viewport_origin", glm::ivec2(x, y));
+  shader_set_uniform(resolve_program, "viewport_size", glm::ivec2(width, height));
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, framebuffer_ssbo);
+  glBindVertexArray(resolve_vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+}
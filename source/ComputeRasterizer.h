@@ -0,0 +1,64 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+/**
+ * @brief point rasterizer built on compute shaders, bypassing the fixed-function point pipeline.
+ * @details Every pixel of an SSBO framebuffer holds `(rgba8, depth)` as two 32-bit words. With
+ * `GL_NV_shader_atomic_int64` both words are written by a single 64-bit `atomicMin`; otherwise a
+ * depth pass followed by a color pass gives the same result with 32-bit atomics only, which keeps
+ * the path usable on Mesa's software GL 4.5. `resolve` then draws the SSBO into the bound viewport
+ * with a full-screen triangle, writing both color and depth.
+ *
+ * Usage:
+ * ```cpp
+ * ComputeRasterizer rasterizer;
+ * if (rasterizer.init()) {
+ *   rasterizer.resize(width, height);
+ *   rasterizer.clear();
+ *   rasterizer.render(position_vbo, color_vbo, count, mvp, point_size);
+ *   rasterizer.resolve(viewport_x, viewport_y);
+ * }
+ * ```
+ */
+class ComputeRasterizer {
+ private:
+  GLuint rasterize_program { 0 }; // single 64-bit pass
+  GLuint depth_program { 0 };     // 32-bit fallback, first pass
+  GLuint color_program { 0 };     // 32-bit fallback, second pass
+  GLuint resolve_program { 0 };
+  GLuint resolve_vao { 0 };
+  GLuint framebuffer_ssbo { 0 };
+  int    width { 0 }, height { 0 };
+  bool   int64_atomics { false };
+  bool   initialized { false };
+
+  /** delete the programs compiled so far, `init` calls it before reporting a failure */
+  void delete_programs();
+  void dispatch(GLuint program, GLuint position_buffer, GLuint color_buffer, GLsizei count, const glm::mat4& mvp, float point_size);
+
+ public:
+  ComputeRasterizer() = default;
+  ~ComputeRasterizer();
+
+  ComputeRasterizer(const ComputeRasterizer&)            = delete;
+  ComputeRasterizer& operator=(const ComputeRasterizer&) = delete;
+
+  /** compile the shaders, returns false if the context lacks compute shaders (GL < 4.3) */
+  bool init();
+  /** reallocate the SSBO framebuffer, no-op when the size is unchanged */
+  void resize(int width_, int height_);
+  /** reset every pixel of the SSBO framebuffer to the far plane */
+  void clear();
+  /**
+   * @brief splat `count` points into the SSBO framebuffer, depth tested against what it holds
+   * @param position_buffer tightly packed `vec3` positions
+   * @param color_buffer tightly packed `vec3` colors
+   */
+  void render(GLuint position_buffer, GLuint color_buffer, GLsizei count, const glm::mat4& mvp, float point_size);
+  /** copy the SSBO framebuffer into the current viewport, whose lower-left corner is (x, y) */
+  void resolve(int x, int y);
+
+  inline bool is_initialized() const { return initialized; }
+  inline bool uses_int64_atomics() const { return int64_atomics; }
+};
@@ -0,0 +1,195 @@
+#include "FileWatcher.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+namespace fs = std::filesystem;
+
+/** bytes [`begin`, `end`) of `file` into `block`, false if they cannot be read */
+static bool read_range(std::ifstream& file, uint64_t begin, uint64_t end, std::vector<char>& block) {
+  block.resize(static_cast<size_t>(end - begin));
+  file.clear();
+  file.seekg(static_cast<std::streamoff>(begin));
+  return static_cast<bool>(file.read(block.data(), static_cast<std::streamsize>(block.size())));
+}
+
+/** 64-bit FNV-1a */
+static uint64_t hash_bytes(const std::vector<char>& bytes) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : bytes)
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  return hash;
+}
+
+FileSnapshot FileSnapshot::take(const std::string& path, uint64_t end) {
+  FileSnapshot    snapshot;
+  std::error_code error;
+  const uint64_t  file_size = fs::file_size(path, error);
+  std::ifstream   file(path, std::ios::binary);
+  if (error || !file.is_open())
+    return snapshot;
+  end = std::min(end, file_size);
+
+  // the last complete line ends at the last newline, looked for one block at a time from the end
+  std::vector<char> block;
+  for (uint64_t block_end = end; block_end > 0 && snapshot.size == 0;) {
+    const uint64_t block_begin = block_end > CHECKED_BYTES ? block_end - CHECKED_BYTES : 0;
+    if (!read_range(file, block_begin, block_end, block))
+      return FileSnapshot();
+    auto newline = std::find(block.rbegin(), block.rend(), '\n');
+    if (newline != block.rend())
+      snapshot.size = block_begin + static_cast<uint64_t>(block.rend() - newline);
+    block_end = block_begin;
+  }
+  if (snapshot.size == 0)
+    return snapshot;
+  if (!read_range(file, snapshot.size > CHECKED_BYTES ? snapshot.size - CHECKED_BYTES : 0, snapshot.size, block))
+    return FileSnapshot();
+  snapshot.tail_hash = hash_bytes(block);
+  return snapshot;
+}
+
+bool FileSnapshot::is_prefix_of(const std::string& path) const {
+  std::error_code error;
+  const uint64_t  file_size = fs::file_size(path, error);
+  if (error || size == 0 || file_size <= size)
+    return false;
+  const FileSnapshot now = take(path, size);
+  return now.size == size && now.tail_hash == tail_hash;
+}
+
+/** modification time of `path` in the file clock's ticks, only compared with itself */
+static int64_t modified_time(const fs::path& path) {
+  std::error_code error;
+  return static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count());
+}
+
+FileWatcher::FileWatcher(std::function<void()> on_change_)
+    : on_change { std::move(on_change_) } {
+#ifdef __linux__
+  inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify < 0)
+    spdlog::warn("inotify is not available ({}), polling the watched files instead", std::strerror(errno));
+#endif
+  thread = std::thread([this] { run(); });
+}
+
+FileWatcher::~FileWatcher() {
+  stopping = true;
+  thread.join();
+#ifdef __linux__
+  if (inotify >= 0)
+    close(inotify);
+#endif
+}
+
+void FileWatcher::watch(const std::string& path) {
+  std::error_code error;
+  const fs::path  absolute = fs::absolute(path, error);
+  Watched         file;
+  file.path      = path;
+  file.directory = absolute.parent_path().string();
+  file.name      = absolute.filename().string();
+  file.size      = fs::file_size(absolute, error);
+  if (error)
+    file.size = 0;
+  file.modified = modified_time(absolute);
+
+  std::lock_guard<std::mutex> lock(mutex);
+#ifdef __linux__
+  if (inotify >= 0) {
+    const int descriptor = inotify_add_watch(inotify, file.directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (descriptor < 0)
+      spdlog::warn("Could not watch {}: {}", file.directory, std::strerror(errno));
+    else
+      directories[descriptor] = file.directory;
+  }
+#endif
+  watched.push_back(std::move(file));
+}
+
+std::vector<std::string> FileWatcher::take_changed() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return std::exchange(changed, {});
+}
+
+void FileWatcher::touch(const std::string& directory, const std::string& name, Clock::time_point now) {
+  for (const auto& file : watched)
+    if (file.directory == directory && file.name == name)
+      pending.try_emplace(file.path, Pending { now, now }).first->second.last = now;
+}
+
+void FileWatcher::settle(Clock::time_point now) {
+  bool added = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto file = pending.begin(); file != pending.end();) {
+      const Pending& times = file->second;
+      if (now - times.last < std::chrono::milliseconds(QUIET_MS) && now - times.first < std::chrono::milliseconds(MAX_DELAY_MS)) {
+        ++file;
+        continue;
+      }
+      if (std::find(changed.begin(), changed.end(), file->first) == changed.end())
+        changed.push_back(file->first);
+      added = true;
+      file  = pending.erase(file);
+    }
+  }
+  if (added && on_change)
+    on_change();
+}
+
+void FileWatcher::run() {
+  Clock::time_point last_poll = Clock::now();
+  while (!stopping) {
+#ifdef __linux__
+    if (inotify >= 0) {
+      // short timeouts, `stopping` is only seen between waits
+      pollfd descriptor { inotify, static_cast<short>(POLLIN), 0 };
+      if (poll(&descriptor, 1, 50) > 0) {
+        alignas(inotify_event) char buffer[16384];
+        ssize_t                     length;
+        while ((length = read(inotify, buffer, sizeof(buffer))) > 0) {
+          const Clock::time_point     now = Clock::now();
+          std::lock_guard<std::mutex> lock(mutex);
+          for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            auto        directory = directories.find(event->wd);
+            if (event->len > 0 && directory != directories.end())
+              touch(directory->second, event->name, now);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+          }
+        }
+      }
+      settle(Clock::now());
+      continue;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const Clock::time_point now = Clock::now();
+    if (now - last_poll >= std::chrono::milliseconds(POLL_MS)) {
+      last_poll = now;
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto& file : watched) {
+        std::error_code error;
+        const fs::path  path     = fs::path(file.directory) / file.name;
+        const uint64_t  size     = fs::file_size(path, error);
+        const int64_t   modified = modified_time(path);
+        if (error || (size == file.size && modified == file.modified))
+          continue;
+        file.size     = size;
+        file.modified = modified;
+        touch(file.directory, file.name, now);
+      }
+    }
+    settle(now);
+  }
+}
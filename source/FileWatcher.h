@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief what a text point file held when it was last read, to tell an append from a rewrite
+ * @details Only complete lines count, a line still being written is left for the next read. The
+ * check is a hash of the `CHECKED_BYTES` before the end rather than of the whole file, so telling
+ * an append costs the same whatever the size of the file; a rewrite that grows the file and leaves
+ * those bytes as they were is taken for an append.
+ */
+struct FileSnapshot {
+  static constexpr uint64_t CHECKED_BYTES = 64 << 10;
+
+  uint64_t size { 0 };      // bytes up to the end of the last complete line
+  uint64_t tail_hash { 0 }; // of the `CHECKED_BYTES` before `size`
+
+  /** the complete lines among the first `end` bytes of `path`; an empty snapshot if it cannot be read */
+  static FileSnapshot take(const std::string& path, uint64_t end = UINT64_MAX);
+
+  /** true when `path` grew past `size` and the bytes before it are still the ones seen */
+  bool is_prefix_of(const std::string& path) const;
+};
+
+/**
+ * @brief reports the files that changed, from a background thread
+ * @details Uses inotify on Linux and polls the size and modification time of the files every
+ * `POLL_MS` elsewhere. The directories are watched rather than the files, so files replaced by a
+ * rename, as most editors and pipelines save, are still reported. A file is reported once it has
+ * not changed for `QUIET_MS`, or at least every `MAX_DELAY_MS` while it keeps changing, so a file
+ * written in many small pieces is not read after every one of them.
+ *
+ * Usage:
+ * ```cpp
+ * FileWatcher watcher([] { glfwPostEmptyEvent(); });
+ * watcher.watch("scan.xyz");
+ * for (const auto& path : watcher.take_changed())
+ *   reload(path);
+ * ```
+ */
+class FileWatcher {
+ public:
+  static constexpr int QUIET_MS     = 200;
+  static constexpr int MAX_DELAY_MS = 1000;
+  static constexpr int POLL_MS      = 250;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Watched {
+    std::string path;      // as given to `watch`, what `take_changed` reports
+    std::string directory; // absolute
+    std::string name;
+    uint64_t    size { 0 }; // last seen by the polling fallback
+    int64_t     modified { 0 };
+  };
+  struct Pending {
+    Clock::time_point first, last; // changes not reported yet
+  };
+
+  std::mutex                     mutex; // guards everything below but `stopping`
+  std::vector<Watched>           watched;
+  std::map<std::string, Pending> pending;
+  std::vector<std::string>       changed;
+  std::function<void()>          on_change;
+  std::atomic<bool>              stopping { false };
+  int                            inotify { -1 };
+  std::map<int, std::string>     directories; // inotify watch descriptor to directory
+  std::thread                    thread;
+
+  void run();
+  /** note a change of every watched file called `name` in `directory` */
+  void touch(const std::string& directory, const std::string& name, Clock::time_point now);
+  /** move the pending changes that settled to `changed` */
+  void settle(Clock::time_point now);
+
+ public:
+  /** @param on_change_ called on the watcher thread whenever files are added to `take_changed` */
+  explicit FileWatcher(std::function<void()> on_change_ = {});
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&)            = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  /** report changes of `path` from now on */
+  void watch(const std::string& path);
+
+  /** the files changed since the last call, each once */
+  std::vector<std::string> take_changed();
+};
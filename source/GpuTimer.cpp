@@ -0,0 +1,58 @@
+#include "GpuTimer.h"
+#include "Profiler.h"
+#include <algorithm>
+
+GpuTimer::~GpuTimer() {
+  for (auto& zone : zones)
+    glDeleteQueries(LATENCY, zone.queries);
+}
+
+void GpuTimer::begin(const char* name) {
+  if (active)
+    end();
+
+  auto it = std::find_if(zones.begin(), zones.end(), [&](const Zone& zone) { return zone.name == name; });
+  if (it == zones.end()) {
+    zones.emplace_back();
+    it       = zones.end() - 1;
+    it->name = name;
+    glGenQueries(LATENCY, it->queries);
+  }
+
+  const size_t slot       = frame % LATENCY;
+  active                  = &*it;
+  active_start_us         = Profiler::global().now_us();
+  active->submit_us[slot] = active_start_us;
+  active->pending[slot]   = true;
+  glBeginQuery(GL_TIME_ELAPSED, active->queries[slot]);
+}
+
+void GpuTimer::end() {
+  if (!active)
+    return;
+  glEndQuery(GL_TIME_ELAPSED);
+  Profiler::global().record_cpu(active->name, active_start_us, Profiler::global().now_us() - active_start_us);
+  active = nullptr;
+}
+
+void GpuTimer::collect() {
+  if (active)
+    end();
+
+  // the slot this frame is about to reuse holds the oldest queries
+  frame++;
+  const size_t slot = frame % LATENCY;
+  for (auto& zone : zones) {
+    if (!zone.pending[slot])
+      continue;
+    zone.pending[slot] = false;
+
+    GLint available = 0;
+    glGetQueryObjectiv(zone.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+      continue;
+    GLuint64 elapsed_ns = 0;
+    glGetQueryObjectui64v(zone.queries[slot], GL_QUERY_RESULT, &elapsed_ns);
+    Profiler::global().record_gpu("gpu/" + zone.name, zone.submit_us[slot], static_cast<double>(elapsed_ns) / 1000.0);
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief times GPU work with `GL_TIME_ELAPSED` queries and feeds the results to `Profiler`.
+ * @details Every zone owns `LATENCY` queries used round-robin, and `collect` only reads the query
+ * issued `LATENCY` frames ago, so reading a result never stalls the pipeline. A result that is
+ * still not available by then is dropped. The same zone is also recorded as a CPU zone, timing how
+ * long it took to submit the work. GPU zones show up as `gpu/<name>`. Time queries cannot nest.
+ *
+ * Usage:
+ * ```cpp
+ * gpu_timer.collect(); // once per frame
+ * gpu_timer.begin("points");
+ * glDrawArrays(GL_POINTS, 0, count);
+ * gpu_timer.end();
+ * ```
+ */
+class GpuTimer {
+ public:
+  static constexpr int LATENCY = 2;
+
+ private:
+  struct Zone {
+    std::string name;
+    GLuint      queries[LATENCY] {};
+    double      submit_us[LATENCY] {};
+    bool        pending[LATENCY] {};
+  };
+
+  std::vector<Zone> zones;
+  size_t            frame { 0 };
+  Zone*             active { nullptr };
+  double            active_start_us { 0 };
+
+ public:
+  GpuTimer() = default;
+  ~GpuTimer();
+
+  GpuTimer(const GpuTimer&)            = delete;
+  GpuTimer& operator=(const GpuTimer&) = delete;
+
+  /** start timing `name`, ends any zone still open */
+  void begin(const char* name);
+  /** stop timing the open zone */
+  void end();
+  /** hand finished results of older frames to the profiler and start a new frame */
+  void collect();
+};
@@ -0,0 +1,85 @@
+#include "NormalEstimation.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/** any unit vector perpendicular to `d` */
+static glm::dvec3 perpendicular(const glm::dvec3& d) {
+  glm::dvec3 axis = std::abs(d.x) <= std::abs(d.y) && std::abs(d.x) <= std::abs(d.z) ? glm::dvec3(1, 0, 0)
+                  : std::abs(d.y) <= std::abs(d.z)                                  ? glm::dvec3(0, 1, 0)
+                                                                                     : glm::dvec3(0, 0, 1);
+  return glm::normalize(glm::cross(d, axis));
+}
+
+glm::vec3 smallest_eigenvector(double xx, double xy, double xz, double yy, double yz, double zz) {
+  // eigenvalues from the trigonometric solution of the characteristic polynomial
+  const double p1 = xy * xy + xz * xz + yz * yz;
+  const double q  = (xx + yy + zz) / 3.0;
+  const double p2 = (xx - q) * (xx - q) + (yy - q) * (yy - q) + (zz - q) * (zz - q) + 2.0 * p1;
+  const double p  = std::sqrt(p2 / 6.0);
+  if (p <= 1e-12 * std::abs(q) || p <= std::numeric_limits<double>::min())
+    return glm::vec3(0.0f, 0.0f, 1.0f); // isotropic or empty neighbourhood, no preferred direction
+
+  // det((A - qI) / p) / 2 lies in [-1, 1] up to rounding
+  const double bxx = (xx - q) / p, byy = (yy - q) / p, bzz = (zz - q) / p, bxy = xy / p, bxz = xz / p, byz = yz / p;
+  const double det = bxx * (byy * bzz - byz * byz) - bxy * (bxy * bzz - byz * bxz) + bxz * (bxy * byz - byy * bxz);
+  const double phi = std::acos(std::clamp(det / 2.0, -1.0, 1.0)) / 3.0;
+  const double eig = q + 2.0 * p * std::cos(phi + 2.0 * M_PI / 3.0); // smallest of the three
+
+  // the eigenvector is orthogonal to the rows of (A - eig I), take the best conditioned cross product
+  const glm::dvec3 r0(xx - eig, xy, xz), r1(xy, yy - eig, yz), r2(xz, yz, zz - eig);
+  const glm::dvec3 c[3] = { glm::cross(r0, r1), glm::cross(r0, r2), glm::cross(r1, r2) };
+  const double     l[3] = { glm::dot(c[0], c[0]), glm::dot(c[1], c[1]), glm::dot(c[2], c[2]) };
+  const int        best = l[0] >= l[1] && l[0] >= l[2] ? 0 : (l[1] >= l[2] ? 1 : 2);
+  if (l[best] > 1e-20 * p * p * p * p)
+    return glm::vec3(c[best] / std::sqrt(l[best]));
+
+  // the smallest eigenvalue is double, the points lie on a line: any direction orthogonal to it will do
+  const double     n[3] = { glm::dot(r0, r0), glm::dot(r1, r1), glm::dot(r2, r2) };
+  const glm::dvec3 line = n[0] >= n[1] && n[0] >= n[2] ? r0 : (n[1] >= n[2] ? r1 : r2);
+  return glm::vec3(perpendicular(glm::normalize(line)));
+}
+
+std::vector<glm::vec3> estimate_normals(const std::vector<glm::vec3>& points, const SpatialIndex& index, size_t k,
+                                        const std::optional<glm::vec3>& viewpoint) {
+  std::vector<glm::vec3> normals(points.size());
+  if (points.empty())
+    return normals;
+
+  const auto&     root   = index.get_nodes()[0];
+  const glm::vec3 center = (root.min + root.max) * 0.5f;
+  const auto&     order  = index.get_order();
+
+  parallel_for(0, points.size(), [&](size_t begin, size_t end) {
+    std::vector<SpatialIndex::Neighbour> neighbours;
+    neighbours.reserve(k);
+    for (size_t i = begin; i < end; i++) {
+      const glm::vec3 p = index.get_point(i);
+      index.knn(p, k, neighbours);
+
+      // covariance around the neighbourhood centroid, relative to `p` to keep float precision
+      glm::vec3 mean(0.0f);
+      for (const auto& neighbour : neighbours)
+        mean += points[neighbour.index] - p;
+      mean /= static_cast<float>(neighbours.size());
+      float xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+      for (const auto& neighbour : neighbours) {
+        const glm::vec3 d = points[neighbour.index] - p - mean;
+        xx += d.x * d.x;
+        xy += d.x * d.y;
+        xz += d.x * d.z;
+        yy += d.y * d.y;
+        yz += d.y * d.z;
+        zz += d.z * d.z;
+      }
+      glm::vec3 normal = smallest_eigenvector(xx, xy, xz, yy, yz, zz);
+
+      const glm::vec3 facing = viewpoint ? viewpoint.value() - p : p - center;
+      if (glm::dot(normal, facing) < 0.0f)
+        normal = -normal;
+      normals[order[i]] = normal;
+    }
+  }, 1024);
+  return normals;
+}
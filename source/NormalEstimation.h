@@ -0,0 +1,19 @@
+#pragma once
+#include "SpatialIndex.h"
+#include <glm/glm.hpp>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief normal of the plane best fitting the `k` nearest neighbours of every point, in parallel
+ * @details The normal is the eigenvector of the smallest eigenvalue of the neighbourhood covariance,
+ * found with the closed-form solution for symmetric 3x3 matrices. Points are processed in the
+ * index's tree order so neighbouring queries touch the same leaves.
+ * @param viewpoint normals are flipped to face it, e.g. the scanner position. Without one they face
+ * away from the center of the bounding box, which suits closed objects.
+ */
+std::vector<glm::vec3> estimate_normals(const std::vector<glm::vec3>& points, const SpatialIndex& index, size_t k,
+                                        const std::optional<glm::vec3>& viewpoint = std::nullopt);
+
+/** unit eigenvector of the smallest eigenvalue of the symmetric 3x3 matrix with the given entries */
+glm::vec3 smallest_eigenvector(double xx, double xy, double xz, double yy, double yz, double zz);
@@ -0,0 +1,85 @@
+#include "OutlierRemoval.h"
+#include "Parallel.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+std::vector<float> mean_neighbour_distance(const std::vector<glm::vec3>& points, const SpatialIndex& index, size_t k) {
+  std::vector<float> mean_distance(points.size(), 0.0f);
+  if (k == 0)
+    return mean_distance;
+  parallel_for(0, points.size(), [&](size_t begin, size_t end) {
+    std::vector<SpatialIndex::Neighbour> neighbours;
+    neighbours.reserve(k + 1);
+    for (size_t i = begin; i < end; i++) {
+      index.knn(points[i], k + 1, neighbours);
+      float  total = 0.0f;
+      size_t count = 0;
+      bool   self  = false;
+      for (const auto& neighbour : neighbours) {
+        if (!self && neighbour.index == i) {
+          self = true;
+          continue;
+        }
+        if (count == k)
+          break;
+        total += std::sqrt(neighbour.distance2);
+        count++;
+      }
+      mean_distance[i] = count ? total / static_cast<float>(count) : 0.0f;
+    }
+  }, 1024);
+  return mean_distance;
+}
+
+std::vector<uint8_t> statistical_outlier_mask(const std::vector<glm::vec3>& points, const SpatialIndex& index, size_t k,
+                                              float stddev_multiplier) {
+  std::vector<uint8_t> keep(points.size(), 1);
+  if (points.size() <= 1 || k == 0)
+    return keep;
+
+  const std::vector<float> mean_distance = mean_neighbour_distance(points, index, k);
+
+  // moments summed per fixed-size block and combined in block order, the same for any thread count
+  constexpr size_t                       BLOCK_SIZE  = 1 << 16;
+  const size_t                           block_count = (points.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  std::vector<std::pair<double, double>> moments(block_count);
+  parallel_for(0, block_count, [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; block++) {
+      double block_sum = 0.0, block_sum2 = 0.0;
+      for (size_t i = block * BLOCK_SIZE; i < std::min(points.size(), (block + 1) * BLOCK_SIZE); i++) {
+        block_sum += mean_distance[i];
+        block_sum2 += static_cast<double>(mean_distance[i]) * mean_distance[i];
+      }
+      moments[block] = { block_sum, block_sum2 };
+    }
+  }, 1);
+  double sum = 0.0, sum2 = 0.0;
+  for (const auto& [block_sum, block_sum2] : moments) {
+    sum += block_sum;
+    sum2 += block_sum2;
+  }
+
+  const double n         = static_cast<double>(points.size());
+  const double mean      = sum / n;
+  const double stddev    = std::sqrt(std::max(0.0, sum2 / n - mean * mean));
+  const float  threshold = static_cast<float>(mean + stddev_multiplier * stddev);
+  spdlog::debug("Statistical outlier removal: mean neighbour distance {}, stddev {}, threshold {}", mean, stddev, threshold);
+
+  parallel_for(0, points.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      keep[i] = mean_distance[i] <= threshold;
+  }, 1 << 16);
+  return keep;
+}
+
+std::vector<uint8_t> radius_outlier_mask(const std::vector<glm::vec3>& points, const SpatialIndex& index, float radius,
+                                         size_t min_neighbours) {
+  std::vector<uint8_t> keep(points.size(), 1);
+  parallel_for(0, points.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      keep[i] = index.count_within(points[i], radius, min_neighbours + 1) > min_neighbours; // the point finds itself
+  }, 1024);
+  return keep;
+}
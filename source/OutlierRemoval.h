@@ -0,0 +1,27 @@
+#pragma once
+#include "SpatialIndex.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief mean distance of every point to its `k` nearest neighbours, the point itself excluded
+ * @details A local point spacing: the statistical outlier removal thresholds it, the renderer sizes
+ * splats from it. Points without neighbours get 0.
+ */
+std::vector<float> mean_neighbour_distance(const std::vector<glm::vec3>& points, const SpatialIndex& index, size_t k);
+
+/**
+ * @brief statistical outlier removal: flag points whose mean distance to their `k` nearest
+ * neighbours exceeds the global mean of that distance by more than `stddev_multiplier` standard deviations
+ * @return one entry per point, 1 to keep it, for `PointCloud::keep_points`
+ */
+std::vector<uint8_t> statistical_outlier_mask(const std::vector<glm::vec3>& points, const SpatialIndex& index, size_t k,
+                                              float stddev_multiplier);
+
+/**
+ * @brief radius outlier removal: flag points with fewer than `min_neighbours` other points within `radius`
+ * @return one entry per point, 1 to keep it, for `PointCloud::keep_points`
+ */
+std::vector<uint8_t> radius_outlier_mask(const std::vector<glm::vec3>& points, const SpatialIndex& index, float radius,
+                                         size_t min_neighbours);
@@ -0,0 +1,143 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief fixed-size pool of worker threads shared by the CPU-side passes.
+ *
+ * Usage:
+ * ```cpp
+ * ThreadPool::global().parallel_for(0, points.size(), [&](size_t begin, size_t end) {
+ *   for (size_t i = begin; i < end; i++)
+ *     ...;
+ * });
+ * ```
+ */
+class ThreadPool {
+ private:
+  std::vector<std::thread>          workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex                        mutex;
+  std::condition_variable           condition;
+  bool                              stopping { false };
+
+  void worker_loop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (stopping && tasks.empty())
+          return;
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+      task();
+    }
+  }
+
+ public:
+  explicit ThreadPool(size_t thread_count = std::max(1u, std::thread::hardware_concurrency())) {
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++)
+      workers.emplace_back([this] { worker_loop(); });
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    condition.notify_all();
+    for (auto& worker : workers)
+      worker.join();
+  }
+
+  ThreadPool(const ThreadPool&)            = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /** the process-wide pool, sized to the number of hardware threads */
+  static ThreadPool& global() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  inline size_t size() const { return workers.size(); }
+
+  /** run `task` on a worker thread */
+  template <typename F>
+  auto submit(F&& task) -> std::future<decltype(task())> {
+    using R      = decltype(task());
+    auto package = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+    auto future  = package->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace([package] { (*package)(); });
+    }
+    condition.notify_one();
+    return future;
+  }
+
+  /**
+   * @brief call `fn(block_begin, block_end)` over [begin, end) split into blocks of at least `grain` items.
+   * @details The calling thread takes part in the work, so nested calls from inside a worker cannot deadlock.
+   */
+  template <typename F>
+  void parallel_for(size_t begin, size_t end, F&& fn, size_t grain = 4096) {
+    if (end <= begin)
+      return;
+    const size_t count       = end - begin;
+    const size_t max_blocks  = size() * 4;
+    const size_t block_size  = std::max(grain, (count + max_blocks - 1) / max_blocks);
+    const size_t block_count = (count + block_size - 1) / block_size;
+    if (block_count == 1) {
+      fn(begin, end);
+      return;
+    }
+
+    struct State {
+      std::atomic<size_t>     next { 0 };
+      std::atomic<size_t>     done { 0 };
+      std::mutex              mutex;
+      std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    auto work  = [state, begin, end, block_size, block_count, &fn] {
+      for (size_t b = state->next++; b < block_count; b = state->next++) {
+        const size_t first = begin + b * block_size;
+        fn(first, std::min(end, first + block_size));
+        if (++state->done == block_count) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          state->finished.notify_all();
+        }
+      }
+    };
+
+    const size_t helpers = std::min(size(), block_count - 1);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (size_t i = 0; i < helpers; i++)
+        tasks.emplace(work);
+    }
+    condition.notify_all();
+
+    work();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == block_count; });
+  }
+};
+
+/** @brief shorthand for `ThreadPool::global().parallel_for` */
+template <typename F>
+inline void parallel_for(size_t begin, size_t end, F&& fn, size_t grain = 4096) {
+  ThreadPool::global().parallel_for(begin, end, std::forward<F>(fn), grain);
+}
@@ -0,0 +1,315 @@
+#include "PlyReader.h"
+#include "Parallel.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace {
+enum class Format { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+// what a vertex property is loaded into
+enum class Role { Position, Normal, Color, Attribute };
+
+struct Property {
+  std::string   name;
+  AttributeType type;
+  size_t        offset; // in a binary row
+  Role          role { Role::Attribute };
+  int           axis { 0 };             // component of the position, normal or color
+  double        color_scale { 1.0 };    // integer colors are divided by the maximum of their type
+  int           attribute { -1 };       // index in `PointCloud::attributes`
+};
+
+struct Element {
+  std::string name;
+  size_t      count { 0 };
+  size_t      row_size { 0 };
+  bool        has_list { false };
+};
+
+[[noreturn]] void fail(const std::string& filename, const std::string& reason) {
+  spdlog::critical("Could not read PLY file {}: {}", filename, reason);
+  throw std::runtime_error("failed to load ply file.");
+}
+
+bool parse_type(const std::string& name, AttributeType& type) {
+  static const std::pair<const char*, AttributeType> types[] = {
+    { "char", AttributeType::Int8 },     { "int8", AttributeType::Int8 },       { "uchar", AttributeType::UInt8 },
+    { "uint8", AttributeType::UInt8 },   { "short", AttributeType::Int16 },     { "int16", AttributeType::Int16 },
+    { "ushort", AttributeType::UInt16 }, { "uint16", AttributeType::UInt16 },   { "int", AttributeType::Int32 },
+    { "int32", AttributeType::Int32 },   { "uint", AttributeType::UInt32 },     { "uint32", AttributeType::UInt32 },
+    { "float", AttributeType::Float32 }, { "float32", AttributeType::Float32 }, { "double", AttributeType::Float64 },
+    { "float64", AttributeType::Float64 },
+  };
+  for (const auto& [ply_name, ply_type] : types) {
+    if (name == ply_name) {
+      type = ply_type;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+inline double load(const std::byte* p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return static_cast<double>(value);
+}
+
+double read_value(const std::byte* p, AttributeType type) {
+  switch (type) {
+  case AttributeType::Int8:
+    return load<int8_t>(p);
+  case AttributeType::UInt8:
+    return load<uint8_t>(p);
+  case AttributeType::Int16:
+    return load<int16_t>(p);
+  case AttributeType::UInt16:
+    return load<uint16_t>(p);
+  case AttributeType::Int32:
+    return load<int32_t>(p);
+  case AttributeType::UInt32:
+    return load<uint32_t>(p);
+  case AttributeType::Float32:
+    return load<float>(p);
+  default:
+    return load<double>(p);
+  }
+}
+
+double integer_max(AttributeType type) {
+  switch (type) {
+  case AttributeType::Int8:
+    return std::numeric_limits<int8_t>::max();
+  case AttributeType::UInt8:
+    return std::numeric_limits<uint8_t>::max();
+  case AttributeType::Int16:
+    return std::numeric_limits<int16_t>::max();
+  case AttributeType::UInt16:
+    return std::numeric_limits<uint16_t>::max();
+  case AttributeType::Int32:
+    return std::numeric_limits<int32_t>::max();
+  case AttributeType::UInt32:
+    return std::numeric_limits<uint32_t>::max();
+  default:
+    return 1.0;
+  }
+}
+
+// store a converted value of property `property` of point `i`
+inline void store(PointCloud& cloud, const Property& property, size_t i, double value) {
+  switch (property.role) {
+  case Role::Position:
+    cloud.points[i][property.axis] = static_cast<float>(value - cloud.origin[property.axis]);
+    break;
+  case Role::Normal:
+    cloud.normals[i][property.axis] = static_cast<float>(value);
+    break;
+  case Role::Color:
+    cloud.colors[i][property.axis] = static_cast<float>(value / property.color_scale);
+    break;
+  default:
+    cloud.attributes[static_cast<size_t>(property.attribute)].set(i, 0, value);
+    break;
+  }
+}
+} // namespace
+
+void read_ply(const std::string& filename, PointCloud& cloud) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open())
+    fail(filename, "cannot open file");
+
+  // ---- header ----
+  std::string line;
+  if (!std::getline(file, line) || line.rfind("ply", 0) != 0)
+    fail(filename, "missing ply magic");
+
+  Format                format = Format::Ascii;
+  std::vector<Element>  elements;
+  std::vector<Property> properties; // of the vertex element
+  bool                  header_done = false;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    std::istringstream tokens(line);
+    std::string        keyword;
+    tokens >> keyword;
+    if (keyword == "format") {
+      std::string name;
+      tokens >> name;
+      if (name == "ascii")
+        format = Format::Ascii;
+      else if (name == "binary_little_endian")
+        format = Format::BinaryLittleEndian;
+      else if (name == "binary_big_endian")
+        format = Format::BinaryBigEndian;
+      else
+        fail(filename, "unknown format " + name);
+    } else if (keyword == "element") {
+      Element element;
+      tokens >> element.name >> element.count;
+      elements.push_back(element);
+    } else if (keyword == "property") {
+      if (elements.empty())
+        fail(filename, "property outside of an element");
+      Element&    element = elements.back();
+      std::string type_name, name;
+      tokens >> type_name;
+      if (type_name == "list") {
+        element.has_list = true;
+        continue;
+      }
+      tokens >> name;
+      AttributeType type;
+      if (!parse_type(type_name, type))
+        fail(filename, "unknown property type " + type_name);
+      if (element.name == "vertex")
+        properties.push_back({ name, type, element.row_size });
+      element.row_size += attribute_type_size(type);
+    } else if (keyword == "end_header") {
+      header_done = true;
+      break;
+    }
+  }
+  if (!header_done)
+    fail(filename, "missing end_header");
+
+  auto vertex = std::find_if(elements.begin(), elements.end(), [](const Element& e) { return e.name == "vertex"; });
+  if (vertex == elements.end())
+    fail(filename, "no vertex element");
+  if (vertex->has_list)
+    fail(filename, "list properties in the vertex element are not supported");
+  for (auto it = elements.begin(); it != vertex; it++)
+    if (it->has_list)
+      fail(filename, "list properties before the vertex element are not supported");
+  const size_t count = vertex->count;
+
+  // ---- where every property goes ----
+  static const char* position_names[] = { "x", "y", "z" };
+  static const char* normal_names[]   = { "nx", "ny", "nz" };
+  static const char* color_names[]    = { "red", "green", "blue" };
+  auto               axis_of          = [](const std::string& name, const char* const (&names)[3]) {
+    for (int axis = 0; axis < 3; axis++)
+      if (name == names[axis])
+        return axis;
+    return -1;
+  };
+  int found[3] = { 0, 0, 0 }; // position, normal and color components present
+  for (auto& property : properties) {
+    const Role roles[3] = { Role::Position, Role::Normal, Role::Color };
+    const int  axes[3]  = { axis_of(property.name, position_names), axis_of(property.name, normal_names), axis_of(property.name, color_names) };
+    for (int r = 0; r < 3; r++) {
+      if (axes[r] >= 0) {
+        property.role = roles[r];
+        property.axis = axes[r];
+        found[r]++;
+      }
+    }
+  }
+  if (found[0] != 3)
+    fail(filename, "vertices need x, y and z");
+  // incomplete normals or colors are kept as attributes rather than half-filled vectors
+  for (auto& property : properties) {
+    if ((property.role == Role::Normal && found[1] != 3) || (property.role == Role::Color && found[2] != 3))
+      property.role = Role::Attribute;
+    if (property.role == Role::Color)
+      property.color_scale = integer_max(property.type);
+  }
+
+  cloud.origin = glm::dvec3(0.0);
+  cloud.points.assign(count, glm::vec3(0.0f));
+  cloud.normals.assign(found[1] == 3 ? count : 0, glm::vec3(0.0f));
+  cloud.colors.assign(found[2] == 3 ? count : 0, glm::vec3(0.0f));
+  cloud.attributes.clear();
+  for (auto& property : properties) {
+    if (property.role == Role::Attribute) {
+      cloud.attributes.add(property.name, property.type, 1, count);
+      property.attribute = cloud.attributes.index_of(property.name);
+    }
+  }
+
+  // ---- body ----
+  // positions are stored relative to an origin near the first vertex, see `PointCloud::origin_near`
+  auto position_of = [&](const double* values) {
+    glm::dvec3 position(0.0);
+    for (size_t k = 0; k < properties.size(); k++)
+      if (properties[k].role == Role::Position)
+        position[properties[k].axis] = values[k];
+    return position;
+  };
+  if (format == Format::Ascii) {
+    for (auto it = elements.begin(); it != vertex; it++)
+      for (size_t i = 0; i < it->count; i++)
+        std::getline(file, line);
+    std::vector<double> values(properties.size());
+    for (size_t i = 0; i < count; i++) {
+      if (!std::getline(file, line))
+        fail(filename, fmt::format("expected {} vertices, got {}", count, i));
+      const char* p = line.c_str();
+      for (size_t k = 0; k < properties.size(); k++) {
+        char* end = nullptr;
+        values[k] = std::strtod(p, &end);
+        if (end == p)
+          fail(filename, fmt::format("vertex {} has too few values", i));
+        p = end;
+      }
+      if (i == 0)
+        cloud.origin = PointCloud::origin_near(position_of(values.data()));
+      for (size_t k = 0; k < properties.size(); k++)
+        store(cloud, properties[k], i, values[k]);
+    }
+  } else {
+    size_t skip = 0;
+    for (auto it = elements.begin(); it != vertex; it++)
+      skip += it->count * it->row_size;
+    file.seekg(static_cast<std::streamoff>(skip), std::ios::cur);
+
+    // a block of rows at a time, attributes are copied from the block into their storage without conversion
+    const size_t           row_size   = vertex->row_size;
+    const size_t           block_rows = std::max<size_t>(1, (size_t(1) << 22) / std::max<size_t>(row_size, 1));
+    std::vector<std::byte> block(block_rows * row_size);
+    for (size_t first = 0; first < count; first += block_rows) {
+      const size_t rows = std::min(block_rows, count - first);
+      if (!file.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(rows * row_size)))
+        fail(filename, fmt::format("expected {} vertices, got fewer than {}", count, first + rows));
+      if (first == 0) {
+        // the first row picks the origin, before the rows are swapped in place
+        std::vector<double> values(properties.size());
+        for (size_t k = 0; k < properties.size(); k++) {
+          std::byte    value[8];
+          const size_t size = attribute_type_size(properties[k].type);
+          std::memcpy(value, block.data() + properties[k].offset, size);
+          if (format == Format::BinaryBigEndian)
+            std::reverse(value, value + size);
+          values[k] = read_value(value, properties[k].type);
+        }
+        cloud.origin = PointCloud::origin_near(position_of(values.data()));
+      }
+
+      parallel_for(0, rows, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+          std::byte* row = block.data() + r * row_size;
+          for (const auto& property : properties) {
+            std::byte*   value = row + property.offset;
+            const size_t size  = attribute_type_size(property.type);
+            if (format == Format::BinaryBigEndian)
+              std::reverse(value, value + size);
+            if (property.role == Role::Attribute)
+              std::memcpy(cloud.attributes[static_cast<size_t>(property.attribute)].data() + (first + r) * size, value, size);
+            else
+              store(cloud, property, first + r, read_value(value, property.type));
+          }
+        }
+      }, 4096);
+    }
+  }
+  cloud.update_bbox();
+
+  spdlog::debug("PLY {}: {} vertices, {} extra attributes", filename, count, cloud.attributes.size());
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "PointCloud.h"
+#include <string>
+
+/**
+ * @brief load the vertices of a PLY file, ascii or binary of either endianness
+ * @details `x`, `y`, `z` become the points, `nx`, `ny`, `nz` the normals and `red`, `green`, `blue`
+ * the colors, scaled to [0, 1] when stored as integers. Every other vertex property is kept as a
+ * one-component attribute of its own type, e.g. `intensity` as `uint16`; binary values are copied
+ * into the attribute storage as they are read. Elements before `vertex` must not hold lists.
+ * Throws `std::runtime_error` when the file cannot be read or is not a supported PLY file.
+ */
+void read_ply(const std::string& filename, PointCloud& cloud);
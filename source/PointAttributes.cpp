@@ -0,0 +1,92 @@
+#include "PointAttributes.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+size_t attribute_type_size(AttributeType type) {
+  switch (type) {
+  case AttributeType::Int8:
+  case AttributeType::UInt8:
+    return 1;
+  case AttributeType::Int16:
+  case AttributeType::UInt16:
+    return 2;
+  case AttributeType::Int32:
+  case AttributeType::UInt32:
+  case AttributeType::Float32:
+    return 4;
+  default:
+    return 8;
+  }
+}
+
+const char* attribute_type_name(AttributeType type) {
+  static const char* names[] = { "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+  return names[static_cast<int>(type)];
+}
+
+PointAttribute::PointAttribute(std::string name_, AttributeType type_, int components_, size_t count)
+    : name { std::move(name_) }
+    , type { type_ }
+    , components { std::max(components_, 1) } {
+  resize(count);
+}
+
+double PointAttribute::get(size_t i, int component) const {
+  double result = 0.0;
+  visit([&](const auto* v) { result = static_cast<double>(v[i * static_cast<size_t>(components) + static_cast<size_t>(component)]); });
+  return result;
+}
+
+void PointAttribute::set(size_t i, int component, double value) {
+  visit([&](const auto* v) {
+    using T = std::remove_const_t<std::remove_pointer_t<decltype(v)>>;
+    const_cast<T*>(v)[i * static_cast<size_t>(components) + static_cast<size_t>(component)] = static_cast<T>(value);
+  });
+}
+
+void PointAttribute::compact(const std::vector<uint8_t>& keep) {
+  const size_t bytes = stride();
+  const size_t count = std::min(size(), keep.size());
+  size_t       kept  = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (!keep[i])
+      continue;
+    if (kept != i)
+      std::memcpy(storage.data() + kept * bytes, storage.data() + i * bytes, bytes);
+    kept++;
+  }
+  resize(kept);
+}
+
+void PointAttribute::copy_point(size_t from, size_t to) {
+  std::memcpy(storage.data() + to * stride(), storage.data() + from * stride(), stride());
+}
+
+PointAttribute PointAttribute::gather(const std::vector<uint32_t>& indices) const {
+  PointAttribute result(name, type, components, indices.size());
+  const size_t   bytes = stride();
+  for (size_t i = 0; i < indices.size(); i++)
+    std::memcpy(result.storage.data() + i * bytes, storage.data() + indices[i] * bytes, bytes);
+  return result;
+}
+
+PointAttribute& PointAttributes::add(const std::string& name, AttributeType type, int components, size_t count) {
+  int i = index_of(name);
+  if (i >= 0)
+    return attributes[static_cast<size_t>(i)] = PointAttribute(name, type, components, count);
+  return attributes.emplace_back(name, type, components, count);
+}
+
+int PointAttributes::index_of(const std::string& name) const {
+  for (size_t i = 0; i < attributes.size(); i++)
+    if (attributes[i].get_name() == name)
+      return static_cast<int>(i);
+  return -1;
+}
+
+void PointAttributes::remove(const std::string& name) {
+  int i = index_of(name);
+  if (i >= 0)
+    attributes.erase(attributes.begin() + i);
+}
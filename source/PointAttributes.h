@@ -0,0 +1,171 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/** @brief storage type of one component of a point attribute */
+enum class AttributeType : uint8_t {
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Float32,
+  Float64,
+};
+
+/** size in bytes of one component */
+size_t attribute_type_size(AttributeType type);
+/** PLY-style name, e.g. `uint16` */
+const char* attribute_type_name(AttributeType type);
+
+/** @brief allocator handing out `Alignment`-byte aligned blocks, so attribute arrays can be read with aligned SIMD loads */
+template <typename T, size_t Alignment>
+struct AlignedAllocator {
+  using value_type = T;
+  template <typename U>
+  struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+  void deallocate(T* p, size_t) {
+    ::operator delete(p, std::align_val_t(Alignment));
+  }
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+/**
+ * @brief one named per-point attribute, e.g. intensity or classification
+ * @details The values of all points are stored contiguously in their own type, `components` values
+ * per point, in a 64-byte aligned array. Loaders write into `data()` directly after `resize`.
+ */
+class PointAttribute {
+ private:
+  std::string                                             name;
+  AttributeType                                           type;
+  int                                                     components;
+  std::vector<std::byte, AlignedAllocator<std::byte, 64>> storage;
+
+ public:
+  PointAttribute(std::string name_, AttributeType type_, int components_, size_t count = 0);
+
+  inline const std::string& get_name() const { return name; }
+  inline AttributeType      get_type() const { return type; }
+  inline int                get_components() const { return components; }
+  /** bytes per point */
+  inline size_t stride() const { return attribute_type_size(type) * static_cast<size_t>(components); }
+  /** number of points */
+  inline size_t size() const { return storage.size() / stride(); }
+  inline void   resize(size_t count) { storage.resize(count * stride()); }
+
+  inline std::byte*       data() { return storage.data(); }
+  inline const std::byte* data() const { return storage.data(); }
+
+  /** typed view of the values, throws `std::runtime_error` if `T` is not the storage type */
+  template <typename T>
+  T* values();
+  template <typename T>
+  const T* values() const { return const_cast<PointAttribute*>(this)->values<T>(); }
+
+  /** call `fn(const T* values)` with the values in their storage type */
+  template <typename F>
+  void visit(F&& fn) const;
+
+  /** component `component` of point `i`, converted */
+  double get(size_t i, int component = 0) const;
+  void   set(size_t i, int component, double value);
+
+  /** keep the points whose entry in `keep` is not 0, in order */
+  void compact(const std::vector<uint8_t>& keep);
+  /** overwrite point `to` with point `from` */
+  void copy_point(size_t from, size_t to);
+  /** values of `source` at the points `indices`, in that order */
+  PointAttribute gather(const std::vector<uint32_t>& indices) const;
+};
+
+/**
+ * @brief the extra attributes of a point cloud, beyond positions, colors and normals
+ * @details Attributes are looked up by name and stay in insertion order; indices into the registry
+ * are stable until an attribute is removed.
+ */
+class PointAttributes {
+ private:
+  std::vector<PointAttribute> attributes;
+
+ public:
+  /** add an attribute with `count` zeroed values, replacing any attribute of the same name */
+  PointAttribute& add(const std::string& name, AttributeType type, int components, size_t count);
+  /** index of the attribute called `name`, -1 if there is none */
+  int  index_of(const std::string& name) const;
+  void remove(const std::string& name);
+
+  inline PointAttribute* find(const std::string& name) {
+    int i = index_of(name);
+    return i < 0 ? nullptr : &attributes[static_cast<size_t>(i)];
+  }
+  inline const PointAttribute* find(const std::string& name) const { return const_cast<PointAttributes*>(this)->find(name); }
+
+  inline size_t                size() const { return attributes.size(); }
+  inline bool                  empty() const { return attributes.empty(); }
+  inline void                  clear() { attributes.clear(); }
+  inline PointAttribute&       operator[](size_t i) { return attributes[i]; }
+  inline const PointAttribute& operator[](size_t i) const { return attributes[i]; }
+  inline auto                  begin() { return attributes.begin(); }
+  inline auto                  end() { return attributes.end(); }
+  inline auto                  begin() const { return attributes.begin(); }
+  inline auto                  end() const { return attributes.end(); }
+};
+
+template <typename T>
+struct attribute_type_of;
+template <> struct attribute_type_of<int8_t> { static constexpr AttributeType value = AttributeType::Int8; };
+template <> struct attribute_type_of<uint8_t> { static constexpr AttributeType value = AttributeType::UInt8; };
+template <> struct attribute_type_of<int16_t> { static constexpr AttributeType value = AttributeType::Int16; };
+template <> struct attribute_type_of<uint16_t> { static constexpr AttributeType value = AttributeType::UInt16; };
+template <> struct attribute_type_of<int32_t> { static constexpr AttributeType value = AttributeType::Int32; };
+template <> struct attribute_type_of<uint32_t> { static constexpr AttributeType value = AttributeType::UInt32; };
+template <> struct attribute_type_of<float> { static constexpr AttributeType value = AttributeType::Float32; };
+template <> struct attribute_type_of<double> { static constexpr AttributeType value = AttributeType::Float64; };
+
+template <typename T>
+T* PointAttribute::values() {
+  if (attribute_type_of<T>::value != type)
+    throw std::runtime_error("attribute " + name + " is stored as " + attribute_type_name(type));
+  return reinterpret_cast<T*>(storage.data());
+}
+
+template <typename F>
+void PointAttribute::visit(F&& fn) const {
+  switch (type) {
+  case AttributeType::Int8:
+    return fn(values<int8_t>());
+  case AttributeType::UInt8:
+    return fn(values<uint8_t>());
+  case AttributeType::Int16:
+    return fn(values<int16_t>());
+  case AttributeType::UInt16:
+    return fn(values<uint16_t>());
+  case AttributeType::Int32:
+    return fn(values<int32_t>());
+  case AttributeType::UInt32:
+    return fn(values<uint32_t>());
+  case AttributeType::Float32:
+    return fn(values<float>());
+  case AttributeType::Float64:
+    return fn(values<double>());
+  }
+}
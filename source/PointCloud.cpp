@@ -1,53 +1,162 @@
 #include "PointCloud.h"
+#include "Parallel.h"
+#include "PlyReader.h"
+#include <spdlog/fmt/fmt.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 PointCloud& PointCloud::add_point(const glm::vec3& p) {
-  auto& lower = bbox[0];
-  auto& upper = bbox[1];
-  if (p.x < lower.x)
-    lower.x = p.x;
-  if (p.y < lower.y)
-    lower.y = p.y;
-  if (p.z < lower.z)
-    lower.z = p.z;
-  if (p.x > upper.x)
-    upper.x = p.x;
-  if (p.y > upper.y)
-    upper.y = p.y;
-  if (p.z > upper.z)
-    upper.z = p.z;
+  index_cache.index.reset();
   points.push_back(p);
+  const size_t chunk = (points.size() - 1) / CHUNK_SIZE;
+  reserve_chunks(chunk + 1);
+  for (size_t node = bounds_leaves + chunk; node > 0; node /= 2)
+    bounds_tree[node].extend(p);
+  bbox[0] = bounds_tree[1].min;
+  bbox[1] = bounds_tree[1].max;
   return *this;
 }
 
+PointCloud& PointCloud::append_points(const std::vector<glm::vec3>& new_points) {
+  const size_t first = points.size();
+  points.insert(points.end(), new_points.begin(), new_points.end());
+  return update_points(first, points.size());
+}
+
+PointCloud& PointCloud::update_points(size_t begin, size_t end) {
+  refresh_chunks(begin / CHUNK_SIZE, (end + CHUNK_SIZE - 1) / CHUNK_SIZE);
+  return *this;
+}
+
+PointCloud& PointCloud::remove_point(size_t i) {
+  const size_t last = points.size() - 1;
+  if (colors.size() == points.size()) {
+    colors[i] = colors[last];
+    colors.pop_back();
+  }
+  if (normals.size() == points.size()) {
+    normals[i] = normals[last];
+    normals.pop_back();
+  }
+  for (auto& attribute : attributes) {
+    if (attribute.size() == points.size()) {
+      attribute.copy_point(last, i);
+      attribute.resize(last);
+    }
+  }
+  points[i] = points[last];
+  points.pop_back();
+  refresh_chunks(i / CHUNK_SIZE, i / CHUNK_SIZE + 1);
+  refresh_chunks(last / CHUNK_SIZE, last / CHUNK_SIZE + 1);
+  return *this;
+}
+
+void PointCloud::reserve_chunks(size_t chunk_count) {
+  if (chunk_count <= bounds_leaves)
+    return;
+  size_t leaves = std::max<size_t>(bounds_leaves, 1);
+  while (leaves < chunk_count)
+    leaves *= 2;
+
+  std::vector<Bounds> tree(2 * leaves);
+  for (size_t c = 0; c < bounds_leaves; c++)
+    tree[leaves + c] = bounds_tree[bounds_leaves + c];
+  for (size_t node = leaves - 1; node >= 1; node--) {
+    tree[node] = tree[2 * node];
+    tree[node].extend(tree[2 * node + 1]);
+  }
+  bounds_tree   = std::move(tree);
+  bounds_leaves = leaves;
+}
+
+void PointCloud::refresh_chunks(size_t first, size_t last) {
+  index_cache.index.reset();
+  const size_t chunk_count = (points.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  reserve_chunks(std::max<size_t>(chunk_count, 1));
+  last  = std::min(last, bounds_leaves);
+  first = std::min(first, last);
+
+  parallel_for(first, last, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; c++) {
+      Bounds bounds;
+      for (size_t i = c * CHUNK_SIZE; i < std::min(points.size(), (c + 1) * CHUNK_SIZE); i++)
+        bounds.extend(points[i]);
+      bounds_tree[bounds_leaves + c] = bounds;
+    }
+  }, 1);
+
+  // ancestors of the refreshed leaves, one level at a time
+  if (first < last) {
+    for (size_t lo = (bounds_leaves + first) / 2, hi = (bounds_leaves + last - 1) / 2; lo >= 1; lo /= 2, hi /= 2) {
+      for (size_t node = lo; node <= hi; node++) {
+        bounds_tree[node] = bounds_tree[2 * node];
+        bounds_tree[node].extend(bounds_tree[2 * node + 1]);
+      }
+    }
+  }
+  bbox[0] = bounds_tree[1].min;
+  bbox[1] = bounds_tree[1].max;
+}
+
 PointCloud& PointCloud::load_points(std::string filename) {
+  if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".ply") == 0) {
+    read_ply(filename, *this);
+    return *this;
+  }
+
   std::ifstream file(filename);
   if (!file.is_open()) {
     spdlog::critical("Could not open cloud point from file {}", filename);
-    goto FAIL;
+    throw std::runtime_error("failed to load point.");
   }
 
-  points.clear();
-  glm::vec3 p;
+  // read into a fresh vector and rebuild every chunk once, the bounds of a previous load go with it
+  std::vector<glm::vec3> loaded;
+  origin = glm::dvec3(0.0);
+  glm::dvec3 p;
   while (!file.eof()) {
-    if (file >> p.x >> p.y >> p.z)
-      add_point(p);
+    if (file >> p.x >> p.y >> p.z) {
+      if (loaded.empty())
+        origin = origin_near(p);
+      loaded.push_back(glm::vec3(p - origin));
+    }
   }
+  points = std::move(loaded);
+  update_bbox();
 
-SUCCESS:
-  return *this;
-FAIL:
-  throw std::runtime_error("failed to load point.");
   return *this;
 }
 
+uint64_t PointCloud::append_points_from(const std::string& filename, uint64_t offset) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open() || !file.seekg(static_cast<std::streamoff>(offset))) {
+    spdlog::critical("Could not read cloud point from file {} at byte {}", filename, offset);
+    throw std::runtime_error("failed to load point.");
+  }
+  std::string tail { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+  tail.resize(tail.find_last_of('\n') + 1); // npos + 1 is 0, no complete line
+
+  std::vector<glm::vec3> new_points;
+  std::istringstream     lines(tail);
+  glm::dvec3             p;
+  while (lines >> p.x >> p.y >> p.z)
+    new_points.push_back(glm::vec3(p - origin));
+  append_points(new_points);
+  return offset + tail.size();
+}
+
 PointCloud& PointCloud::load_colors(std::string filename) {
   std::ifstream file(filename);
   if (!file.is_open()) {
     spdlog::critical("Could not open cloud color from file {}", filename);
-    goto FAIL;
+    throw std::runtime_error("failed to load point colors.");
   }
 
   colors.clear();
@@ -57,10 +166,6 @@ PointCloud& PointCloud::load_colors(std::string filename) {
       colors.push_back(c);
   }
 
-SUCCESS:
-  return *this;
-FAIL:
-  throw std::runtime_error("failed to load point colors.");
   return *this;
 }
 
@@ -68,7 +173,7 @@ PointCloud& PointCloud::load_normals(std::string filename) {
   std::ifstream file(filename);
   if (!file.is_open()) {
     spdlog::critical("Could not open cloud normal from file {}", filename);
-    goto FAIL;
+    throw std::runtime_error("failed to load point normals.");
   }
 
   normals.clear();
@@ -78,9 +183,247 @@ PointCloud& PointCloud::load_normals(std::string filename) {
       normals.push_back(n);
   }
 
-SUCCESS:
   return *this;
-FAIL:
-  throw std::runtime_error("failed to load point colors.");
+}
+
+PointCloud& PointCloud::load_attribute(std::string filename, const std::string& name) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    spdlog::critical("Could not open cloud attribute from file {}", filename);
+    throw std::runtime_error("failed to load point attribute.");
+  }
+
+  // values go straight into the attribute, its storage grows geometrically like a vector
+  PointAttribute& attribute = attributes.add(name, AttributeType::Float32, 1, 0);
+  size_t          count     = 0;
+  float           value;
+  while (file >> value) {
+    attribute.resize(count + 1);
+    attribute.values<float>()[count++] = value;
+  }
+  return *this;
+}
+
+PointCloud& PointCloud::update_bbox() {
+  refresh_chunks(0, std::max(bounds_leaves, (points.size() + CHUNK_SIZE - 1) / CHUNK_SIZE));
+  return *this;
+}
+
+PointCloud& PointCloud::set_colors_from_normals() {
+  colors.resize(normals.size());
+  parallel_for(0, normals.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      colors[i] = (glm::normalize(normals[i]) + 1.0f) / 2.0f;
+  }, 1 << 16);
+  return *this;
+}
+
+PointCloud& PointCloud::keep_points(const std::vector<uint8_t>& keep) {
+  auto compact = [&](auto& values) {
+    if (values.size() != keep.size())
+      return;
+    size_t kept = 0;
+    for (size_t i = 0; i < values.size(); i++)
+      if (keep[i])
+        values[kept++] = values[i];
+    values.resize(kept);
+  };
+  if (points.size() != keep.size()) {
+    spdlog::error("keep_points: mask has {} entries for {} points", keep.size(), points.size());
+    return *this;
+  }
+  // chunks before the first removed point keep their points and bounds
+  const size_t first_removed = static_cast<size_t>(std::find(keep.begin(), keep.end(), uint8_t(0)) - keep.begin());
+  const size_t chunk_count   = (points.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  compact(colors);
+  compact(normals);
+  for (auto& attribute : attributes)
+    if (attribute.size() == keep.size())
+      attribute.compact(keep);
+  compact(points);
+  refresh_chunks(first_removed / CHUNK_SIZE, chunk_count);
   return *this;
-}
\ No newline at end of file
+}
+
+Bounds PointCloud::get_transformed_bounds(const glm::mat4& transform) const {
+  Bounds result;
+  if (points.empty() || bounds_tree.empty())
+    return result;
+
+  // each face of the box is the maximum of dot(direction, p) over the points: rows of the transform and their negations
+  const glm::vec3 rows[3] = { glm::vec3(transform[0][0], transform[1][0], transform[2][0]),
+                              glm::vec3(transform[0][1], transform[1][1], transform[2][1]),
+                              glm::vec3(transform[0][2], transform[1][2], transform[2][2]) };
+  const glm::vec3 directions[6] = { rows[0], rows[1], rows[2], -rows[0], -rows[1], -rows[2] };
+  auto            upper         = [](const Bounds& b, const glm::vec3& d) {
+    return glm::dot(d, glm::vec3(d.x > 0 ? b.max.x : b.min.x, d.y > 0 ? b.max.y : b.min.y, d.z > 0 ? b.max.z : b.min.z));
+  };
+  auto scan_chunk = [&](size_t chunk, float* best) {
+    for (size_t i = chunk * CHUNK_SIZE; i < std::min(points.size(), (chunk + 1) * CHUNK_SIZE); i++) {
+      for (int k = 0; k < 3; k++) {
+        const float v = glm::dot(rows[k], points[i]);
+        best[k]       = std::max(best[k], v);
+        best[k + 3]   = std::max(best[k + 3], -v);
+      }
+    }
+  };
+
+  // seed every direction with the chunk its greedy descent ends in, then scan only the chunks whose
+  // bounds could still beat the seeds in some direction
+  float best[6];
+  std::fill(best, best + 6, std::numeric_limits<float>::lowest());
+  for (const auto& d : directions) {
+    size_t node = 1;
+    while (node < bounds_leaves) {
+      const Bounds& left  = bounds_tree[2 * node];
+      const Bounds& right = bounds_tree[2 * node + 1];
+      node                = right.empty() || (!left.empty() && upper(left, d) >= upper(right, d)) ? 2 * node : 2 * node + 1;
+    }
+    scan_chunk(node - bounds_leaves, best);
+  }
+
+  const size_t chunk_count = (points.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  std::mutex   mutex;
+  parallel_for(0, chunk_count, [&](size_t begin, size_t end) {
+    float local[6];
+    std::copy(best, best + 6, local);
+    for (size_t c = begin; c < end; c++) {
+      const Bounds& bounds = bounds_tree[bounds_leaves + c];
+      bool          useful = false;
+      for (int k = 0; k < 6 && !useful; k++)
+        useful = upper(bounds, directions[k]) > local[k];
+      if (useful)
+        scan_chunk(c, local);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int k = 0; k < 6; k++)
+      best[k] = std::max(best[k], local[k]);
+  }, 16);
+
+  for (int axis = 0; axis < 3; axis++) {
+    result.max[axis] = best[axis] + transform[3][axis];
+    result.min[axis] = -best[axis + 3] + transform[3][axis];
+  }
+  return result;
+}
+
+/** `origin + offset`, adding the shortest decimal form of `offset` rather than its binary value, so it prints as short */
+static double absolute_coordinate(double origin, float offset) {
+  char text[32];
+  *fmt::format_to_n(text, sizeof(text) - 1, "{}", offset).out = '\0';
+  return origin + std::strtod(text, nullptr);
+}
+
+void PointCloud::save_points(const std::string& filename, const std::vector<uint32_t>& indices) const {
+  const bool                    shifted       = glm::length(origin) > 0.0;
+  const std::vector<glm::vec3>* arrays[3]     = { &points, &colors, &normals };
+  const char*                   extensions[3] = { nullptr, ".colors", ".normals" };
+  for (int k = 0; k < 3; k++) {
+    if (arrays[k]->size() != points.size() || (k > 0 && arrays[k]->empty()))
+      continue;
+    const auto    path = k == 0 ? filename : std::filesystem::path(filename).replace_extension(extensions[k]).string();
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+      spdlog::critical("Could not write point cloud to file {}", path);
+      throw std::runtime_error("failed to save points.");
+    }
+
+    const std::vector<glm::vec3>& values      = *arrays[k];
+    const size_t                  block_size  = 1 << 16;
+    const size_t                  block_count = (indices.size() + block_size - 1) / block_size;
+    std::vector<std::string>      texts(block_count);
+    parallel_for(0, block_count, [&](size_t begin, size_t end) {
+      fmt::memory_buffer buffer;
+      for (size_t block = begin; block < end; block++) {
+        buffer.clear();
+        for (size_t j = block * block_size; j < std::min(indices.size(), (block + 1) * block_size); j++) {
+          const glm::vec3& v = values[indices[j]];
+          if (k == 0 && shifted) {
+            fmt::format_to(std::back_inserter(buffer), "{} {} {}\n", absolute_coordinate(origin.x, v.x), absolute_coordinate(origin.y, v.y),
+                           absolute_coordinate(origin.z, v.z));
+          } else {
+            fmt::format_to(std::back_inserter(buffer), "{} {} {}\n", v.x, v.y, v.z);
+          }
+        }
+        texts[block].assign(buffer.data(), buffer.size());
+      }
+    }, 1);
+    for (const auto& text : texts)
+      file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    // a full disk only shows once the buffered tail is written out
+    if (!file.flush()) {
+      spdlog::critical("Could not write point cloud to file {}", path);
+      throw std::runtime_error("failed to save points.");
+    }
+  }
+}
+
+std::vector<std::pair<size_t, size_t>> PointCloud::select_chunks(const std::function<Coverage(const Bounds&)>& classify) const {
+  std::vector<std::pair<size_t, size_t>> ranges;
+  if (points.empty() || bounds_tree.empty())
+    return ranges;
+
+  // depth first, left to right, so ranges come out sorted and merge with their predecessor
+  std::vector<size_t> stack { 1 };
+  while (!stack.empty()) {
+    const size_t node = stack.back();
+    stack.pop_back();
+    const Bounds& bounds = bounds_tree[node];
+    if (bounds.empty())
+      continue;
+    const Coverage coverage = classify(bounds);
+    if (coverage == Coverage::None)
+      continue;
+    if (coverage == Coverage::Partial && node < bounds_leaves) {
+      stack.push_back(2 * node + 1);
+      stack.push_back(2 * node);
+      continue;
+    }
+    // the chunks below `node` are contiguous
+    size_t first = node, last = node + 1;
+    while (first < bounds_leaves) {
+      first *= 2;
+      last *= 2;
+    }
+    const size_t begin = std::min(points.size(), (first - bounds_leaves) * CHUNK_SIZE);
+    const size_t end   = std::min(points.size(), (last - bounds_leaves) * CHUNK_SIZE);
+    if (begin >= end)
+      continue;
+    if (!ranges.empty() && ranges.back().second == begin)
+      ranges.back().second = end;
+    else
+      ranges.emplace_back(begin, end);
+  }
+  return ranges;
+}
+
+std::shared_ptr<const SpatialIndex> PointCloud::get_index() const {
+  std::lock_guard<std::mutex> lock(index_cache.mutex);
+  if (!index_cache.index)
+    index_cache.index = std::make_shared<const SpatialIndex>(points);
+  return index_cache.index;
+}
+
+IndexSpans PointCloud::query_box(const glm::vec3& min, const glm::vec3& max) const {
+  IndexSpans result { get_index(), {} };
+  result.index->box_search(min, max, result.spans);
+  return result;
+}
+
+IndexSpans PointCloud::query_radius(const glm::vec3& center, float radius) const {
+  IndexSpans result { get_index(), {} };
+  result.index->sphere_search(center, radius, result.spans);
+  return result;
+}
+
+std::vector<SpatialIndex::Neighbour> PointCloud::query_knn(const glm::vec3& query, size_t k) const {
+  std::vector<SpatialIndex::Neighbour> result;
+  get_index()->knn(query, k, result);
+  return result;
+}
+
+std::vector<SpatialIndex::RayHit> PointCloud::query_ray(const glm::vec3& ray_origin, const glm::vec3& direction, float radius, float max_distance) const {
+  std::vector<SpatialIndex::RayHit> result;
+  get_index()->ray_search(ray_origin, direction, radius, max_distance, result);
+  return result;
+}
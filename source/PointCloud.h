@@ -1,34 +1,170 @@
 #pragma once
+#include "Bounds.h"
+#include "PointAttributes.h"
+#include "SpatialIndex.h"
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <tuple>
 #include <vector>
 #include <string>
 #include <optional>
 
+/**
+ * @brief points found by a range query on a `PointCloud`, as spans of indices read in place
+ * @details Holds the spatial index the spans point into, so they stay valid after the cloud changes.
+ */
+struct IndexSpans {
+  std::shared_ptr<const SpatialIndex> index;
+  std::vector<SpatialIndex::Span>     spans;
+
+  /** number of points in all spans */
+  inline size_t size() const {
+    size_t count = 0;
+    for (const auto& span : spans)
+      count += span.size();
+    return count;
+  }
+  /** call `fn(index)` for every point, in tree order */
+  template <typename F>
+  inline void for_each(F&& fn) const {
+    for (const auto& span : spans)
+      for (uint32_t i : span)
+        fn(i);
+  }
+};
+
 /**
  * @brief class to represent a point cloud.
+ * @details The bounding box is kept up to date incrementally: points are grouped in chunks of
+ * `CHUNK_SIZE`, and the chunk bounds are the leaves of a reduction tree whose root is the bbox.
+ * Appends only extend the path to the root; edits and deletes rescan the chunks they touch.
+ * Code writing `points` directly must call `update_bbox` or `update_points` afterwards.
+ *
+ * Points are stored as float offsets from `origin`, kept in double, so georeferenced clouds, e.g.
+ * UTM coordinates in the millions of metres, keep their precision. The loaders pick the origin near
+ * the first point; everything else, bounds and queries included, works on the offsets.
  *
+ * The `query_*` methods answer spatial queries from a kd-tree built on the first query and dropped
+ * by any edit. They are const and may run concurrently from any number of threads, as long as no
+ * thread edits the cloud meanwhile.
  */
 class PointCloud {
+ public:
+  static constexpr size_t CHUNK_SIZE = 4096;
+  /** spacing of the origins the loaders pick, clouds within half of it of zero keep their coordinates as they are */
+  static constexpr double ORIGIN_GRID = 1024.0;
+
  private:
   glm::vec3 bbox[2] { glm::vec3 { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() },
-                      glm::vec3 { std::numeric_limits<float>::min(), std::numeric_limits<float>::min(), std::numeric_limits<float>::min() } };
+                      glm::vec3 { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() } };
+
+  // reduction tree over chunk bounds: node 1 is the root, node i has children 2i and 2i + 1,
+  // chunk c is node `bounds_leaves + c`
+  std::vector<Bounds> bounds_tree;
+  size_t              bounds_leaves { 0 };
+
+  // kd-tree for the queries, built on demand; copies of the cloud start without one
+  struct IndexCache {
+    std::mutex                          mutex;
+    std::shared_ptr<const SpatialIndex> index;
+
+    IndexCache() = default;
+    IndexCache(const IndexCache&) {}
+    IndexCache& operator=(const IndexCache&) {
+      index.reset();
+      return *this;
+    }
+  };
+  mutable IndexCache index_cache;
+
+  /** grow the tree so it has a leaf for every chunk */
+  void reserve_chunks(size_t chunk_count);
+  /** rescan chunks [first, last), clear the leaves of chunks that no longer exist, refresh their ancestors */
+  void refresh_chunks(size_t first, size_t last);
 
  public:
+  glm::dvec3             origin { 0.0 }; // position of the point stored as (0, 0, 0)
   std::vector<glm::vec3> points;
   std::vector<glm::vec3> colors;
   std::vector<glm::vec3> normals;
+  PointAttributes        attributes; // everything else, e.g. intensity or classification
 
  public:
-  /** add single point*/
+  /** add single point, extending the bounds in O(log(chunks)) */
   PointCloud& add_point(const glm::vec3& p);
-  /** load point cloud from file */
+  /** add several points, rescanning only the chunks they land in */
+  PointCloud& append_points(const std::vector<glm::vec3>& new_points);
+  /** the points in [begin, end) were written through `points`, refresh their chunks */
+  PointCloud& update_points(size_t begin, size_t end);
+  /** remove point `i` by moving the last point into its place, with its color, normal and attributes */
+  PointCloud& remove_point(size_t i);
+  /** the origin the loaders pick for a cloud whose first point is `p`: `p` rounded to a multiple of `ORIGIN_GRID` */
+  static inline glm::dvec3 origin_near(const glm::dvec3& p) {
+    return glm::round(p / ORIGIN_GRID) * ORIGIN_GRID;
+  }
+  /**
+   * @brief load point cloud from file, `.ply` files also fill colors, normals and `attributes` from their vertex properties
+   * @details Coordinates are read in double and stored relative to an `origin` picked by `origin_near`.
+   */
   PointCloud& load_points(std::string filename);
+  /**
+   * @brief append the `x y z` lines of a text file from byte `offset` on, e.g. the ones written since it was loaded
+   * @details Points are stored relative to the current `origin`. A last line without its newline
+   * may still be being written and is left out; returns the offset just past the lines read.
+   */
+  uint64_t append_points_from(const std::string& filename, uint64_t offset);
   /** load point color from file */
   PointCloud& load_colors(std::string filename);
   /** load point normals from file */
   PointCloud& load_normals(std::string filename);
+  /** load a `float32` attribute called `name` from file, one value per point */
+  PointCloud& load_attribute(std::string filename, const std::string& name);
+  /** recompute the bounds of every chunk, in parallel */
+  PointCloud& update_bbox();
+  /** color every point by its normal, mapping each component from [-1, 1] to [0, 1] */
+  PointCloud& set_colors_from_normals();
+  /** drop every point whose entry in `keep` is 0, along with its color, normal and attributes, and update the bbox */
+  PointCloud& keep_points(const std::vector<uint8_t>& keep);
+  /**
+   * @brief write the points in `indices` as `x y z` lines, in the format `load_points` reads
+   * @details Positions are written in double with the `origin` added back. Colors and normals, when the cloud has them, go to files next to `filename` with the
+   * `.colors` and `.normals` extensions. Lines are formatted in parallel. Throws `std::runtime_error` when a file cannot be
+   * written completely.
+   */
+  void save_points(const std::string& filename, const std::vector<uint32_t>& indices) const;
+
+  /**
+   * @brief point ranges `[begin, end)` of the chunks selected by `classify`, adjacent chunks merged
+   * @details Walks the chunk bounds tree from the root: a subtree whose bounds `classify` rates
+   * `Coverage::None` is skipped and one rated `Coverage::All` is taken whole without visiting its
+   * chunks, so the cost follows the boundary of the selection rather than the number of chunks.
+   */
+  std::vector<std::pair<size_t, size_t>> select_chunks(const std::function<Coverage(const Bounds&)>& classify) const;
+
+  /** the kd-tree over the points, built by the first caller while concurrent callers wait for it */
+  std::shared_ptr<const SpatialIndex> get_index() const;
+  /** points inside the box [`min`, `max`] */
+  IndexSpans query_box(const glm::vec3& min, const glm::vec3& max) const;
+  /** points within `radius` of `center` */
+  IndexSpans query_radius(const glm::vec3& center, float radius) const;
+  /** the `k` points nearest to `query`, nearest first */
+  std::vector<SpatialIndex::Neighbour> query_knn(const glm::vec3& query, size_t k) const;
+  /** points within `radius` of the first `max_distance` of the ray from `ray_origin` along `direction`, nearest along it first */
+  std::vector<SpatialIndex::RayHit> query_ray(const glm::vec3& ray_origin, const glm::vec3& direction, float radius,
+                                              float max_distance = std::numeric_limits<float>::max()) const;
+
+  /**
+   * @brief exact bounds of the points after the affine `transform`, not just of the transformed bbox corners
+   * @details Each face of the box is the maximum of a linear function over the points. Chunks whose
+   * bounds cannot beat the best value found so far in any direction are skipped, so spatially
+   * coherent clouds, like scans stored in acquisition order, only scan a few chunks; shuffled
+   * clouds fall back to one parallel pass.
+   */
+  Bounds get_transformed_bounds(const glm::mat4& transform) const;
 
   inline const std::vector<glm::vec3>& get_points() const {
     return points;
@@ -0,0 +1,175 @@
+#include "PointPicker.h"
+#include "Shader.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+// compiled after `clip_volume_glsl`
+static const char* idVertexShader = R"(
+layout(location = 0) in vec3 position;
+layout(location = 4) in float spacing; // 0 until computed
+
+uniform mat4 model;
+uniform mat4 mvp;
+uniform uint first_id;
+
+// sized like the point shader of `Window` sizes the drawn splats
+uniform mat4  projection;
+uniform float viewport_height;
+uniform float point_size;
+uniform bool  adaptive;
+uniform float spacing_scale;
+uniform float max_point_size;
+
+flat out uint id;
+
+void main()
+{
+    gl_Position = clip_keeps((model * vec4(position, 1.0)).xyz) ? mvp * vec4(position, 1.0) : vec4(0.0, 0.0, 2.0, 1.0);
+    id          = first_id + uint(gl_VertexID) + 1u;
+
+    // the pick projection only narrows x and y, w is that of the view
+    float pixels_per_unit = projection[1][1] * viewport_height * 0.5 / max(gl_Position.w, 1e-6);
+    float diameter        = adaptive && spacing > 0.0 ? spacing * spacing_scale * pixels_per_unit : point_size;
+    gl_PointSize          = clamp(diameter, 1.0, max_point_size);
+}
+    )";
+
+static const char* idFragmentShader = R"(#version 450 core
+
+layout(location = 0) out uint FragId;
+flat in uint id;
+
+void main()
+{
+    FragId = id;
+}
+    )";
+
+PointPicker::~PointPicker() {
+  if (!initialized)
+    return;
+  if (fence)
+    glDeleteSync(fence);
+  glDeleteBuffers(1, &pixel_buffer);
+  glDeleteProgram(program);
+}
+
+bool PointPicker::init() {
+  if (initialized)
+    return true;
+  const std::string vertex_source = std::string("#version 450 core\n") + clip_volume_glsl + idVertexShader;
+  program                         = create_shader_program(vertex_source.c_str(), idFragmentShader);
+  if (!program)
+    return false;
+  glGenBuffers(1, &pixel_buffer);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+  glBufferData(GL_PIXEL_PACK_BUFFER, REGION * REGION * sizeof(GLuint), nullptr, GL_STREAM_READ);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  initialized = true;
+  return true;
+}
+
+void PointPicker::request(const std::vector<PickDraw>& draws, const glm::mat4& view_projection, const std::vector<ClipVolume>& clip_volumes, const PickPointSize& size,
+                          int viewport_width, int viewport_height, int x, int y) {
+  if (!initialized)
+    return;
+  if (fence) {
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  // points are dropped when their center is clipped, the margin keeps those whose splat reaches the region
+  const float largest = std::max(1.0f, size.adaptive ? size.max_point_size : std::min(size.point_size, size.max_point_size));
+  const int   margin  = static_cast<int>(std::ceil(largest / 2.0f));
+  const int   window  = REGION + 2 * margin;
+  target.resize(window, window);
+
+  // narrow the projection to the window around (x, y): one window pixel is still one screen pixel
+  const float scale_x  = static_cast<float>(viewport_width) / static_cast<float>(window);
+  const float scale_y  = static_cast<float>(viewport_height) / static_cast<float>(window);
+  const float center_x = 2.0f * (static_cast<float>(x) + 0.5f) / static_cast<float>(viewport_width) - 1.0f;
+  const float center_y = 2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(viewport_height) - 1.0f;
+  glm::mat4   pick(1.0f);
+  pick[0][0] = scale_x;
+  pick[1][1] = scale_y;
+  pick[3][0] = -center_x * scale_x;
+  pick[3][1] = -center_y * scale_y;
+
+  GLint previous_framebuffer, previous_viewport[4];
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+  glGetIntegerv(GL_VIEWPORT, previous_viewport);
+
+  target.bind();
+  const GLuint  no_point = 0;
+  const GLfloat far      = 1.0f;
+  glClearBufferuiv(GL_COLOR, 0, &no_point);
+  glClearBufferfv(GL_DEPTH, 0, &far);
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_PROGRAM_POINT_SIZE);
+  glUseProgram(program);
+  clip_set_uniforms(program, clip_volumes);
+  shader_set_uniform(program, "projection", size.projection);
+  shader_set_uniform(program, "viewport_height", static_cast<float>(viewport_height));
+  shader_set_uniform(program, "point_size", size.point_size);
+  shader_set_uniform(program, "adaptive", size.adaptive);
+  shader_set_uniform(program, "spacing_scale", size.spacing_scale);
+  shader_set_uniform(program, "max_point_size", size.max_point_size);
+  for (const PickDraw& draw : draws) {
+    shader_set_uniform(program, "model", draw.model);
+    shader_set_uniform(program, "mvp", pick * view_projection * draw.model);
+    shader_set_uniform(program, "first_id", static_cast<GLuint>(draw.first_id));
+    glBindVertexArray(draw.vao);
+    glDrawArrays(GL_POINTS, 0, draw.count);
+  }
+  glBindVertexArray(0);
+  glDisable(GL_PROGRAM_POINT_SIZE);
+
+  // asynchronous copy into the pixel buffer, mapped by `poll` once the fence has passed
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, target.get_framebuffer());
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(margin, margin, REGION, REGION, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+
+  glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+  glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+}
+
+bool PointPicker::poll() {
+  if (!fence)
+    return false;
+  GLenum status = glClientWaitSync(fence, 0, 0);
+  if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    return false;
+  glDeleteSync(fence);
+  fence = nullptr;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+  const auto* ids = static_cast<const GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, REGION * REGION * sizeof(GLuint), GL_MAP_READ_BIT));
+  result.reset();
+  if (ids) {
+    // the nearest point in depth wins each pixel, the pixel nearest to the cursor wins the window
+    int best = std::numeric_limits<int>::max();
+    for (int j = 0; j < REGION; j++) {
+      for (int i = 0; i < REGION; i++) {
+        const GLuint id = ids[j * REGION + i];
+        const int    d2 = (i - REGION / 2) * (i - REGION / 2) + (j - REGION / 2) * (j - REGION / 2);
+        if (id != 0 && d2 < best) {
+          best   = d2;
+          result = id - 1;
+        }
+      }
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  } else {
+    spdlog::error("[OpenGL] could not map the picking buffer");
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "ClipVolume.h"
+#include "RenderTarget.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/** @brief points drawn by a pick request, their ids start at `first_id` */
+struct PickDraw {
+  GLuint    vao;
+  GLsizei   count;
+  glm::mat4 model;
+  uint32_t  first_id;
+};
+
+/** @brief how the points of a pick request are sized, the same as the point shader sizes them when drawn */
+struct PickPointSize {
+  float     point_size { 1.0f };      // pixels, unless adaptive and the spacing is known
+  bool      adaptive { false };       // size from the spacing slot, location 4 of each draw's VAO, in world units
+  float     spacing_scale { 1.0f };   // splat diameter over the spacing
+  float     max_point_size { 32.0f }; // pixels, bounds every point like the point shader does
+  glm::mat4 projection { 1.0f };      // of the view, gives the pixels a world length covers
+};
+
+/**
+ * @brief finds the point under the cursor by rendering point indices into an integer buffer.
+ * @details Only a `REGION` x `REGION` pixel window around the cursor is rasterized: the projection
+ * is narrowed to it, plus a margin of half the largest splat so splats centered outside the window
+ * still cover it, so the pass costs one vertex pass over the cloud and almost no fill. Each pixel
+ * holds `index + 1` of the nearest point, 0 where there is none. The window is copied into a pixel
+ * buffer object behind a fence and `poll` maps it once the GPU is done, so picking never waits on
+ * the GPU; the point closest to the cursor is the result. Several clouds are picked at once by
+ * giving each draw its own range of ids.
+ *
+ * Usage:
+ * ```cpp
+ * PointPicker picker;
+ * if (picker.init())
+ *   picker.request({ { vao, count, model, 0 } }, projection * view, clip_volumes, { point_size }, viewport_width, viewport_height, x, y);
+ * // later frames
+ * if (picker.poll() && picker.get_result())
+ *   inspect(*picker.get_result());
+ * ```
+ */
+class PointPicker {
+ public:
+  static constexpr int REGION = 15; // pixels, odd so the cursor is the center pixel
+
+ private:
+  GLuint                  program { 0 };
+  GLuint                  pixel_buffer { 0 };
+  GLsync                  fence { nullptr };
+  RenderTarget            target { GL_R32UI };
+  std::optional<uint32_t> result;
+  bool                    initialized { false };
+
+ public:
+  PointPicker() = default;
+  ~PointPicker();
+
+  PointPicker(const PointPicker&)            = delete;
+  PointPicker& operator=(const PointPicker&) = delete;
+
+  /** compile the id shader and allocate the pixel buffer */
+  bool init();
+
+  /**
+   * @brief render the ids of the points of `draws` around pixel (`x`, `y`) and start the readback
+   * @details (`x`, `y`) is relative to the lower-left corner of a viewport of the given size, the
+   * one each draw is drawn into with `view_projection * model`. Point `i` of a draw gets the id
+   * `first_id + i`, sized by `size`. Points hidden by `clip_volumes` cannot be picked. Replaces a request still in
+   * flight. The framebuffer and viewport are restored afterwards.
+   */
+  void request(const std::vector<PickDraw>& draws, const glm::mat4& view_projection, const std::vector<ClipVolume>& clip_volumes, const PickPointSize& size,
+               int viewport_width, int viewport_height, int x, int y);
+
+  /** true once, when the result of the last request has arrived; never blocks */
+  bool poll();
+
+  inline bool                           is_pending() const { return fence != nullptr; }
+  /** id of the picked point, empty when no point was under the cursor */
+  inline const std::optional<uint32_t>& get_result() const { return result; }
+};
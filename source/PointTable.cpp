@@ -0,0 +1,261 @@
+#include "PointTable.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <imgui.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+static constexpr uint32_t NO_POINT = std::numeric_limits<uint32_t>::max();
+static constexpr uint32_t NAN_KEY  = std::numeric_limits<uint32_t>::max();
+
+/** map `value` to an unsigned key with the same order, NaN last */
+static uint32_t sortable_bits(float value) {
+  if (std::isnan(value))
+    return NAN_KEY;
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+/** sort `keys` with one `std::sort` per block on the pool, then merge the blocks pairwise */
+static void parallel_sort(std::vector<uint64_t>& keys) {
+  const size_t count       = keys.size();
+  const size_t block_count = std::min<size_t>(ThreadPool::global().size() * 4, std::max<size_t>(1, count / 65536));
+  const size_t block_size  = (count + block_count - 1) / std::max<size_t>(block_count, 1);
+  parallel_for(0, block_count, [&](size_t begin, size_t end) {
+    for (size_t b = begin; b < end; b++)
+      std::sort(keys.begin() + static_cast<ptrdiff_t>(std::min(count, b * block_size)), keys.begin() + static_cast<ptrdiff_t>(std::min(count, (b + 1) * block_size)));
+  }, 1);
+  for (size_t width = block_size; width < count; width *= 2) {
+    const size_t pairs = (count + 2 * width - 1) / (2 * width);
+    parallel_for(0, pairs, [&](size_t begin, size_t end) {
+      for (size_t p = begin; p < end; p++) {
+        const size_t first  = p * 2 * width;
+        const size_t middle = std::min(count, first + width);
+        const size_t last   = std::min(count, first + 2 * width);
+        std::inplace_merge(keys.begin() + static_cast<ptrdiff_t>(first), keys.begin() + static_cast<ptrdiff_t>(middle), keys.begin() + static_cast<ptrdiff_t>(last));
+      }
+    }, 1);
+  }
+}
+
+PointTable::~PointTable() {
+  invalidate();
+}
+
+void PointTable::invalidate() {
+  if (pending_cancelled)
+    *pending_cancelled = true;
+  if (pending_rows.valid())
+    pending_rows.wait();
+  for (auto& abandoned : abandoned_rows)
+    abandoned.wait();
+  pending_rows = {};
+  abandoned_rows.clear();
+  rows.clear();
+  identity_order = true;
+  cloud          = nullptr;
+}
+
+void PointTable::refresh(const PointCloud& cloud_, const glm::mat4& model_) {
+  const bool same_cloud = cloud == &cloud_ && cloud_size == cloud_.points.size();
+  if (same_cloud && model == model_)
+    return;
+  cloud      = &cloud_;
+  cloud_size = cloud_.points.size();
+  model      = model_;
+
+  columns.clear();
+  columns.push_back({ "Index", Source::Index, 0 });
+  for (int c = 0; c < 3; c++)
+    columns.push_back({ std::string(1, "XYZ"[c]), Source::Position, c });
+  if (cloud_.colors.size() == cloud_size)
+    for (int c = 0; c < 3; c++)
+      columns.push_back({ std::string(1, "RGB"[c]), Source::Color, c });
+  if (cloud_.normals.size() == cloud_size)
+    for (int c = 0; c < 3; c++)
+      columns.push_back({ std::string("N") + "XYZ"[c], Source::Normal, c });
+  for (size_t a = 0; a < cloud_.attributes.size() && columns.size() < static_cast<size_t>(MAX_COLUMNS); a++)
+    columns.push_back({ cloud_.attributes[a].get_name(), Source::Attribute, static_cast<int>(a) });
+  filter_column = std::min(filter_column, static_cast<int>(columns.size()) - 1);
+
+  cache_index.assign(CACHE_SLOTS, NO_POINT);
+  cache_text.resize(static_cast<size_t>(CACHE_SLOTS) * MAX_COLUMNS * CELL_SIZE);
+  // positions are shown transformed, so a new model reorders a table sorted or filtered by them
+  rebuild_rows();
+}
+
+double PointTable::value(const PointCloud& cloud, const glm::mat4& model, const Column& column, uint32_t i) {
+  switch (column.source) {
+  case Source::Index:
+    return i;
+  case Source::Position:
+    return (model * glm::vec4(cloud.points[i], 1.0f))[column.component];
+  case Source::Color:
+    return i < cloud.colors.size() ? cloud.colors[i][column.component] : std::nan("");
+  case Source::Normal:
+    return i < cloud.normals.size() ? cloud.normals[i][column.component] : std::nan("");
+  case Source::Attribute: {
+    const auto attribute = static_cast<size_t>(column.component);
+    if (attribute < cloud.attributes.size() && i < cloud.attributes[attribute].size())
+      return cloud.attributes[attribute].get(i, 0);
+    return std::nan("");
+  }
+  }
+  return std::nan("");
+}
+
+const char* PointTable::row_text(uint32_t i) {
+  const size_t slot = i % CACHE_SLOTS;
+  char*        text = cache_text.data() + slot * MAX_COLUMNS * CELL_SIZE;
+  if (cache_index[slot] == i)
+    return text;
+  for (size_t c = 0; c < columns.size(); c++) {
+    char*        cell = text + c * CELL_SIZE;
+    const double v    = value(*cloud, model, columns[c], i);
+    if (columns[c].source == Source::Index)
+      std::snprintf(cell, CELL_SIZE, "%u", i);
+    else if (std::isnan(v))
+      std::snprintf(cell, CELL_SIZE, "-");
+    else
+      std::snprintf(cell, CELL_SIZE, "%g", v);
+  }
+  cache_index[slot] = i;
+  return text;
+}
+
+void PointTable::rebuild_rows() {
+  if (pending_rows.valid()) {
+    *pending_cancelled = true;
+    abandoned_rows.push_back(std::move(pending_rows));
+  }
+  identity_order = !filtered && (sort_column < 0 || (sort_column == 0 && !sort_descending));
+  if (identity_order) {
+    rows.clear();
+    return;
+  }
+
+  // the task works on copies of the settings, the table may change them while it runs
+  pending_cancelled = std::make_shared<std::atomic<bool>>(false);
+  const Column sort_by    = sort_column >= 0 ? columns[static_cast<size_t>(sort_column)] : columns[0];
+  const Column filter_by  = columns[static_cast<size_t>(filter_column)];
+  const float  range_min  = filter_range[0];
+  const float  range_max  = filter_range[1];
+  const bool   filter     = filtered;
+  const bool   descending = sort_descending;
+  pending_rows = ThreadPool::global().submit([cloud = cloud, model = model, sort_by, filter_by, range_min, range_max, filter, descending, cancelled = pending_cancelled]() {
+    PROFILE_SCOPE("point table rows");
+    const size_t count = cloud->points.size();
+
+    // one (key, index) pair per kept point: sorting the pairs is stable by index for free
+    std::vector<uint64_t> keys(count);
+    std::vector<uint8_t>  keep(count, 1);
+    parallel_for(0, count, [&](size_t begin, size_t end) {
+      if (*cancelled)
+        return;
+      for (size_t i = begin; i < end; i++) {
+        const auto index = static_cast<uint32_t>(i);
+        if (filter) {
+          const double v = value(*cloud, model, filter_by, index);
+          keep[i]        = v >= range_min && v <= range_max;
+        }
+        uint32_t key = sort_by.source == Source::Index ? index : sortable_bits(static_cast<float>(value(*cloud, model, sort_by, index)));
+        if (descending && key != NAN_KEY)
+          key = ~key;
+        keys[i] = static_cast<uint64_t>(key) << 32 | index;
+      }
+    });
+    if (*cancelled)
+      return std::vector<uint32_t> {};
+    if (filter) {
+      size_t kept = 0;
+      for (size_t i = 0; i < count; i++)
+        if (keep[i])
+          keys[kept++] = keys[i];
+      keys.resize(kept);
+    }
+    parallel_sort(keys);
+
+    std::vector<uint32_t> order(keys.size());
+    parallel_for(0, keys.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
+        order[i] = static_cast<uint32_t>(keys[i]);
+    });
+    return order;
+  });
+}
+
+std::optional<uint32_t> PointTable::draw(const PointCloud& cloud_, const glm::mat4& model_, std::optional<uint32_t> selected) {
+  refresh(cloud_, model_);
+
+  abandoned_rows.erase(std::remove_if(abandoned_rows.begin(), abandoned_rows.end(), [](auto& f) { return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }),
+                       abandoned_rows.end());
+  if (pending_rows.valid() && pending_rows.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    rows = pending_rows.get();
+
+  // filter by one column, applied on demand since it walks every point
+  if (ImGui::BeginCombo("Filter Column", columns[static_cast<size_t>(filter_column)].name.c_str())) {
+    for (size_t c = 0; c < columns.size(); c++)
+      if (ImGui::Selectable(columns[c].name.c_str(), static_cast<int>(c) == filter_column))
+        filter_column = static_cast<int>(c);
+    ImGui::EndCombo();
+  }
+  const float speed = std::max(std::abs(filter_range[1] - filter_range[0]), 1e-3f) * 0.005f;
+  ImGui::DragFloatRange2("Filter Range", &filter_range[0], &filter_range[1], speed);
+  if (ImGui::Button("Apply Filter")) {
+    filtered = true;
+    rebuild_rows();
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear Filter") && filtered) {
+    filtered = false;
+    rebuild_rows();
+  }
+
+  const size_t row_count = identity_order ? cloud_size : rows.size();
+  if (pending_rows.valid())
+    ImGui::Text("%zu of %zu points, sorting...", row_count, cloud_size);
+  else
+    ImGui::Text("%zu of %zu points", row_count, cloud_size);
+
+  std::optional<uint32_t> clicked;
+  const ImGuiTableFlags   flags = ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV
+                              | ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable | ImGuiTableFlags_SortTristate;
+  if (!ImGui::BeginTable("points", static_cast<int>(columns.size()), flags, ImVec2(0.0f, 300.0f)))
+    return clicked;
+  ImGui::TableSetupScrollFreeze(1, 1);
+  for (size_t c = 0; c < columns.size(); c++)
+    ImGui::TableSetupColumn(columns[c].name.c_str(), c == 0 ? ImGuiTableColumnFlags_DefaultSort : ImGuiTableColumnFlags_None);
+  ImGui::TableHeadersRow();
+
+  if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs(); sort_specs && sort_specs->SpecsDirty) {
+    sort_column     = sort_specs->SpecsCount > 0 ? sort_specs->Specs[0].ColumnIndex : -1;
+    sort_descending = sort_specs->SpecsCount > 0 && sort_specs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+    rebuild_rows();
+    sort_specs->SpecsDirty = false;
+  }
+
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(std::min<size_t>(row_count, std::numeric_limits<int>::max())));
+  while (clipper.Step()) {
+    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+      const uint32_t i = identity_order ? static_cast<uint32_t>(row) : rows[static_cast<size_t>(row)];
+      if (i >= cloud_size)
+        continue;
+      const char* text = row_text(i);
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      if (ImGui::Selectable(text, selected == i, ImGuiSelectableFlags_SpanAllColumns))
+        clicked = i;
+      for (size_t c = 1; c < columns.size(); c++) {
+        ImGui::TableSetColumnIndex(static_cast<int>(c));
+        ImGui::TextUnformatted(text + c * CELL_SIZE);
+      }
+    }
+  }
+  ImGui::EndTable();
+  return clicked;
+}
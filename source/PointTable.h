@@ -0,0 +1,86 @@
+#pragma once
+#include "PointCloud.h"
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <future>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief scrollable table of every point of a cloud, for the Properties panel.
+ * @details Rows are virtualized with `ImGuiListClipper`, so only the visible rows are formatted,
+ * and formatted rows are kept in a small direct-mapped cache until the cloud or the model changes.
+ * Columns are the index, the position after `model`, the colors, the normals and the first
+ * component of every attribute. Sorting by a column header and filtering by a value range build a
+ * row order on a pool thread; the table keeps showing the previous order until it is ready.
+ *
+ * Usage:
+ * ```cpp
+ * PointTable table;
+ * if (auto clicked = table.draw(point_cloud, model, selected))
+ *   selected = clicked;
+ * ```
+ */
+class PointTable {
+ public:
+  static constexpr int MAX_COLUMNS = 32;
+  static constexpr int CELL_SIZE   = 24;  // bytes per formatted cell, including the terminator
+  static constexpr int CACHE_SLOTS = 256; // formatted rows kept, indexed by point index
+
+ private:
+  enum class Source { Index, Position, Color, Normal, Attribute };
+  struct Column {
+    std::string name;
+    Source      source;
+    int         component; // axis for positions, colors and normals; attribute index for attributes
+  };
+
+  // what the columns and the cached text were built for
+  const PointCloud* cloud { nullptr };
+  size_t            cloud_size { 0 };
+  glm::mat4         model { 1.0f };
+
+  std::vector<Column> columns;
+
+  // rows in display order, empty with `identity_order` when neither sorted nor filtered
+  std::vector<uint32_t>              rows;
+  bool                               identity_order { true };
+  std::future<std::vector<uint32_t>> pending_rows;
+  std::shared_ptr<std::atomic<bool>> pending_cancelled;
+  // replaced before they finished, still reading the cloud
+  std::vector<std::future<std::vector<uint32_t>>> abandoned_rows;
+
+  int   sort_column { -1 };
+  bool  sort_descending { false };
+  int   filter_column { 1 };
+  float filter_range[2] { 0.0f, 0.0f };
+  bool  filtered { false };
+
+  std::vector<uint32_t> cache_index; // point index held by each slot, UINT32_MAX for none
+  std::vector<char>     cache_text;  // CACHE_SLOTS x MAX_COLUMNS x CELL_SIZE
+
+  /** rebuild the columns and drop every cached row when the cloud or the model changed */
+  void refresh(const PointCloud& cloud_, const glm::mat4& model_);
+  /** value of `column` for point `i` as shown, NaN when the point has none */
+  static double value(const PointCloud& cloud, const glm::mat4& model, const Column& column, uint32_t i);
+  /** formatted cells of point `i`, from the cache when possible */
+  const char* row_text(uint32_t i);
+  /** start building the row order for the current sort and filter on a pool thread */
+  void rebuild_rows();
+
+ public:
+  PointTable() = default;
+  ~PointTable();
+
+  PointTable(const PointTable&)            = delete;
+  PointTable& operator=(const PointTable&) = delete;
+
+  /** drop the row order and the cached rows, call when the points change */
+  void invalidate();
+
+  /** draw the filter controls and the table, highlighting `selected`; returns the point whose row was clicked */
+  std::optional<uint32_t> draw(const PointCloud& cloud_, const glm::mat4& model_, std::optional<uint32_t> selected = std::nullopt);
+};
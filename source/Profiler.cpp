@@ -0,0 +1,123 @@
+#include "Profiler.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+Profiler& Profiler::global() {
+  static Profiler profiler;
+  return profiler;
+}
+
+uint32_t Profiler::current_track() {
+  // small stable numbers read better in trace viewers than hashed thread ids
+  static std::atomic<uint32_t> next_track { 1 };
+  thread_local uint32_t        track = next_track++;
+  return track;
+}
+
+void Profiler::record_cpu(std::string_view name, double start_us, double duration_us) {
+  record(name, start_us, duration_us, current_track(), false);
+}
+
+void Profiler::record_gpu(std::string_view name, double start_us, double duration_us) {
+  record(name, start_us, duration_us, 0, true);
+}
+
+void Profiler::record(std::string_view name, double start_us, double duration_us, uint32_t track, bool gpu) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto                        it = zones.find(name);
+  if (it == zones.end()) {
+    it = zones.emplace(std::string(name), Zone {}).first;
+    it->second.samples.reserve(HISTORY_SIZE);
+    it->second.gpu = gpu;
+  }
+  Zone& zone = it->second;
+  if (zone.samples.size() < HISTORY_SIZE)
+    zone.samples.push_back(duration_us / 1000.0);
+  else
+    zone.samples[zone.next] = duration_us / 1000.0;
+  zone.next = (zone.next + 1) % HISTORY_SIZE;
+
+  trace.push_back(Event { it->first, start_us, duration_us, track });
+  if (trace.size() > TRACE_SIZE)
+    trace.pop_front();
+}
+
+Profiler::Stats Profiler::get_stats(std::string_view name) const {
+  std::vector<double> samples;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto                        it = zones.find(name);
+    if (it == zones.end())
+      return {};
+    samples = it->second.samples;
+  }
+  if (samples.empty())
+    return {};
+
+  Stats stats;
+  stats.count = samples.size();
+  for (double s : samples)
+    stats.mean += s;
+  stats.mean /= static_cast<double>(samples.size());
+
+  auto percentile = [&](double p) {
+    auto nth = samples.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+  };
+  stats.p50 = percentile(0.50);
+  stats.p95 = percentile(0.95);
+  stats.p99 = percentile(0.99);
+  return stats;
+}
+
+std::vector<std::pair<std::string, bool>> Profiler::get_zones() const {
+  std::lock_guard<std::mutex>               lock(mutex);
+  std::vector<std::pair<std::string, bool>> names;
+  names.reserve(zones.size());
+  for (const auto& [name, zone] : zones)
+    names.emplace_back(name, zone.gpu);
+  return names;
+}
+
+void write_json_string(std::ostream& out, std::string_view str) {
+  out << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      // JSON allows no raw control characters inside strings
+      static const char hex[] = "0123456789abcdef";
+      out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+bool Profiler::export_chrome_trace(const std::string& filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    spdlog::error("Could not write trace to file {}", filename);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  file << std::fixed << std::setprecision(3);
+  file << "{\"traceEvents\":[\n";
+  file << R"({"name":"thread_name","ph":"M","pid":1,"tid":0,"args":{"name":"GPU"}})";
+  for (const Event& event : trace) {
+    file << ",\n{\"name\":";
+    write_json_string(file, event.name);
+    file << ",\"cat\":\"" << (event.track == 0 ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1"
+         << ",\"tid\":" << event.track << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us << "}";
+  }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  spdlog::info("Wrote {} trace events to {}", trace.size(), filename);
+  return true;
+}
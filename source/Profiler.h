@@ -0,0 +1,109 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief collects timed zones, keeps a rolling window of samples per zone and a trace of recent events.
+ * @details CPU zones are usually recorded with `PROFILE_SCOPE`, GPU zones by `GpuTimer`. Recording is
+ * thread-safe, so loaders running on the thread pool can be profiled too.
+ *
+ * Usage:
+ * ```cpp
+ * {
+ *   PROFILE_SCOPE("load_points");
+ *   point_cloud.load_points(filename);
+ * }
+ * auto stats = Profiler::global().get_stats("load_points");
+ * Profiler::global().export_chrome_trace("trace.json");
+ * ```
+ */
+class Profiler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t HISTORY_SIZE = 240;    // samples kept per zone for the percentiles
+  static constexpr size_t TRACE_SIZE   = 200000; // events kept for trace export
+
+  struct Stats {
+    double p50 { 0 }, p95 { 0 }, p99 { 0 }, mean { 0 }; // milliseconds
+    size_t count { 0 };
+  };
+
+  /** a zone on track `track`: 0 for the GPU, otherwise a small per-thread number */
+  struct Event {
+    std::string name;
+    double      start_us;
+    double      duration_us;
+    uint32_t    track;
+  };
+
+ private:
+  struct Zone {
+    std::vector<double> samples; // ring buffer, milliseconds
+    size_t              next { 0 };
+    bool                gpu { false };
+  };
+
+  mutable std::mutex                      mutex;
+  std::map<std::string, Zone, std::less<>> zones;
+  std::deque<Event>                       trace;
+  Clock::time_point                       epoch { Clock::now() };
+
+  static uint32_t current_track();
+
+ public:
+  /** the process-wide profiler */
+  static Profiler& global();
+
+  /** microseconds since the profiler was created, the time base of every event */
+  inline double now_us() const {
+    return std::chrono::duration<double, std::micro>(Clock::now() - epoch).count();
+  }
+
+  /** record a zone that ran on the calling thread */
+  void record_cpu(std::string_view name, double start_us, double duration_us);
+  /** record a zone measured on the GPU, `start_us` is the CPU time the work was submitted */
+  void record_gpu(std::string_view name, double start_us, double duration_us);
+
+  /** percentiles over the last `HISTORY_SIZE` samples of `name` */
+  Stats get_stats(std::string_view name) const;
+  /** names of all zones recorded so far, GPU zones flagged with `true` */
+  std::vector<std::pair<std::string, bool>> get_zones() const;
+
+  /** write the recent events in Chrome's trace event format, viewable in chrome://tracing or Perfetto */
+  bool export_chrome_trace(const std::string& filename) const;
+
+ private:
+  void record(std::string_view name, double start_us, double duration_us, uint32_t track, bool gpu);
+};
+
+/** @brief records the lifetime of the scope as a CPU zone */
+class ProfileScope {
+ private:
+  std::string_view name;
+  double           start_us;
+
+ public:
+  explicit ProfileScope(std::string_view name_)
+      : name { name_ }
+      , start_us { Profiler::global().now_us() } {}
+  ~ProfileScope() {
+    Profiler::global().record_cpu(name, start_us, Profiler::global().now_us() - start_us);
+  }
+  ProfileScope(const ProfileScope&)            = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+/** write `str` as a quoted JSON string, escaping quotes, backslashes and control characters */
+void write_json_string(std::ostream& out, std::string_view str);
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name)   ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
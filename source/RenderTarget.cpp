@@ -0,0 +1,67 @@
+#include "RenderTarget.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+void RenderTarget::release() {
+  if (framebuffer)
+    glDeleteFramebuffers(1, &framebuffer);
+  if (color_texture)
+    glDeleteTextures(1, &color_texture);
+  if (depth_texture)
+    glDeleteTextures(1, &depth_texture);
+  framebuffer = color_texture = depth_texture = 0;
+}
+
+bool RenderTarget::resize(int width_, int height_) {
+  width_  = std::max(1, width_);
+  height_ = std::max(1, height_);
+  if (framebuffer && width_ == width && height_ == height)
+    return false;
+  release();
+  width  = width_;
+  height = height_;
+
+  // integer attachments must be specified with an integer pixel format even without data
+  GLenum pixel_format = GL_RGBA, pixel_type = GL_UNSIGNED_BYTE;
+  if (color_format == GL_R32UI) {
+    pixel_format = GL_RED_INTEGER;
+    pixel_type   = GL_UNSIGNED_INT;
+  } else if (color_format == GL_RGBA16F || color_format == GL_RGBA32F) {
+    pixel_type = GL_FLOAT;
+  }
+
+  glGenTextures(1, &color_texture);
+  glBindTexture(GL_TEXTURE_2D, color_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, color_format, width, height, 0, pixel_format, pixel_type, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glGenTextures(1, &depth_texture);
+  glBindTexture(GL_TEXTURE_2D, depth_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_texture, 0);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    spdlog::error("[OpenGL] render target {}x{} is incomplete", width, height);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  return true;
+}
+
+void RenderTarget::bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(0, 0, width, height);
+}
+
+void RenderTarget::unbind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+
+/**
+ * @brief offscreen framebuffer with one color texture and a depth texture.
+ *
+ * Usage:
+ * ```cpp
+ * RenderTarget target(GL_RGBA8);
+ * target.resize(width, height);
+ * target.bind();
+ * // ... draw ...
+ * RenderTarget::unbind();
+ * ```
+ */
+class RenderTarget {
+ private:
+  GLenum color_format;
+  GLuint framebuffer { 0 };
+  GLuint color_texture { 0 };
+  GLuint depth_texture { 0 };
+  int    width { 0 }, height { 0 };
+
+  void release();
+
+ public:
+  /** @param color_format_ sized internal format of the color attachment, e.g. `GL_RGBA8` or `GL_R32UI` */
+  explicit RenderTarget(GLenum color_format_ = GL_RGBA8)
+      : color_format { color_format_ } {}
+  ~RenderTarget() { release(); }
+
+  RenderTarget(const RenderTarget&)            = delete;
+  RenderTarget& operator=(const RenderTarget&) = delete;
+
+  /** reallocate the attachments, returns false when the size is unchanged */
+  bool resize(int width_, int height_);
+  /** bind as the draw and read framebuffer and set the viewport to cover it */
+  void bind() const;
+  /** bind the default framebuffer again */
+  static void unbind();
+
+  inline GLuint get_framebuffer() const { return framebuffer; }
+  inline GLuint get_color_texture() const { return color_texture; }
+  inline GLuint get_depth_texture() const { return depth_texture; }
+  inline int    get_width() const { return width; }
+  inline int    get_height() const { return height; }
+};
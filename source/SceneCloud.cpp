@@ -0,0 +1,296 @@
+#include "SceneCloud.h"
+#include "OutlierRemoval.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "SoftwareRasterizer.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <numeric>
+#include <random>
+
+SceneCloud::SceneCloud(std::string name_, PointCloud cloud_)
+    : name { std::move(name_) }
+    , cloud { std::move(cloud_) } {
+  choose_shading();
+}
+
+SceneCloud::~SceneCloud() {
+  release();
+}
+
+void SceneCloud::release() {
+  if (order_buffer)
+    glDeleteBuffers(1, &order_buffer);
+  if (baked_color_vbo)
+    glDeleteBuffers(1, &baked_color_vbo);
+  if (vao) {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(5, vbo);
+  }
+  vao                     = 0;
+  order_buffer            = 0;
+  baked_color_vbo         = 0;
+  baked_color_vbo_version = 0;
+  spacing_uploaded        = false;
+  std::fill(std::begin(vbo), std::end(vbo), 0u);
+}
+
+void SceneCloud::invalidate() {
+  points_version++;
+  clip_ranges_version = UINT64_MAX;
+  bound_attribute     = -1;
+  if (order_buffer) {
+    glDeleteBuffers(1, &order_buffer);
+    order_buffer = 0;
+  }
+  // the spacing buffer no longer has one value per point, it reads as 0 until computed again
+  if (spacing_uploaded) {
+    glBindVertexArray(vao);
+    glDisableVertexAttribArray(4);
+    glBindVertexArray(0);
+    spacing_uploaded = false;
+  }
+}
+
+void SceneCloud::replace(PointCloud cloud_) {
+  cloud = std::move(cloud_);
+  release();
+  invalidate();
+  capacity = 0;
+  const size_t point_count = size();
+  const bool   supported   = shading.mode == Shading::Height || (shading.mode == Shading::Rgb && cloud.colors.size() == point_count) ||
+                         (shading.mode == Shading::Normal && cloud.normals.size() == point_count) ||
+                         (shading.mode == Shading::Scalar && static_cast<size_t>(shading.attribute) < cloud.attributes.size());
+  if (!supported)
+    choose_shading();
+}
+
+void SceneCloud::append(PointCloud tail) {
+  const size_t first = size();
+  const size_t count = tail.points.size();
+  if (first == 0) {
+    replace(std::move(tail));
+    return;
+  }
+  if (count == 0)
+    return;
+  auto extend = [&](std::vector<glm::vec3>& values, const std::vector<glm::vec3>& tail_values) {
+    if (values.size() != first)
+      return;
+    if (tail_values.size() == count)
+      values.insert(values.end(), tail_values.begin(), tail_values.end());
+    else
+      values.resize(first + count, glm::vec3(0.0f));
+  };
+  extend(cloud.colors, tail.colors);
+  extend(cloud.normals, tail.normals);
+  for (auto& attribute : cloud.attributes)
+    if (attribute.size() == first)
+      attribute.resize(first + count);
+  cloud.append_points(tail.points);
+  invalidate();
+  if (!vao)
+    return;
+  if (first + count > capacity) {
+    capacity = (first + count) * 3 / 2;
+    release();
+    return;
+  }
+  // only the arrays `upload` enabled, they kept one value per point
+  auto upload_tail = [&](GLuint location, const std::vector<glm::vec3>& values) {
+    if (values.size() != first + count)
+      return;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[location]);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first * sizeof(glm::vec3)), static_cast<GLsizeiptr>(count * sizeof(glm::vec3)), &values[first]);
+  };
+  upload_tail(0, cloud.points);
+  upload_tail(1, cloud.colors);
+  upload_tail(2, cloud.normals);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SceneCloud::choose_shading() {
+  // start with the most specific data that was loaded
+  const size_t point_count = size();
+  if (point_count > 0 && cloud.colors.size() == point_count)
+    shading.mode = Shading::Rgb;
+  else if (point_count > 0 && !cloud.attributes.empty())
+    shading.mode = Shading::Scalar;
+  else if (point_count > 0 && cloud.normals.size() == point_count)
+    shading.mode = Shading::Normal;
+  else
+    shading.mode = Shading::Height;
+}
+
+void SceneCloud::upload() {
+  if (vao)
+    return;
+  // uploaded once; arrays that are missing or of the wrong size stay disabled and read as 0. The
+  // scalar slot is filled on demand with the attribute being shaded, see `bind_scalar_attribute`.
+  // Clouds that were appended to keep room for more, see `append`
+  const size_t point_count = size();
+  capacity                 = std::max(capacity, point_count);
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(5, vbo);
+  glBindVertexArray(vao);
+  auto upload_array = [&](GLuint location, GLint components, const float* data, size_t count) {
+    if (count != point_count || count == 0)
+      return;
+    const size_t point_bytes = static_cast<size_t>(components) * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[location]);
+    if (capacity == count) {
+      glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(count * point_bytes), data, GL_STATIC_DRAW);
+    } else {
+      glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity * point_bytes), nullptr, GL_DYNAMIC_DRAW);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(count * point_bytes), data);
+    }
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, components, GL_FLOAT, GL_FALSE, 0, nullptr);
+  };
+  upload_array(0, 3, &cloud.points.data()->x, cloud.points.size());
+  upload_array(1, 3, &cloud.colors.data()->x, cloud.colors.size());
+  upload_array(2, 3, &cloud.normals.data()->x, cloud.normals.size());
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  bound_attribute = -1;
+}
+
+void SceneCloud::bind_scalar_attribute() {
+  const int selected = shading.mode == Shading::Scalar && static_cast<size_t>(shading.attribute) < cloud.attributes.size() ? shading.attribute : -1;
+  if (selected == bound_attribute)
+    return;
+  bound_attribute = selected;
+
+  glBindVertexArray(vao);
+  const PointAttribute* attribute = selected >= 0 ? &cloud.attributes[static_cast<size_t>(selected)] : nullptr;
+  if (!attribute || attribute->size() != size()) {
+    glDisableVertexAttribArray(3);
+    glBindVertexArray(0);
+    return;
+  }
+  // uploaded in its own type, the vertex fetch converts the first component to float
+  static const GLenum gl_types[] = { GL_BYTE, GL_UNSIGNED_BYTE, GL_SHORT, GL_UNSIGNED_SHORT, GL_INT, GL_UNSIGNED_INT, GL_FLOAT, GL_DOUBLE };
+  glBindBuffer(GL_ARRAY_BUFFER, vbo[3]);
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(attribute->size() * attribute->stride()), attribute->data(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 1, gl_types[static_cast<int>(attribute->get_type())], GL_FALSE, static_cast<GLsizei>(attribute->stride()), nullptr);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  spdlog::debug("{}: bound attribute {} ({} x {})", name, attribute->get_name(), attribute_type_name(attribute->get_type()), attribute->get_components());
+}
+
+bool SceneCloud::request_spacing() {
+  if (spacing_task.valid() && spacing_task.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    std::vector<float> result = spacing_task.get();
+    if (spacing_task_version == points_version) {
+      spacing         = std::move(result);
+      spacing_version = points_version;
+    }
+  }
+  if (spacing_version != points_version) {
+    if (!spacing_task.valid() && size() > 0) {
+      spacing_task_version = points_version;
+      spacing_task         = ThreadPool::global().submit([points = cloud.points] {
+        PROFILE_SCOPE("point_spacing");
+        SpatialIndex index(points);
+        return mean_neighbour_distance(points, index, SPACING_NEIGHBOURS);
+      });
+    }
+    return false;
+  }
+  if (!spacing_uploaded && vao) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[4]);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(spacing.size() * sizeof(float)), spacing.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    spacing_uploaded = true;
+  }
+  return spacing_uploaded;
+}
+
+CloudUniforms SceneCloud::uniforms(const glm::mat4& model, const glm::mat4& view_projection) const {
+  CloudUniforms u {};
+  u.model        = model;
+  u.mvp          = view_projection * model;
+  u.shading      = static_cast<int32_t>(shading.mode);
+  u.height_axis  = std::clamp(shading.height_axis, 0, 2);
+  u.colormap     = static_cast<int32_t>(shading.colormap);
+  u.scalar_range = glm::vec2(shading.range[0], shading.range[1]);
+  return u;
+}
+
+void SceneCloud::draw_clipped(const std::vector<ClipVolume>& volumes, uint64_t volumes_version, const glm::mat4& model) {
+  if (clip_ranges_version != volumes_version || clip_ranges_model != model) {
+    PROFILE_SCOPE("clip_ranges");
+    const auto ranges = cloud.select_chunks([&](const Bounds& bounds) { return clip_classify(volumes, bounds, model); });
+    clip_firsts.clear();
+    clip_counts.clear();
+    clip_drawn_points = 0;
+    for (const auto& [begin, end] : ranges) {
+      clip_firsts.push_back(static_cast<GLint>(begin));
+      clip_counts.push_back(static_cast<GLsizei>(end - begin));
+      clip_drawn_points += end - begin;
+    }
+    clip_ranges_version = volumes_version;
+    clip_ranges_model   = model;
+  }
+  glMultiDrawArrays(GL_POINTS, clip_firsts.data(), clip_counts.data(), static_cast<GLsizei>(clip_firsts.size()));
+}
+
+void SceneCloud::draw_shuffled(size_t begin, size_t end) {
+  const size_t point_count = size();
+  if (!order_buffer) {
+    std::vector<GLuint> order(point_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(static_cast<std::mt19937::result_type>(point_count)));
+    glGenBuffers(1, &order_buffer);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, order_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(order.size() * sizeof(GLuint)), order.data(), GL_STATIC_DRAW);
+  }
+  end = std::min(end, point_count);
+  if (begin >= end)
+    return;
+  glBindVertexArray(vao);
+  glDrawElements(GL_POINTS, static_cast<GLsizei>(end - begin), GL_UNSIGNED_INT, reinterpret_cast<const void*>(begin * sizeof(GLuint)));
+}
+
+void SceneCloud::bake_colors(const glm::mat4& model) {
+  BakedColorsKey key {};
+  key.shading        = shading;
+  key.model          = model;
+  key.points_version = points_version;
+  if (baked_version > 0 && key == baked_key)
+    return;
+  PROFILE_SCOPE("bake_colors");
+  baked_colors = shade_points(cloud, model, shading);
+  baked_key    = key;
+  baked_version++;
+}
+
+GLuint SceneCloud::get_baked_color_buffer(const glm::mat4& model) {
+  bake_colors(model);
+  if (baked_color_vbo_version != baked_version) {
+    if (!baked_color_vbo)
+      glGenBuffers(1, &baked_color_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, baked_color_vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(baked_colors.size() * sizeof(glm::vec3)), baked_colors.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    baked_color_vbo_version = baked_version;
+  }
+  return baked_color_vbo;
+}
+
+const std::vector<uint32_t>& SceneCloud::get_packed_colors(const glm::mat4& model) {
+  bake_colors(model);
+  if (packed_version != baked_version) {
+    packed_colors  = SoftwareRasterizer::pack_colors(baked_colors);
+    packed_version = baked_version;
+  }
+  return packed_colors;
+}
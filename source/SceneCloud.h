@@ -0,0 +1,177 @@
+#pragma once
+#include "ClipVolume.h"
+#include "ColorMap.h"
+#include "FileWatcher.h"
+#include "PointCloud.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+/**
+ * @brief per-cloud block of the point shader's `Cloud` uniform buffer, std140 layout
+ * @details Every cloud of the scene has one entry in a single buffer, so switching clouds costs one
+ * `glBindBufferRange` instead of a round of `glUniform` calls.
+ */
+struct CloudUniforms {
+  glm::mat4 model;
+  glm::mat4 mvp;
+  int32_t   shading;
+  int32_t   height_axis;
+  int32_t   colormap;
+  int32_t   padding;
+  glm::vec2 scalar_range;
+};
+static_assert(offsetof(CloudUniforms, scalar_range) == 144, "`CloudUniforms` must match the std140 layout of the `Cloud` block");
+
+/**
+ * @brief one point cloud of the scene, with its own GPU buffers, placement and shading.
+ * @details The positions, colors and normals are uploaded once by `upload`; the scalar slot holds
+ * the attribute selected by `shading`. What the compute and software renderers need, the colors
+ * baked on the CPU and the chunk ranges left by the clip volumes, is rebuilt lazily when the
+ * settings it depends on change. The buffers are released with the cloud, so it must be destroyed
+ * while the GL context is current.
+ *
+ * A cloud reloaded from its `source` file is either swapped whole by `replace` or grown by
+ * `append`, which uploads only the new points with `glBufferSubData` while the buffers have room.
+ * Buffers that had to grow keep half as much again spare, so a file appended to in many small
+ * pieces is not uploaded again every time.
+ *
+ * The spacing slot holds the mean distance of every point to its nearest neighbours, from which
+ * the point shader sizes splats. It is computed on a worker thread the first time
+ * `request_spacing` is called, and reads as 0 until then.
+ *
+ * Usage:
+ * ```cpp
+ * SceneCloud scan("scan.xyz", std::move(point_cloud));
+ * scan.upload();
+ * scan.bind_scalar_attribute();
+ * glBindVertexArray(scan.get_vao());
+ * glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(scan.size()));
+ * ```
+ */
+class SceneCloud {
+ public:
+  std::string     name;
+  PointCloud      cloud;
+  glm::mat4       transform { 1.0f }; // placement in the scene, applied before the window's model
+  bool            visible { true };
+  ShadingSettings shading;
+  int64_t         tile { -1 }; // index in the window's `TileSet` when streamed from it, -1 otherwise
+  std::string     source;          // file reloaded when it changes, empty when not watched
+  FileSnapshot    source_snapshot; // what was read of `source`, tells an append from a rewrite
+
+ private:
+  GLuint   vao { 0 };
+  GLuint   vbo[5] { 0, 0, 0, 0, 0 }; // position, color, normal, scalar, spacing; only those with one value per point are bound
+  size_t   capacity { 0 };        // points the position, color and normal buffers hold room for
+  uint64_t points_version { 0 };  // bumped whenever the points change, by `replace` or `append`
+  int    bound_attribute { -1 }; // entry of `cloud.attributes` in the scalar slot, -1 for none
+  GLuint order_buffer { 0 };     // shuffled point order for progressive rendering, created on first use
+
+  // spacing of the points, computed on a copy of them so the cloud may change or go meanwhile
+  std::future<std::vector<float>> spacing_task;
+  uint64_t                        spacing_task_version { 0 };     // `points_version` the task started from
+  std::vector<float>              spacing;
+  uint64_t                        spacing_version { UINT64_MAX }; // `points_version` of `spacing`
+  bool                            spacing_uploaded { false };
+
+  // colors baked on the CPU for the compute and software renderers, rebuilt when the key changes
+  struct BakedColorsKey {
+    ShadingSettings shading;
+    glm::mat4       model;
+    uint64_t        points_version;
+
+    // field by field, the padding before `points_version` is indeterminate
+    bool operator==(const BakedColorsKey& other) const {
+      return shading == other.shading && model == other.model && points_version == other.points_version;
+    }
+  };
+  BakedColorsKey         baked_key {};
+  uint64_t               baked_version { 0 }; // 0 until the first bake
+  std::vector<glm::vec3> baked_colors;
+  GLuint                 baked_color_vbo { 0 };
+  uint64_t               baked_color_vbo_version { 0 };
+  std::vector<uint32_t>  packed_colors; // RGBA8 for the software renderer
+  uint64_t               packed_version { 0 };
+
+  // chunk ranges still drawn under the clip volumes, for glMultiDrawArrays
+  uint64_t             clip_ranges_version { UINT64_MAX };
+  glm::mat4            clip_ranges_model { 1.0f };
+  std::vector<GLint>   clip_firsts;
+  std::vector<GLsizei> clip_counts;
+  size_t               clip_drawn_points { 0 };
+
+  /** recompute `baked_colors` if the shading, `model` or the points changed since the last call */
+  void bake_colors(const glm::mat4& model);
+
+  /** delete the GL objects, `upload` creates them again */
+  void release();
+
+  /** the points changed, drop what was derived from them */
+  void invalidate();
+
+ public:
+  SceneCloud(std::string name_, PointCloud cloud_);
+  ~SceneCloud();
+
+  SceneCloud(const SceneCloud&)            = delete;
+  SceneCloud& operator=(const SceneCloud&) = delete;
+
+  inline size_t size() const { return cloud.get_points().size(); }
+  inline GLuint get_vao() const { return vao; }
+  inline GLuint get_position_buffer() const { return vbo[0]; }
+
+  /** create the vertex array and upload the points, no-op once done */
+  void upload();
+
+  /** swap in the points of `cloud_`, uploaded again by the next `upload`; the shading is kept if the new points allow it */
+  void replace(PointCloud cloud_);
+
+  /**
+   * @brief append the points of `tail`, stored relative to the same `origin`, and upload only them
+   * @details The colors, normals and attributes the cloud has grow with those of `tail`, or with
+   * zeros where `tail` has none. The buffers are created again when they have no room left.
+   */
+  void append(PointCloud tail);
+
+  /** pick the most specific shading mode the loaded data allows */
+  void choose_shading();
+
+  /** upload the attribute selected for `Shading::Scalar` into the scalar slot, if it changed */
+  void bind_scalar_attribute();
+
+  /** neighbours averaged by the spacing */
+  static constexpr size_t SPACING_NEIGHBOURS = 4;
+
+  /**
+   * @brief fill the spacing slot, computing the spacing on a worker thread first
+   * @details Call it every frame the spacing is needed; it returns at once and uploads the spacing
+   * once a later call finds it computed. Returns true when the slot is filled.
+   */
+  bool request_spacing();
+
+  /** the values of the shader's `Cloud` block for this cloud */
+  CloudUniforms uniforms(const glm::mat4& model, const glm::mat4& view_projection) const;
+
+  /** draw the points kept by `volumes`, skipping the chunks they hide; the VAO must be bound */
+  void draw_clipped(const std::vector<ClipVolume>& volumes, uint64_t volumes_version, const glm::mat4& model);
+
+  /** points drawn by the last `draw_clipped` */
+  inline size_t get_clip_drawn_points() const { return clip_drawn_points; }
+
+  /**
+   * @brief draw points [`begin`, `end`) of a fixed random permutation of the cloud
+   * @details Any prefix of the permutation is a uniform subsample, so each slice covers the whole cloud.
+   */
+  void draw_shuffled(size_t begin, size_t end);
+
+  /** buffer of the colors baked for `model`, tightly packed `vec3` */
+  GLuint get_baked_color_buffer(const glm::mat4& model);
+
+  /** the colors baked for `model` packed to RGBA8, for `SoftwareRasterizer` */
+  const std::vector<uint32_t>& get_packed_colors(const glm::mat4& model);
+};
@@ -17,6 +17,8 @@ GLuint create_shader_program(const char* vertex_shader_source, const char* fragm
   if (!success) {
     glGetShaderInfoLog(vertex_shader, 512, NULL, info_log);
     spdlog::error("[OpenGL] {}", info_log);
+    glDeleteShader(vertex_shader);
+    return 0;
   }
   // 片段着色器
   int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -27,6 +29,9 @@ GLuint create_shader_program(const char* vertex_shader_source, const char* fragm
   if (!success) {
     glGetShaderInfoLog(fragment_shader, 512, NULL, info_log);
     spdlog::error("[OpenGL] {}", info_log);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return 0;
   }
   // 链接顶点和片段着色器至一个着色器程序
   GLuint shader_program = glCreateProgram();
@@ -38,6 +43,10 @@ GLuint create_shader_program(const char* vertex_shader_source, const char* fragm
   if (!success) {
     glGetProgramInfoLog(shader_program, 512, NULL, info_log);
     spdlog::error("[OpenGL] {}", info_log);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    glDeleteProgram(shader_program);
+    return 0;
   }
   // 删除着色器
   glDeleteShader(vertex_shader);
@@ -45,3 +54,45 @@ GLuint create_shader_program(const char* vertex_shader_source, const char* fragm
 
   return shader_program;
 }
+
+
+GLuint create_compute_program(const char* compute_shader_source) {
+  // 计算着色器
+  int compute_shader = glCreateShader(GL_COMPUTE_SHADER);
+  glShaderSource(compute_shader, 1, &compute_shader_source, NULL);
+  glCompileShader(compute_shader);
+  int  success;
+  char info_log[512];
+  glGetShaderiv(compute_shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    glGetShaderInfoLog(compute_shader, 512, NULL, info_log);
+    spdlog::error("[OpenGL] {}", info_log);
+    glDeleteShader(compute_shader);
+    return 0;
+  }
+  GLuint shader_program = glCreateProgram();
+  glAttachShader(shader_program, compute_shader);
+  glLinkProgram(shader_program);
+  glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+  if (!success) {
+    glGetProgramInfoLog(shader_program, 512, NULL, info_log);
+    spdlog::error("[OpenGL] {}", info_log);
+    glDeleteShader(compute_shader);
+    glDeleteProgram(shader_program);
+    return 0;
+  }
+  glDeleteShader(compute_shader);
+
+  return shader_program;
+}
+
+bool gl_has_extension(const char* name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++) {
+    auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+    if (extension && std::string(extension) == name)
+      return true;
+  }
+  return false;
+}
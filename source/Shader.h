@@ -16,7 +16,22 @@
  */
 GLuint create_shader_program(const char* vertex_shader_source, const char* fragment_shader_source);
 
+/**
+ * @brief create compute shader program from GLSL source code
+ * @param compute_shader_source GLSL source code for compute shader
+ * @return 0 if the shader failed to compile or link
+ */
+GLuint create_compute_program(const char* compute_shader_source);
+
+/** @brief check whether the current OpenGL context exposes the extension `name` */
+bool gl_has_extension(const char* name);
+
 /** @brief set shader program's uniform variable */
+inline void shader_set_uniform(GLuint program, const char* name, const glm::vec2& vec) {
+  auto loc = glGetUniformLocation(program, name);
+  glUniform2fv(loc, 1, &vec[0]);
+}
+
 inline void shader_set_uniform(GLuint program, const char* name, const glm::vec3& vec) {
   auto loc = glGetUniformLocation(program, name);
   glUniform3fv(loc, 1, &vec[0]);
@@ -47,6 +62,11 @@ inline void shader_set_uniform(GLuint program, const char* name, const glm::mat4
   glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]);
 }
 
+inline void shader_set_uniform(GLuint program, const char* name, const glm::ivec2& vec) {
+  auto loc = glGetUniformLocation(program, name);
+  glUniform2i(loc, vec.x, vec.y);
+}
+
 inline void shader_set_uniform(GLuint program, const char* name, bool value) {
   auto loc = glGetUniformLocation(program, name);
 
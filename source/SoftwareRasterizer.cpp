@@ -0,0 +1,124 @@
+#include "SoftwareRasterizer.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static constexpr uint64_t EMPTY_PIXEL = std::numeric_limits<uint64_t>::max();
+
+static inline uint32_t pack_rgba8(const glm::vec4& c) {
+  auto channel = [](float v) { return static_cast<uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+  return channel(c.r) | channel(c.g) << 8 | channel(c.b) << 16 | channel(c.a) << 24;
+}
+
+static inline void atomic_min(std::atomic<uint64_t>& target, uint64_t value) {
+  uint64_t previous = target.load(std::memory_order_relaxed);
+  while (value < previous && !target.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+  }
+}
+
+std::vector<uint32_t> SoftwareRasterizer::pack_colors(const std::vector<glm::vec3>& colors) {
+  std::vector<uint32_t> packed(colors.size());
+  parallel_for(0, colors.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      packed[i] = pack_rgba8(glm::vec4(colors[i], 1.0f));
+  });
+  return packed;
+}
+
+void SoftwareRasterizer::resize(int width_, int height_) {
+  if (width_ == width && height_ == height && framebuffer)
+    return;
+  width   = std::max(1, width_);
+  height  = std::max(1, height_);
+  tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+  tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+  framebuffer.reset(new std::atomic<uint64_t>[static_cast<size_t>(tiles_x) * tiles_y * TILE_SIZE * TILE_SIZE]);
+  image.assign(static_cast<size_t>(width) * height, 0);
+  clear();
+}
+
+void SoftwareRasterizer::clear() {
+  const size_t pixel_count = static_cast<size_t>(tiles_x) * tiles_y * TILE_SIZE * TILE_SIZE;
+  parallel_for(0, pixel_count, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      framebuffer[i].store(EMPTY_PIXEL, std::memory_order_relaxed);
+  }, 1 << 16);
+}
+
+void SoftwareRasterizer::render(const std::vector<glm::vec3>& points, const std::vector<uint32_t>& colors, const glm::mat4& mvp, float point_size) {
+  if (!framebuffer || points.empty())
+    return;
+
+  const int  splat      = std::max(1, static_cast<int>(std::lround(point_size)));
+  const int  offset     = (splat - 1) / 2;
+  const bool has_colors = colors.size() == points.size();
+  const auto fwidth     = static_cast<float>(width);
+  const auto fheight    = static_cast<float>(height);
+
+  // hoisted so the projection loop below only touches locals and plain arrays
+  const float m00 = mvp[0][0], m10 = mvp[1][0], m20 = mvp[2][0], m30 = mvp[3][0];
+  const float m01 = mvp[0][1], m11 = mvp[1][1], m21 = mvp[2][1], m31 = mvp[3][1];
+  const float m02 = mvp[0][2], m12 = mvp[1][2], m22 = mvp[2][2], m32 = mvp[3][2];
+  const float m03 = mvp[0][3], m13 = mvp[1][3], m23 = mvp[2][3], m33 = mvp[3][3];
+
+  parallel_for(0, points.size(), [&](size_t begin, size_t end) {
+    constexpr size_t BATCH = 256;
+    alignas(64) float clip_x[BATCH], clip_y[BATCH], clip_z[BATCH], clip_w[BATCH];
+
+    for (size_t first = begin; first < end; first += BATCH) {
+      const size_t     n = std::min(BATCH, end - first);
+      const glm::vec3* p = &points[first];
+
+      // branch-free, so the compiler emits packed SIMD for it
+      for (size_t i = 0; i < n; i++) {
+        const float x = p[i].x, y = p[i].y, z = p[i].z;
+        clip_x[i]     = m00 * x + m10 * y + m20 * z + m30;
+        clip_y[i]     = m01 * x + m11 * y + m21 * z + m31;
+        clip_z[i]     = m02 * x + m12 * y + m22 * z + m32;
+        clip_w[i]     = m03 * x + m13 * y + m23 * z + m33;
+      }
+
+      for (size_t i = 0; i < n; i++) {
+        if (clip_w[i] <= 0.0f)
+          continue;
+        const float inv_w = 1.0f / clip_w[i];
+        const float ndc_z = clip_z[i] * inv_w;
+        if (ndc_z < -1.0f || ndc_z > 1.0f)
+          continue;
+        const int px = static_cast<int>(std::floor((clip_x[i] * inv_w * 0.5f + 0.5f) * fwidth)) - offset;
+        const int py = static_cast<int>(std::floor((0.5f - clip_y[i] * inv_w * 0.5f) * fheight)) - offset;
+        if (px + splat <= 0 || py + splat <= 0 || px >= width || py >= height)
+          continue;
+
+        // positive floats compare like their bit patterns, so depth can live in the high word
+        const float depth = ndc_z * 0.5f + 0.5f;
+        uint32_t    depth_bits;
+        std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+        const uint32_t color = has_colors ? colors[first + i] : 0xFF000000u;
+        const uint64_t value = static_cast<uint64_t>(depth_bits) << 32 | color;
+
+        const int x0 = std::max(px, 0), x1 = std::min(px + splat, width);
+        const int y0 = std::max(py, 0), y1 = std::min(py + splat, height);
+        for (int y = y0; y < y1; y++)
+          for (int x = x0; x < x1; x++)
+            atomic_min(framebuffer[pixel_offset(x, y)], value);
+      }
+    }
+  }, 1 << 14);
+}
+
+const std::vector<uint32_t>& SoftwareRasterizer::resolve(const glm::vec4& background) {
+  const uint32_t background_rgba = pack_rgba8(background);
+  parallel_for(0, static_cast<size_t>(height), [&](size_t begin, size_t end) {
+    for (size_t y = begin; y < end; y++) {
+      uint32_t* row = &image[y * width];
+      for (int x = 0; x < width; x++) {
+        const uint64_t value = framebuffer[pixel_offset(x, static_cast<int>(y))].load(std::memory_order_relaxed);
+        row[x]               = value == EMPTY_PIXEL ? background_rgba : static_cast<uint32_t>(value);
+      }
+    }
+  }, 16);
+  return image;
+}
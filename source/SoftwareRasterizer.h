@@ -0,0 +1,57 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief multithreaded CPU point rasterizer, used when there is no usable GPU.
+ * @details Every pixel holds a 64-bit word packing `depth << 32 | rgba8`. Points are projected in
+ * batches and written with an atomic min, so the nearest point wins without any locking. The
+ * framebuffer is stored as 8x8 tiles to keep neighbouring pixels in the same cache lines.
+ *
+ * Usage:
+ * ```cpp
+ * SoftwareRasterizer rasterizer;
+ * std::vector<uint32_t> colors = SoftwareRasterizer::pack_colors(point_cloud.get_colors());
+ * rasterizer.resize(width, height);
+ * rasterizer.clear();
+ * rasterizer.render(point_cloud.get_points(), colors, mvp, point_size);
+ * const std::vector<uint32_t>& image = rasterizer.resolve(background);
+ * ```
+ */
+class SoftwareRasterizer {
+ public:
+  static constexpr int TILE_SIZE = 8;
+
+ private:
+  int width { 0 }, height { 0 };
+  int tiles_x { 0 }, tiles_y { 0 };
+
+  std::unique_ptr<std::atomic<uint64_t>[]> framebuffer;
+  std::vector<uint32_t>                    image; // resolved RGBA8, row-major, top row first
+
+  inline size_t pixel_offset(int x, int y) const {
+    int tile = (y / TILE_SIZE) * tiles_x + x / TILE_SIZE;
+    return static_cast<size_t>(tile) * TILE_SIZE * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+  }
+
+ public:
+  /** pack point colors to RGBA8 once, instead of converting them every frame */
+  static std::vector<uint32_t> pack_colors(const std::vector<glm::vec3>& colors);
+  /** reallocate the framebuffer, no-op when the size is unchanged */
+  void resize(int width_, int height_);
+  /** reset every pixel to the far plane */
+  void clear();
+  /**
+   * @brief splat `points` with `point_size` x `point_size` squares, depth tested against the framebuffer
+   * @param colors RGBA8 per point from `pack_colors`, points are black when the sizes differ
+   */
+  void render(const std::vector<glm::vec3>& points, const std::vector<uint32_t>& colors, const glm::mat4& mvp, float point_size);
+  /** convert the framebuffer to a row-major RGBA8 image, empty pixels get `background` */
+  const std::vector<uint32_t>& resolve(const glm::vec4& background);
+
+  inline int get_width() const { return width; }
+  inline int get_height() const { return height; }
+};
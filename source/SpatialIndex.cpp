@@ -0,0 +1,285 @@
+#include "SpatialIndex.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+SpatialIndex::SpatialIndex(const std::vector<glm::vec3>& points) {
+  const size_t count = points.size();
+  // the right half of an odd range gets the extra point, so the largest leaf holds the count divided by 2^depth rounded up
+  while (((count + (size_t(1) << depth) - 1) >> depth) > LEAF_SIZE)
+    depth++;
+  nodes.resize((size_t(2) << depth) - 1);
+  nodes[0].begin = 0;
+  nodes[0].end   = static_cast<uint32_t>(count);
+
+  order.resize(count);
+  std::iota(order.begin(), order.end(), 0u);
+
+  // each level splits every range of the previous one at its median, the nodes of a level are independent
+  for (uint32_t level = 0; level <= depth; level++) {
+    const size_t first = (size_t(1) << level) - 1;
+    parallel_for(first, first + (size_t(1) << level), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        Node& node = nodes[i];
+        node.min   = glm::vec3(std::numeric_limits<float>::max());
+        node.max   = glm::vec3(std::numeric_limits<float>::lowest());
+        for (uint32_t j = node.begin; j < node.end; j++) {
+          node.min = glm::min(node.min, points[order[j]]);
+          node.max = glm::max(node.max, points[order[j]]);
+        }
+        if (level == depth)
+          continue;
+
+        const glm::vec3 extent = node.max - node.min;
+        node.axis              = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        const uint32_t mid     = node.begin + (node.end - node.begin) / 2;
+        const uint32_t axis    = node.axis;
+        std::nth_element(order.begin() + node.begin, order.begin() + mid, order.begin() + node.end,
+                         [&](uint32_t a, uint32_t b) { return points[a][axis] < points[b][axis]; });
+        node.split = mid < node.end ? points[order[mid]][axis] : 0.0f;
+
+        nodes[2 * i + 1].begin = node.begin;
+        nodes[2 * i + 1].end   = mid;
+        nodes[2 * i + 2].begin = mid;
+        nodes[2 * i + 2].end   = node.end;
+      }
+    }, level < 10 ? 1 : 64);
+  }
+
+  xs.resize(count);
+  ys.resize(count);
+  zs.resize(count);
+  parallel_for(0, count, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const glm::vec3& p = points[order[i]];
+      xs[i]              = p.x;
+      ys[i]              = p.y;
+      zs[i]              = p.z;
+    }
+  });
+}
+
+void SpatialIndex::knn(const glm::vec3& query, size_t k, std::vector<Neighbour>& result) const {
+  result.clear();
+  if (k == 0 || order.empty())
+    return;
+  auto worst = [&] { return result.size() < k ? std::numeric_limits<float>::max() : result.back().distance2; };
+
+  // farther children waiting to be visited, at most one per level
+  struct Pending {
+    uint32_t node;
+    float    distance2;
+  };
+  Pending stack[64];
+  int     top      = 0;
+  stack[top++]     = { 0, 0.0f };
+  const uint32_t first_leaf = (1u << depth) - 1;
+
+  while (top > 0) {
+    Pending pending = stack[--top];
+    if (pending.distance2 >= worst())
+      continue;
+
+    uint32_t node = pending.node;
+    while (node < first_leaf) {
+      const Node&    n     = nodes[node];
+      const bool     right = query[n.axis] >= n.split;
+      const uint32_t near  = 2 * node + (right ? 2 : 1);
+      const uint32_t far   = 2 * node + (right ? 1 : 2);
+      const float    d2    = distance2(far, query);
+      if (d2 < worst())
+        stack[top++] = { far, d2 };
+      node = near;
+    }
+
+    // distances of the whole leaf first, this loop vectorizes over the x, y and z arrays
+    const Node& leaf = nodes[node];
+    const uint32_t count = leaf.end - leaf.begin;
+    float       d2[LEAF_SIZE];
+    const float* x = xs.data() + leaf.begin;
+    const float* y = ys.data() + leaf.begin;
+    const float* z = zs.data() + leaf.begin;
+    for (uint32_t j = 0; j < count; j++) {
+      const float dx = x[j] - query.x, dy = y[j] - query.y, dz = z[j] - query.z;
+      d2[j]          = dx * dx + dy * dy + dz * dz;
+    }
+
+    for (uint32_t j = 0; j < count; j++) {
+      if (d2[j] >= worst())
+        continue;
+      if (result.size() == k)
+        result.pop_back();
+      Neighbour neighbour { d2[j], order[leaf.begin + j] };
+      auto      it = std::upper_bound(result.begin(), result.end(), neighbour,
+                                      [](const Neighbour& a, const Neighbour& b) { return a.distance2 < b.distance2; });
+      result.insert(it, neighbour);
+    }
+  }
+}
+
+template <typename F>
+void SpatialIndex::for_each_within(const glm::vec3& query, float radius2, F&& fn) const {
+  if (order.empty())
+    return;
+  uint32_t       stack[64];
+  int            top        = 0;
+  const uint32_t first_leaf = (1u << depth) - 1;
+  stack[top++]              = 0;
+
+  while (top > 0) {
+    const uint32_t node = stack[--top];
+    if (distance2(node, query) > radius2)
+      continue;
+    if (node < first_leaf) {
+      stack[top++] = 2 * node + 2;
+      stack[top++] = 2 * node + 1;
+      continue;
+    }
+
+    const Node& leaf = nodes[node];
+    for (uint32_t j = leaf.begin; j < leaf.end; j++) {
+      const float dx = xs[j] - query.x, dy = ys[j] - query.y, dz = zs[j] - query.z;
+      const float d2 = dx * dx + dy * dy + dz * dz;
+      if (d2 <= radius2 && !fn(j, d2))
+        return;
+    }
+  }
+}
+
+void SpatialIndex::radius_search(const glm::vec3& query, float radius, std::vector<Neighbour>& result) const {
+  result.clear();
+  for_each_within(query, radius * radius, [&](uint32_t position, float d2) {
+    result.push_back({ d2, order[position] });
+    return true;
+  });
+}
+
+size_t SpatialIndex::count_within(const glm::vec3& query, float radius, size_t limit) const {
+  size_t count = 0;
+  if (limit == 0)
+    return 0;
+  for_each_within(query, radius * radius, [&](uint32_t, float) { return ++count < limit; });
+  return count;
+}
+
+template <typename NodeCoverage, typename PointIn>
+void SpatialIndex::collect_spans(NodeCoverage&& node_coverage, PointIn&& point_in, std::vector<Span>& result) const {
+  if (order.empty())
+    return;
+  auto append = [&](uint32_t begin, uint32_t end) {
+    const uint32_t* first = order.data() + begin;
+    if (!result.empty() && result.back().last == first)
+      result.back().last = order.data() + end;
+    else
+      result.push_back({ first, order.data() + end });
+  };
+
+  // depth first, left child first, so spans come out in tree order and touching ones merge
+  uint32_t       stack[64];
+  int            top        = 0;
+  const uint32_t first_leaf = (1u << depth) - 1;
+  stack[top++]              = 0;
+  while (top > 0) {
+    const uint32_t node = stack[--top];
+    const Node&    n    = nodes[node];
+    if (n.begin >= n.end)
+      continue;
+    const Coverage coverage = node_coverage(n);
+    if (coverage == Coverage::None)
+      continue;
+    if (coverage == Coverage::All) {
+      append(n.begin, n.end);
+    } else if (node < first_leaf) {
+      stack[top++] = 2 * node + 2;
+      stack[top++] = 2 * node + 1;
+    } else {
+      for (uint32_t j = n.begin; j < n.end; j++)
+        if (point_in(glm::vec3(xs[j], ys[j], zs[j])))
+          append(j, j + 1);
+    }
+  }
+}
+
+void SpatialIndex::box_search(const glm::vec3& min, const glm::vec3& max, std::vector<Span>& result) const {
+  result.clear();
+  collect_spans(
+    [&](const Node& n) {
+      if (n.max.x < min.x || n.max.y < min.y || n.max.z < min.z || n.min.x > max.x || n.min.y > max.y || n.min.z > max.z)
+        return Coverage::None;
+      if (n.min.x >= min.x && n.min.y >= min.y && n.min.z >= min.z && n.max.x <= max.x && n.max.y <= max.y && n.max.z <= max.z)
+        return Coverage::All;
+      return Coverage::Partial;
+    },
+    [&](const glm::vec3& p) { return p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x && p.y <= max.y && p.z <= max.z; }, result);
+}
+
+void SpatialIndex::sphere_search(const glm::vec3& query, float radius, std::vector<Span>& result) const {
+  result.clear();
+  const float radius2 = radius * radius;
+  collect_spans(
+    [&](const Node& n) {
+      const glm::vec3 near = glm::max(glm::max(n.min - query, query - n.max), glm::vec3(0.0f));
+      if (glm::dot(near, near) > radius2)
+        return Coverage::None;
+      const glm::vec3 far = glm::max(glm::abs(n.min - query), glm::abs(n.max - query));
+      return glm::dot(far, far) <= radius2 ? Coverage::All : Coverage::Partial;
+    },
+    [&](const glm::vec3& p) { return glm::dot(p - query, p - query) <= radius2; }, result);
+}
+
+void SpatialIndex::ray_search(const glm::vec3& origin, const glm::vec3& direction, float radius, float max_distance, std::vector<RayHit>& result) const {
+  result.clear();
+  const float length = glm::length(direction);
+  if (order.empty() || length <= 0.0f)
+    return;
+  const glm::vec3 d       = direction / length;
+  const float     radius2 = radius * radius;
+
+  // the ray against the node bounds grown by `radius`, a superset of the capsule around the ray
+  auto reaches = [&](const Node& n) {
+    float t0 = 0.0f, t1 = max_distance;
+    for (int axis = 0; axis < 3; axis++) {
+      const float lo = n.min[axis] - radius, hi = n.max[axis] + radius;
+      if (std::abs(d[axis]) < 1e-12f) {
+        if (origin[axis] < lo || origin[axis] > hi)
+          return false;
+        continue;
+      }
+      float a = (lo - origin[axis]) / d[axis], b = (hi - origin[axis]) / d[axis];
+      if (a > b)
+        std::swap(a, b);
+      t0 = std::max(t0, a);
+      t1 = std::min(t1, b);
+      if (t0 > t1)
+        return false;
+    }
+    return true;
+  };
+
+  uint32_t       stack[64];
+  int            top        = 0;
+  const uint32_t first_leaf = (1u << depth) - 1;
+  stack[top++]              = 0;
+  while (top > 0) {
+    const uint32_t node = stack[--top];
+    const Node&    n    = nodes[node];
+    if (n.begin >= n.end || !reaches(n))
+      continue;
+    if (node < first_leaf) {
+      stack[top++] = 2 * node + 2;
+      stack[top++] = 2 * node + 1;
+      continue;
+    }
+    for (uint32_t j = n.begin; j < n.end; j++) {
+      const glm::vec3 p(xs[j], ys[j], zs[j]);
+      const float     t  = std::clamp(glm::dot(p - origin, d), 0.0f, max_distance);
+      const glm::vec3 r  = p - (origin + t * d);
+      const float     d2 = glm::dot(r, r);
+      if (d2 <= radius2)
+        result.push_back({ t, d2, order[j] });
+    }
+  }
+  std::sort(result.begin(), result.end(), [](const RayHit& a, const RayHit& b) { return a.t < b.t || (!(b.t < a.t) && a.index < b.index); });
+}
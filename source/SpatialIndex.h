@@ -0,0 +1,129 @@
+#pragma once
+#include "Bounds.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief balanced kd-tree over a fixed set of points, for neighbour queries on the CPU.
+ * @details The tree is implicit: node `i` has children `2i + 1` and `2i + 2`, every split is at the
+ * median, so all leaves sit on the last level and hold at most `LEAF_SIZE` points. Each node owns a
+ * contiguous range of the tree order; the points are copied in that order into separate x, y and z
+ * arrays so leaf scans read sequential memory and vectorize.
+ *
+ * Usage:
+ * ```cpp
+ * SpatialIndex index(point_cloud.get_points());
+ * std::vector<SpatialIndex::Neighbour> neighbours;
+ * index.knn(point_cloud.points[0], 16, neighbours); // nearest first, including the point itself
+ * std::vector<SpatialIndex::Span> spans;
+ * index.box_search(min, max, spans); // runs of original indices, read in place
+ * ```
+ * All queries are const and keep their state on the stack, so any number of threads can query one
+ * index at the same time.
+ */
+class SpatialIndex {
+ public:
+  static constexpr uint32_t LEAF_SIZE = 32;
+
+  struct Node {
+    glm::vec3 min, max;     // tight bounds of the points below
+    uint32_t  begin, end;   // range in tree order
+    uint32_t  axis { 0 };   // split axis, internal nodes only
+    float     split { 0 };  // coordinate of the first point of the right child
+  };
+
+  /** a query result, `index` refers to the original point array */
+  struct Neighbour {
+    float    distance2;
+    uint32_t index;
+  };
+
+  /** a run of original indices, read in place from the tree order of the index that returned it */
+  struct Span {
+    const uint32_t* first;
+    const uint32_t* last;
+
+    inline const uint32_t* begin() const { return first; }
+    inline const uint32_t* end() const { return last; }
+    inline size_t          size() const { return static_cast<size_t>(last - first); }
+  };
+
+  /** a point near a ray, `t` is its distance along the ray and `distance2` its squared distance to it */
+  struct RayHit {
+    float    t;
+    float    distance2;
+    uint32_t index;
+  };
+
+ private:
+  std::vector<Node>     nodes;
+  uint32_t              depth { 0 }; // leaves are on level `depth`
+  std::vector<uint32_t> order;       // tree order position -> original index
+  std::vector<float>    xs, ys, zs;  // points in tree order
+
+  /** call `fn(tree_position, distance2)` for the points within sqrt(`radius2`), stops when it returns false */
+  template <typename F>
+  void for_each_within(const glm::vec3& query, float radius2, F&& fn) const;
+
+  /**
+   * @brief append to `result` the spans of the points selected by `node_coverage` and `point_in`
+   * @details Nodes rated `Coverage::All` become one span, leaves rated `Coverage::Partial` are
+   * tested point by point; spans that touch in tree order are merged.
+   */
+  template <typename NodeCoverage, typename PointIn>
+  void collect_spans(NodeCoverage&& node_coverage, PointIn&& point_in, std::vector<Span>& result) const;
+
+ public:
+  SpatialIndex() = default;
+  /** build the tree in parallel, level by level */
+  explicit SpatialIndex(const std::vector<glm::vec3>& points);
+
+  /**
+   * @brief the `k` points closest to `query`, sorted by distance
+   * @param result cleared and refilled, reuse it across queries to avoid allocations
+   */
+  void knn(const glm::vec3& query, size_t k, std::vector<Neighbour>& result) const;
+
+  /**
+   * @brief every point within `radius` of `query`, in no particular order
+   * @param result cleared and refilled
+   */
+  void radius_search(const glm::vec3& query, float radius, std::vector<Neighbour>& result) const;
+
+  /** number of points within `radius` of `query`, counting stops once `limit` is reached */
+  size_t count_within(const glm::vec3& query, float radius, size_t limit = SIZE_MAX) const;
+
+  /**
+   * @brief every point inside the box [`min`, `max`], as spans of the tree order
+   * @details Nodes inside the box are returned as one span each without visiting their points, so
+   * large boxes cost about as much as small ones. `result` is cleared and refilled.
+   */
+  void box_search(const glm::vec3& min, const glm::vec3& max, std::vector<Span>& result) const;
+
+  /** every point within `radius` of `query`, as spans of the tree order; `result` is cleared and refilled */
+  void sphere_search(const glm::vec3& query, float radius, std::vector<Span>& result) const;
+
+  /**
+   * @brief the points within `radius` of the ray from `origin` along `direction`, nearest along the ray first
+   * @details Only the first `max_distance` of the ray is searched; `direction` need not be unit
+   * length. `result` is cleared and refilled.
+   */
+  void ray_search(const glm::vec3& origin, const glm::vec3& direction, float radius, float max_distance, std::vector<RayHit>& result) const;
+
+  inline size_t                       size() const { return order.size(); }
+  inline const std::vector<Node>&     get_nodes() const { return nodes; }
+  inline uint32_t                     get_depth() const { return depth; }
+  inline bool                         is_leaf(uint32_t node) const { return node >= (1u << depth) - 1; }
+  inline const std::vector<uint32_t>& get_order() const { return order; }
+  /** position of the point at tree order `i` */
+  inline glm::vec3 get_point(size_t i) const { return glm::vec3(xs[i], ys[i], zs[i]); }
+
+  /** squared distance from `p` to the bounds of `node`, 0 inside */
+  inline float distance2(uint32_t node, const glm::vec3& p) const {
+    const Node& n = nodes[node];
+    glm::vec3   d = glm::max(glm::max(n.min - p, p - n.max), glm::vec3(0.0f));
+    return glm::dot(d, d);
+  }
+};
@@ -0,0 +1,171 @@
+#include "SurfelRenderer.h"
+#include "Shader.h"
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+// compiled after `#define SURFEL_PASS` and 0 for the visibility pass or 1 for the accumulation pass
+static const char* splatFragmentShader = R"(
+layout(location = 0) out vec4 FragColor;
+in vec3  fColor;
+in vec3  fCenter; // view space
+in vec3  fNormal; // view space, zero when the point has none
+in float fRadius; // world units
+
+uniform mat4  projection;
+uniform mat4  inverse_projection;
+uniform vec2  target_size;  // pixels
+uniform float depth_offset; // radii the visibility depth is pushed back by
+
+vec3 unproject(vec2 ndc, float z)
+{
+    vec4 p = inverse_projection * vec4(ndc, z, 1.0);
+    return p.xyz / p.w;
+}
+
+void main()
+{
+    // view ray through this pixel, from the near plane to the far plane
+    vec2 ndc    = gl_FragCoord.xy / target_size * 2.0 - 1.0;
+    vec3 origin = unproject(ndc, -1.0);
+    vec3 ray    = normalize(unproject(ndc, 1.0) - origin);
+
+    // where it crosses the plane of the disc; discs without a normal face the camera
+    vec3  n     = length(fNormal) > 0.0 ? normalize(fNormal) : -ray;
+    float slope = dot(ray, n);
+    if (abs(slope) < 1e-4)
+        discard; // seen edge-on
+    vec3  hit = origin + ray * (dot(fCenter - origin, n) / slope);
+    vec3  d   = hit - fCenter;
+    float r2  = dot(d, d) / (fRadius * fRadius);
+    if (r2 > 1.0)
+        discard;
+
+#if SURFEL_PASS == 0
+    hit += ray * (depth_offset * fRadius);
+#endif
+    vec4 clip    = projection * vec4(hit, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+#if SURFEL_PASS == 0
+    FragColor = vec4(0.0);
+#else
+    float weight = exp(-2.0 * r2); // gaussian whose standard deviation is half the radius
+    FragColor    = vec4(fColor * weight, weight);
+#endif
+}
+    )";
+
+static const char* resolveVertexShader = R"(#version 450 core
+
+void main()
+{
+    vec2 p      = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+    )";
+
+static const char* resolveFragmentShader = R"(#version 450 core
+
+layout(location = 0) out vec4 FragColor;
+
+uniform sampler2D sums;
+uniform sampler2D depth;
+uniform ivec2     viewport_origin;
+
+void main()
+{
+    ivec2 p   = ivec2(gl_FragCoord.xy) - viewport_origin;
+    vec4  sum = texelFetch(sums, p, 0);
+    if (sum.a <= 0.0)
+        discard;
+    FragColor    = vec4(sum.rgb / sum.a, 1.0);
+    gl_FragDepth = texelFetch(depth, p, 0).r;
+}
+    )";
+
+SurfelRenderer::~SurfelRenderer() {
+  if (!initialized)
+    return;
+  glDeleteProgram(visibility_program);
+  glDeleteProgram(accumulation_program);
+  glDeleteProgram(resolve_program);
+  glDeleteVertexArrays(1, &resolve_vao);
+}
+
+bool SurfelRenderer::init(const std::string& vertex_shader) {
+  if (initialized)
+    return true;
+  GLuint* programs[] = { &visibility_program, &accumulation_program };
+  for (int pass = 0; pass < 2; pass++) {
+    const std::string defines = fmt::format("#version 450 core\n#define SURFEL_PASS {}\n", pass);
+    *programs[pass]           = create_shader_program((defines + vertex_shader).c_str(), (defines + splatFragmentShader).c_str());
+  }
+  resolve_program = create_shader_program(resolveVertexShader, resolveFragmentShader);
+  if (!visibility_program || !accumulation_program || !resolve_program) {
+    spdlog::warn("Surfel shaders failed to compile");
+    // deleting program 0 is silently ignored
+    for (GLuint* program : { &visibility_program, &accumulation_program, &resolve_program }) {
+      glDeleteProgram(*program);
+      *program = 0;
+    }
+    return false;
+  }
+  glGenVertexArrays(1, &resolve_vao);
+  initialized = true;
+  return true;
+}
+
+void SurfelRenderer::resize(int width, int height) {
+  target.resize(width, height);
+}
+
+GLuint SurfelRenderer::begin_visibility() {
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+  target.bind();
+  const GLfloat no_weight[4] { 0.0f, 0.0f, 0.0f, 0.0f };
+  const GLfloat far_plane = 1.0f;
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glDepthMask(GL_TRUE);
+  glClearBufferfv(GL_COLOR, 0, no_weight);
+  glClearBufferfv(GL_DEPTH, 0, &far_plane);
+
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LESS);
+  glUseProgram(visibility_program);
+  shader_set_uniform(visibility_program, "target_size", glm::vec2(glm::ivec2(target.get_width(), target.get_height())));
+  return visibility_program;
+}
+
+GLuint SurfelRenderer::begin_accumulation() {
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glDepthMask(GL_FALSE);
+  glDepthFunc(GL_LEQUAL);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  glUseProgram(accumulation_program);
+  shader_set_uniform(accumulation_program, "target_size", glm::vec2(glm::ivec2(target.get_width(), target.get_height())));
+  return accumulation_program;
+}
+
+void SurfelRenderer::resolve(int x, int y) {
+  glDisable(GL_BLEND);
+  glDepthMask(GL_TRUE);
+  glDepthFunc(GL_LESS);
+  glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+  glViewport(x, y, target.get_width(), target.get_height());
+
+  glUseProgram(resolve_program);
+  shader_set_uniform(resolve_program, "sums", 0);
+  shader_set_uniform(resolve_program, "depth", 1);
+  shader_set_uniform(resolve_program, "viewport_origin", glm::ivec2(x, y));
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, target.get_color_texture());
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, target.get_depth_texture());
+  glBindVertexArray(resolve_vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "RenderTarget.h"
+#include <glad/glad.h>
+#include <string>
+
+/**
+ * @brief splats every point as a disc lying in the plane of its normal, averaging overlapping discs.
+ * @details Three passes over an offscreen `GL_RGBA16F` target:
+ * - visibility: the discs write only their depth, pushed back by `depth_offset` radii, so the
+ *   nearest surface ends up in the depth buffer;
+ * - accumulation: the discs are drawn again with depth writes off and additive blending; those
+ *   passing the depth test, i.e. within the offset of the nearest surface, add their color times a
+ *   gaussian weight of the distance to their center, and the weight itself in alpha;
+ * - resolve: a full-screen triangle divides the sums by the weights into the framebuffer that was
+ *   bound before, writing the visibility depth along with the color.
+ *
+ * Discs are `GL_POINTS` sprites: the fragment shader intersects the view ray of the pixel with the
+ * plane of the disc and discards the pixels outside it, so the footprint follows the orientation of
+ * the surface. Points without a normal get a disc facing the camera. The two splatting programs are
+ * compiled from the caller's vertex shader with `SURFEL_PASS` defined to 0 and 1; besides the
+ * vertex color it must output the center, normal and radius of the disc in view space.
+ *
+ * Usage:
+ * ```cpp
+ * SurfelRenderer surfels;
+ * if (surfels.init(vertex_shader)) {
+ *   surfels.resize(width, height);
+ *   for (GLuint program : { surfels.begin_visibility(), surfels.begin_accumulation() })
+ *     draw_points(program); // set the uniforms of the vertex shader and draw the clouds
+ *   surfels.resolve(viewport_x, viewport_y);
+ * }
+ * ```
+ */
+class SurfelRenderer {
+ private:
+  GLuint       visibility_program { 0 };
+  GLuint       accumulation_program { 0 };
+  GLuint       resolve_program { 0 };
+  GLuint       resolve_vao { 0 };
+  RenderTarget target { GL_RGBA16F }; // weighted color sums with the weights in alpha, and the visibility depth
+  GLint        previous_framebuffer { 0 };
+  bool         initialized { false };
+
+ public:
+  SurfelRenderer() = default;
+  ~SurfelRenderer();
+
+  SurfelRenderer(const SurfelRenderer&)            = delete;
+  SurfelRenderer& operator=(const SurfelRenderer&) = delete;
+
+  /**
+   * @brief compile the programs, returns false if one of them fails
+   * @param vertex_shader GLSL source of the splat vertex shader without its `#version` line
+   */
+  bool init(const std::string& vertex_shader);
+  /** reallocate the offscreen target, no-op when the size is unchanged */
+  void resize(int width, int height);
+  /** bind and clear the offscreen target and start the depth-only pass; returns its program, in use */
+  GLuint begin_visibility();
+  /** start the blending pass over the depth of the visibility pass; returns its program, in use */
+  GLuint begin_accumulation();
+  /** divide the sums by the weights into the framebuffer bound before `begin_visibility`, at (x, y), and restore the depth and blend state */
+  void resolve(int x, int y);
+
+  inline bool is_initialized() const { return initialized; }
+};
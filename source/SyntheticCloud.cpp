@@ -0,0 +1,235 @@
+#include "SyntheticCloud.h"
+#include "Parallel.h"
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+namespace fs = std::filesystem;
+
+static constexpr size_t BLOCK_SIZE = 1 << 16;
+static constexpr float  PI         = 3.14159265358979f;
+
+/**
+ * @brief small self-contained generator, unlike the `<random>` distributions its output is the
+ * same with every standard library.
+ */
+class BlockRandom {
+ private:
+  uint64_t state;
+
+ public:
+  static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+  BlockRandom(uint64_t seed, uint64_t stream)
+      : state { splitmix64(seed ^ splitmix64(stream + 1)) } {}
+
+  inline uint64_t next() {
+    state += 0x9E3779B97F4A7C15ull;
+    return splitmix64(state);
+  }
+  /** uniform in [0, 1) */
+  inline float uniform() { return static_cast<float>(next() >> 40) * (1.0f / 16777216.0f); }
+  /** uniform in [lo, hi) */
+  inline float uniform(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+  /** standard normal, Box-Muller */
+  inline float gaussian() {
+    float u = std::max(uniform(), 1e-7f);
+    return std::sqrt(-2.0f * std::log(u)) * std::cos(2.0f * PI * uniform());
+  }
+  inline glm::vec3 unit_vector() {
+    glm::vec3 v(gaussian(), gaussian(), gaussian());
+    float     length = glm::length(v);
+    return length > 1e-6f ? v / length : glm::vec3(0.0f, 0.0f, 1.0f);
+  }
+};
+
+std::optional<Distribution> parse_distribution(const std::string& name) {
+  if (name == "box")
+    return Distribution::UniformBox;
+  if (name == "scanlines")
+    return Distribution::ScanLines;
+  if (name == "clusters")
+    return Distribution::GaussianClusters;
+  if (name == "sphere")
+    return Distribution::SphereShell;
+  return std::nullopt;
+}
+
+static std::vector<glm::vec3> cluster_centers(const SyntheticCloudOptions& options) {
+  std::vector<glm::vec3> centers(std::max<size_t>(options.clusters, 1));
+  BlockRandom            random(options.seed, ~0ull);
+  const float            half = options.extent * 0.4f;
+  for (auto& center : centers)
+    center = glm::vec3(random.uniform(-half, half), random.uniform(-half, half), random.uniform(-half, half));
+  return centers;
+}
+
+/** fill the points of block `block`, `normals` and `colors` may be null */
+static void generate_block(const SyntheticCloudOptions& options, const std::vector<glm::vec3>& centers, size_t block,
+                           glm::vec3* points, glm::vec3* normals, glm::vec3* colors) {
+  BlockRandom  random(options.seed, block);
+  const size_t first = block * BLOCK_SIZE;
+  const size_t count = std::min(BLOCK_SIZE, options.count - first);
+  const float  half  = options.extent * 0.5f;
+
+  // scan lines: about sqrt(count) lines of sqrt(count) points over a gently rolling surface
+  const size_t lines     = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(options.count))));
+  const size_t per_line  = (options.count + lines - 1) / lines;
+  const float  amplitude = options.extent * 0.02f;
+  const float  frequency = 6.0f * PI / options.extent;
+
+  for (size_t j = 0; j < count; j++) {
+    glm::vec3 p, n;
+    switch (options.distribution) {
+    case Distribution::UniformBox:
+      p = glm::vec3(random.uniform(-half, half), random.uniform(-half, half), random.uniform(-half, half));
+      n = random.unit_vector();
+      break;
+    case Distribution::ScanLines: {
+      const size_t i    = first + j;
+      const float  t    = (static_cast<float>(i % per_line) + random.uniform()) / static_cast<float>(per_line);
+      const float  line = static_cast<float>(i / per_line) / static_cast<float>(lines);
+      p.x               = (t - 0.5f) * options.extent;
+      p.y               = (line - 0.5f) * options.extent + random.gaussian() * options.extent * 1e-4f;
+      p.z               = amplitude * std::sin(p.x * frequency) * std::cos(p.y * frequency) + random.gaussian() * options.extent * 1e-4f;
+      const float dzdx  = amplitude * frequency * std::cos(p.x * frequency) * std::cos(p.y * frequency);
+      const float dzdy  = -amplitude * frequency * std::sin(p.x * frequency) * std::sin(p.y * frequency);
+      n                 = glm::normalize(glm::vec3(-dzdx, -dzdy, 1.0f));
+      break;
+    }
+    case Distribution::GaussianClusters: {
+      const auto&  center = centers[std::min(centers.size() - 1, static_cast<size_t>(random.uniform() * static_cast<float>(centers.size())))];
+      const float  sigma  = options.extent * 0.05f;
+      const auto   offset = glm::vec3(random.gaussian(), random.gaussian(), random.gaussian()) * sigma;
+      const float  length = glm::length(offset);
+      p                   = center + offset;
+      n                   = length > 1e-6f ? offset / length : glm::vec3(0.0f, 0.0f, 1.0f);
+      break;
+    }
+    case Distribution::SphereShell:
+      n = random.unit_vector();
+      p = n * (half * (1.0f + 0.005f * random.gaussian()));
+      break;
+    }
+    points[j] = p;
+    if (normals)
+      normals[j] = n;
+    if (colors)
+      colors[j] = glm::clamp(p / options.extent + 0.5f, 0.0f, 1.0f);
+  }
+}
+
+PointCloud generate_synthetic_cloud(const SyntheticCloudOptions& options) {
+  PointCloud cloud;
+  cloud.points.resize(options.count);
+  if (options.normals)
+    cloud.normals.resize(options.count);
+  if (options.colors)
+    cloud.colors.resize(options.count);
+
+  const auto   centers     = cluster_centers(options);
+  const size_t block_count = (options.count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  parallel_for(0, block_count, [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; block++) {
+      const size_t first = block * BLOCK_SIZE;
+      generate_block(options, centers, block, &cloud.points[first],
+                     options.normals ? &cloud.normals[first] : nullptr,
+                     options.colors ? &cloud.colors[first] : nullptr);
+    }
+  }, 1);
+  cloud.update_bbox();
+  return cloud;
+}
+
+void write_synthetic_cloud(const SyntheticCloudOptions& options, const std::string& path) {
+  const char*   extensions[3] = { ".xyz", ".normals", ".colors" };
+  const bool    enabled[3]    = { true, options.normals, options.colors };
+  std::ofstream files[3];
+  std::string   filenames[3], partial[3]; // written under `partial` and renamed once complete
+  auto          fail = [&](const std::string& filename) {
+    for (int k = 0; k < 3; k++) {
+      files[k].close();
+      std::error_code ignored;
+      if (!partial[k].empty())
+        fs::remove(partial[k], ignored);
+    }
+    spdlog::critical("Could not write synthetic cloud to file {}", filename);
+    throw std::runtime_error("failed to write synthetic cloud.");
+  };
+  for (int k = 0; k < 3; k++) {
+    if (!enabled[k])
+      continue;
+    filenames[k] = fs::path(path).replace_extension(extensions[k]).string();
+    partial[k]   = filenames[k] + ".part";
+    files[k].open(partial[k], std::ios::binary);
+    if (!files[k].is_open())
+      fail(filenames[k]);
+  }
+
+  // blocks are formatted a wave at a time while the previous wave is being written
+  const auto   centers     = cluster_centers(options);
+  const size_t block_count = (options.count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  const size_t wave_size   = std::max<size_t>(1, ThreadPool::global().size() * 2);
+  std::vector<std::string> waves[2] { std::vector<std::string>(wave_size * 3), std::vector<std::string>(wave_size * 3) };
+  std::future<void>        writer;
+
+  for (size_t wave_begin = 0, wave = 0; wave_begin < block_count; wave_begin += wave_size, wave ^= 1) {
+    const size_t              wave_end = std::min(block_count, wave_begin + wave_size);
+    std::vector<std::string>& texts    = waves[wave];
+    parallel_for(wave_begin, wave_end, [&](size_t begin, size_t end) {
+      std::vector<glm::vec3> attributes[3] { std::vector<glm::vec3>(BLOCK_SIZE), std::vector<glm::vec3>(BLOCK_SIZE), std::vector<glm::vec3>(BLOCK_SIZE) };
+      fmt::memory_buffer     buffer;
+      for (size_t block = begin; block < end; block++) {
+        const size_t count = std::min(BLOCK_SIZE, options.count - block * BLOCK_SIZE);
+        generate_block(options, centers, block, attributes[0].data(),
+                       options.normals ? attributes[1].data() : nullptr,
+                       options.colors ? attributes[2].data() : nullptr);
+        for (int k = 0; k < 3; k++) {
+          if (!enabled[k])
+            continue;
+          buffer.clear();
+          for (size_t j = 0; j < count; j++) {
+            const auto& v = attributes[k][j];
+            fmt::format_to(std::back_inserter(buffer), "{} {} {}\n", v.x, v.y, v.z);
+          }
+          texts[(block - wave_begin) * 3 + k].assign(buffer.data(), buffer.size());
+        }
+      }
+    }, 1);
+
+    if (writer.valid())
+      writer.get();
+    writer = std::async(std::launch::async, [&files, &enabled, &texts, blocks = wave_end - wave_begin] {
+      for (size_t b = 0; b < blocks; b++)
+        for (int k = 0; k < 3; k++)
+          if (enabled[k])
+            files[k].write(texts[b * 3 + k].data(), static_cast<std::streamsize>(texts[b * 3 + k].size()));
+    });
+  }
+  if (writer.valid())
+    writer.get();
+
+  for (int k = 0; k < 3; k++) {
+    if (!enabled[k])
+      continue;
+    files[k].close();
+    if (!files[k])
+      fail(filenames[k]);
+  }
+  for (int k = 0; k < 3; k++) {
+    std::error_code error;
+    if (enabled[k])
+      fs::rename(partial[k], filenames[k], error);
+    if (error)
+      fail(filenames[k]);
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "PointCloud.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/** @brief shape of a generated point cloud */
+enum class Distribution {
+  UniformBox,       ///< uniform inside an axis-aligned box
+  ScanLines,        ///< parallel scan lines across the z = 0 plane, like a terrestrial scan
+  GaussianClusters, ///< isotropic gaussian blobs around random centers
+  SphereShell,      ///< thin shell around the origin
+};
+
+/** parse "box", "scanlines", "clusters" or "sphere", returns nothing for other names */
+std::optional<Distribution> parse_distribution(const std::string& name);
+
+/** changes whenever the generator makes different points for the same options, so files written by an older one can be told apart */
+static constexpr int SYNTHETIC_CLOUD_VERSION = 1;
+
+/** @brief parameters of a synthetic point cloud, the same options and seed always give the same points */
+struct SyntheticCloudOptions {
+  size_t       count { 1000000 };
+  Distribution distribution { Distribution::UniformBox };
+  uint64_t     seed { 0 };
+  float        extent { 100.0f }; // edge length of the box holding the cloud
+  size_t       clusters { 16 };   // for GaussianClusters
+  bool         normals { false };
+  bool         colors { false };
+};
+
+/**
+ * @brief generate a synthetic point cloud in memory, in parallel
+ * @details Points are produced in fixed-size blocks, each with its own random stream derived from
+ * the seed and the block index, so the result does not depend on the number of threads.
+ */
+PointCloud generate_synthetic_cloud(const SyntheticCloudOptions& options);
+
+/**
+ * @brief stream a synthetic point cloud to plain text files without holding it in memory
+ * @details Writes `<stem>.xyz`, plus `<stem>.normals` and `<stem>.colors` when requested, in the
+ * format read by `PointCloud::load_points` and friends. Blocks are generated and formatted on the
+ * thread pool and written in order, so the files match `generate_synthetic_cloud` point for point.
+ * Each file is written under a `.part` name and renamed once complete, so a failed or interrupted
+ * run leaves no truncated file behind. Throws `std::runtime_error` when a file cannot be written.
+ * @param path output path, its extension is replaced for each file
+ */
+void write_synthetic_cloud(const SyntheticCloudOptions& options, const std::string& path);
@@ -0,0 +1,379 @@
+#include "TileSet.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+namespace fs = std::filesystem;
+
+/** `*` matches any run of characters, `?` any single one */
+static bool glob_match(const char* pattern, const char* name) {
+  const char* star      = nullptr; // last `*` seen, and where its match ends so far
+  const char* star_name = nullptr;
+  while (*name) {
+    if (*pattern == '?' || (*pattern != '*' && *pattern == *name)) {
+      pattern++;
+      name++;
+    } else if (*pattern == '*') {
+      star      = pattern++;
+      star_name = name;
+    } else if (star) {
+      pattern = star + 1;
+      name    = ++star_name;
+    } else {
+      return false;
+    }
+  }
+  while (*pattern == '*')
+    pattern++;
+  return *pattern == '\0';
+}
+
+static bool has_wildcards(const std::string& name) {
+  return name.find_first_of("*?") != std::string::npos;
+}
+
+static bool is_tile_file(const fs::path& path) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return extension == ".ply" || extension == ".xyz" || extension == ".txt";
+}
+
+/** modification time of `path` in the file clock's ticks, only compared with itself */
+static long long modified_time(const fs::path& path) {
+  std::error_code error;
+  return static_cast<long long>(fs::last_write_time(path, error).time_since_epoch().count());
+}
+
+/** bytes held by the arrays of `cloud` */
+static size_t cloud_bytes(const PointCloud& cloud) {
+  size_t bytes = (cloud.points.size() + cloud.colors.size() + cloud.normals.size()) * sizeof(glm::vec3);
+  for (const auto& attribute : cloud.attributes)
+    bytes += attribute.size() * attribute.stride();
+  return bytes;
+}
+
+/** interleave the low 10 bits of `x`, `y` and `z` */
+static uint32_t morton_code(uint32_t x, uint32_t y, uint32_t z) {
+  uint32_t code = 0;
+  for (uint32_t bit = 0; bit < 10; bit++)
+    code |= ((x >> bit) & 1u) << (3 * bit) | ((y >> bit) & 1u) << (3 * bit + 1) | ((z >> bit) & 1u) << (3 * bit + 2);
+  return code;
+}
+
+std::vector<std::string> TileSet::expand(const std::string& pattern) {
+  const fs::path           path(pattern);
+  std::vector<std::string> files;
+  std::error_code          error;
+  if (fs::is_directory(path, error)) {
+    for (const auto& entry : fs::directory_iterator(path, error))
+      if (entry.is_regular_file(error) && is_tile_file(entry.path()))
+        files.push_back(entry.path().string());
+  } else if (has_wildcards(path.filename().string())) {
+    const fs::path    directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    const std::string glob      = path.filename().string();
+    for (const auto& entry : fs::directory_iterator(directory, error))
+      if (entry.is_regular_file(error) && is_tile_file(entry.path()) && glob_match(glob.c_str(), entry.path().filename().string().c_str()))
+        files.push_back(entry.path().string());
+  } else {
+    files.push_back(pattern);
+  }
+  if (error)
+    spdlog::warn("{}: {}", pattern, error.message());
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+bool TileSet::is_pattern(const std::string& pattern) {
+  std::error_code error;
+  return fs::is_directory(pattern, error) || has_wildcards(fs::path(pattern).filename().string());
+}
+
+TileSet::TileSet(const std::vector<std::string>& paths, Loader loader_, size_t memory_budget)
+    : loader { std::move(loader_) }
+    , budget { memory_budget }
+    , max_loads { std::max<size_t>(ThreadPool::global().size() / 2, 1) } {
+  tiles.resize(paths.size());
+  for (size_t t = 0; t < paths.size(); t++)
+    tiles[t].path = paths[t];
+  read_bounds();
+
+  // bounds come relative to the origin of their own tile, they are moved to the one of the first tile
+  auto first = std::find_if(tiles.begin(), tiles.end(), [](const Tile& tile) { return !tile.bounds.empty(); });
+  if (first == tiles.end())
+    throw std::runtime_error("no tile could be read");
+  origin = first->origin;
+  Bounds all;
+  for (auto& tile : tiles) {
+    if (tile.bounds.empty())
+      continue;
+    const glm::vec3 offset(tile.origin - origin);
+    tile.bounds = Bounds { tile.bounds.min + offset, tile.bounds.max + offset };
+    all.extend(tile.bounds);
+  }
+
+  // neighbouring tiles end up under the same nodes of the tree, so `select` prunes whole regions
+  const glm::vec3       extent = glm::max(all.max - all.min, glm::vec3(1e-30f));
+  std::vector<uint32_t> codes(tiles.size(), UINT32_MAX);
+  for (size_t t = 0; t < tiles.size(); t++) {
+    if (tiles[t].bounds.empty())
+      continue;
+    const glm::vec3 cell = glm::clamp((tiles[t].bounds.min + tiles[t].bounds.max) * 0.5f - all.min, glm::vec3(0.0f), extent) / extent * 1023.0f;
+    codes[t]             = morton_code(static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y), static_cast<uint32_t>(cell.z));
+  }
+  std::vector<size_t> order(tiles.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return codes[a] < codes[b]; });
+  std::vector<Tile> sorted;
+  sorted.reserve(tiles.size());
+  for (size_t t : order)
+    sorted.push_back(std::move(tiles[t]));
+  tiles = std::move(sorted);
+
+  bounds_leaves = 1;
+  while (bounds_leaves < tiles.size())
+    bounds_leaves *= 2;
+  bounds_tree.assign(2 * bounds_leaves, Bounds());
+  for (size_t t = 0; t < tiles.size(); t++)
+    bounds_tree[bounds_leaves + t] = tiles[t].bounds;
+  for (size_t node = bounds_leaves - 1; node >= 1; node--) {
+    bounds_tree[node] = bounds_tree[2 * node];
+    bounds_tree[node].extend(bounds_tree[2 * node + 1]);
+  }
+
+  size_t points = 0;
+  for (const auto& tile : tiles)
+    points += tile.points;
+  spdlog::info("Tile set: {} tiles, {} points, {} MB budget", tiles.size(), points, budget >> 20);
+}
+
+TileSet::~TileSet() {
+  for (auto& load : loads) {
+    try {
+      load.cloud.get();
+    } catch (const std::exception&) {
+    }
+  }
+}
+
+void TileSet::read_bounds() {
+  PROFILE_SCOPE("tile_bounds");
+  struct Entry {
+    uintmax_t  size;
+    long long  modified;
+    size_t     points;
+    glm::dvec3 origin;
+    Bounds     bounds; // relative to `origin`
+  };
+  static const char* const header = "# size modified points origin_x origin_y origin_z min_x min_y min_z max_x max_y max_z name";
+  // one index per directory, keyed by file name
+  std::map<fs::path, std::map<std::string, Entry>> indices;
+  for (const auto& tile : tiles) {
+    const fs::path directory = fs::path(tile.path).parent_path();
+    if (indices.count(directory))
+      continue;
+    auto&         entries = indices[directory];
+    std::ifstream file(directory / INDEX_FILENAME);
+    std::string   line;
+    // an index in another layout is ignored, and replaced once its tiles are scanned
+    if (!std::getline(file, line) || line != header)
+      continue;
+    while (std::getline(file, line)) {
+      if (line.empty() || line[0] == '#')
+        continue;
+      std::istringstream stream(line);
+      Entry              entry {};
+      std::string        name;
+      stream >> entry.size >> entry.modified >> entry.points >> entry.origin.x >> entry.origin.y >> entry.origin.z >> entry.bounds.min.x >> entry.bounds.min.y >> entry.bounds.min.z >> entry.bounds.max.x
+          >> entry.bounds.max.y >> entry.bounds.max.z;
+      stream.get();
+      if (stream && std::getline(stream, name) && !name.empty())
+        entries[name] = entry;
+    }
+  }
+
+  // tiles missing from their index, or changed since it was written, are read once for their bounds
+  std::vector<size_t> stale;
+  std::vector<Entry>  current(tiles.size());
+  for (size_t t = 0; t < tiles.size(); t++) {
+    const fs::path  path(tiles[t].path);
+    std::error_code error;
+    current[t].size     = fs::file_size(path, error);
+    current[t].modified = modified_time(path);
+    const auto& entries = indices[path.parent_path()];
+    auto        entry   = entries.find(path.filename().string());
+    if (error) {
+      spdlog::error("{}: {}", tiles[t].path, error.message());
+      tiles[t].state = State::Failed;
+    } else if (entry != entries.end() && entry->second.size == current[t].size && entry->second.modified == current[t].modified) {
+      tiles[t].origin = entry->second.origin;
+      tiles[t].bounds = entry->second.bounds;
+      tiles[t].points = entry->second.points;
+    } else {
+      stale.push_back(t);
+    }
+  }
+  if (stale.empty())
+    return;
+
+  spdlog::info("Tile set: indexing {} of {} tiles", stale.size(), tiles.size());
+  auto start_us = Profiler::global().now_us();
+  parallel_for(0, stale.size(), [&](size_t begin, size_t end) {
+    for (size_t s = begin; s < end; s++) {
+      Tile& tile = tiles[stale[s]];
+      try {
+        PointCloud cloud;
+        cloud.load_points(tile.path);
+        tile.points = cloud.get_points().size();
+        tile.origin = cloud.origin;
+        if (tile.points > 0)
+          tile.bounds = Bounds { cloud.get_bbox_min(), cloud.get_bbox_max() };
+      } catch (const std::exception& e) {
+        spdlog::error("{}", e.what());
+        tile.state = State::Failed;
+      }
+    }
+  }, 1);
+  spdlog::info("Tile set: indexed {} tiles in {:.0f} ms", stale.size(), (Profiler::global().now_us() - start_us) / 1000.0);
+
+  // rewrite the indices of the directories that had stale tiles, keeping the entries of other files
+  std::map<fs::path, bool> dirty;
+  for (size_t t : stale) {
+    if (tiles[t].state == State::Failed)
+      continue;
+    const fs::path path(tiles[t].path);
+    Entry&         entry      = indices[path.parent_path()][path.filename().string()];
+    entry                     = current[t];
+    entry.points              = tiles[t].points;
+    entry.origin              = tiles[t].origin;
+    entry.bounds              = tiles[t].bounds;
+    dirty[path.parent_path()] = true;
+  }
+  for (const auto& [directory, unused] : dirty) {
+    std::ofstream file(directory / INDEX_FILENAME);
+    file << std::setprecision(17) << header << '\n'; // enough for doubles, and floats, to read back exactly
+    for (const auto& [name, entry] : indices[directory])
+      file << entry.size << ' ' << entry.modified << ' ' << entry.points << ' ' << entry.origin.x << ' ' << entry.origin.y << ' ' << entry.origin.z << ' '
+           << entry.bounds.min.x << ' ' << entry.bounds.min.y << ' '
+           << entry.bounds.min.z << ' ' << entry.bounds.max.x << ' ' << entry.bounds.max.y << ' ' << entry.bounds.max.z << ' ' << name << '\n';
+    if (!file)
+      spdlog::warn("could not write the tile index {}, tiles will be indexed again next time", (directory / INDEX_FILENAME).string());
+  }
+}
+
+size_t TileSet::count(State state) const {
+  return static_cast<size_t>(std::count_if(tiles.begin(), tiles.end(), [&](const Tile& tile) { return tile.state == state; }));
+}
+
+std::vector<size_t> TileSet::select(const std::function<Coverage(const Bounds&)>& classify) const {
+  std::vector<size_t> selected;
+  if (tiles.empty())
+    return selected;
+
+  std::vector<size_t> stack { 1 };
+  while (!stack.empty()) {
+    const size_t node = stack.back();
+    stack.pop_back();
+    const Bounds& bounds = bounds_tree[node];
+    if (bounds.empty())
+      continue;
+    const Coverage coverage = classify(bounds);
+    if (coverage == Coverage::None)
+      continue;
+    if (node < bounds_leaves) {
+      stack.push_back(2 * node + 1);
+      stack.push_back(2 * node);
+      continue;
+    }
+    selected.push_back(node - bounds_leaves);
+  }
+  return selected;
+}
+
+void TileSet::release(size_t t) {
+  resident_bytes -= std::min(resident_bytes, tiles[t].bytes);
+  tiles[t].state = State::Unloaded;
+}
+
+std::vector<size_t> TileSet::update(const std::vector<size_t>& wanted) {
+  frame++;
+  for (size_t t : wanted)
+    tiles[t].last_used = frame;
+
+  // loaded tiles this update does not want, least recently used first
+  std::vector<size_t> idle;
+  for (size_t t = 0; t < tiles.size(); t++)
+    if (tiles[t].state == State::Loaded && tiles[t].last_used < frame)
+      idle.push_back(t);
+  std::sort(idle.begin(), idle.end(), [&](size_t a, size_t b) { return tiles[a].last_used < tiles[b].last_used; });
+  size_t              next_idle = 0;
+  std::vector<size_t> evicted;
+  auto                make_room = [&](size_t bytes) {
+    while (resident_bytes + bytes > budget && next_idle < idle.size()) {
+      release(idle[next_idle]);
+      evicted.push_back(idle[next_idle++]);
+    }
+    return resident_bytes + bytes <= budget;
+  };
+
+  // loads that finished bigger than estimated may have overrun the budget
+  make_room(0);
+  for (size_t t : wanted) {
+    Tile& tile = tiles[t];
+    if (tile.state != State::Unloaded)
+      continue;
+    if (loads.size() >= max_loads)
+      break;
+    // positions, colors and normals until a tile has been measured
+    const double bytes_per_point = measured_points > 0 ? static_cast<double>(measured_bytes) / static_cast<double>(measured_points) : 3 * sizeof(glm::vec3);
+    tile.bytes                   = static_cast<size_t>(static_cast<double>(tile.points) * bytes_per_point);
+    if (!make_room(tile.bytes) && resident_bytes > 0)
+      break;
+    tile.state = State::Loading;
+    resident_bytes += tile.bytes;
+    loads.push_back({ t, ThreadPool::global().submit([loader = loader, path = tile.path] {
+                        PROFILE_SCOPE("load_tile");
+                        return loader(path);
+                      }) });
+  }
+  return evicted;
+}
+
+std::vector<std::pair<size_t, PointCloud>> TileSet::take_loaded() {
+  std::vector<std::pair<size_t, PointCloud>> loaded;
+  for (size_t l = 0; l < loads.size();) {
+    Load& load = loads[l];
+    if (load.cloud.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      l++;
+      continue;
+    }
+    Tile& tile = tiles[load.tile];
+    try {
+      PointCloud cloud = load.cloud.get();
+      // account for what the tile really takes, and estimate the next ones from it
+      const size_t bytes = cloud_bytes(cloud);
+      resident_bytes     = resident_bytes - std::min(resident_bytes, tile.bytes) + bytes;
+      measured_bytes += bytes;
+      measured_points += tile.points;
+      tile.bytes = bytes;
+      tile.state = State::Loaded;
+      loaded.emplace_back(load.tile, std::move(cloud));
+    } catch (const std::exception& e) {
+      spdlog::error("{}: {}", tile.path, e.what());
+      release(load.tile);
+      tile.state = State::Failed;
+    }
+    if (&load != &loads.back())
+      load = std::move(loads.back());
+    loads.pop_back();
+  }
+  return loaded;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "Bounds.h"
+#include "PointCloud.h"
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief a point cloud split over many files, read tile by tile as the view needs them, within a memory budget
+ * @details The bounds and point count of every tile come from a `.tile_bounds` index next to the
+ * tiles; tiles missing from it, or changed since, are scanned once in parallel and the index is
+ * rewritten. The tile bounds are the leaves of a reduction tree like the chunk bounds of
+ * `PointCloud`, over the tiles sorted along a Morton curve, so `select` skips whole regions of
+ * tiles at once. Every tile keeps the double-precision origin its loader picks; the tile bounds are
+ * relative to `origin`, the one of the first tile, so they stay precise for georeferenced tiles.
+ *
+ * `update` takes the tiles the view wants, most important first, and starts loading them on the
+ * thread pool while the budget allows, evicting the tiles left unused the longest to make room.
+ * Finished loads are collected by `take_loaded`. The tile set only accounts for the memory: the
+ * clouds belong to the caller, which must drop the tiles `update` evicts.
+ *
+ * Usage:
+ * ```cpp
+ * TileSet tiles(TileSet::expand("survey"), [](const std::string& path) { return PointCloud().load_points(path); }, 2ull << 30);
+ * for (size_t tile : tiles.update(tiles.select(classify)))
+ *   drop(tile);
+ * for (auto& [tile, cloud] : tiles.take_loaded())
+ *   show(tile, std::move(cloud));
+ * ```
+ */
+class TileSet {
+ public:
+  /** @brief residency of a tile */
+  enum class State {
+    Unloaded,
+    Loading,
+    Loaded,
+    Failed, ///< the loader threw, the tile is not retried
+  };
+
+  struct Tile {
+    std::string path;
+    glm::dvec3  origin { 0.0 }; // of the loaded cloud, see `PointCloud::origin`
+    Bounds      bounds;         // relative to the origin of the tile set
+    size_t      points { 0 }; // as stored in the file, before any filter of the loader
+    size_t      bytes { 0 };  // memory of the loaded cloud, estimated from `points` until it is loaded
+    State       state { State::Unloaded };
+    uint64_t    last_used { 0 }; // last `update` that wanted the tile
+  };
+
+  /** reads one tile, called on a worker thread; may throw */
+  using Loader = std::function<PointCloud(const std::string&)>;
+
+  /** name of the index file written in every directory holding tiles */
+  static constexpr const char* INDEX_FILENAME = ".tile_bounds";
+
+ private:
+  std::vector<Tile> tiles;
+  glm::dvec3        origin { 0.0 };
+  Loader            loader;
+  size_t            budget;                                    // bytes
+  size_t            resident_bytes { 0 };                      // tiles loaded or loading
+  size_t            measured_bytes { 0 };                      // memory and file point counts of every tile loaded so far,
+  size_t            measured_points { 0 };                     // their ratio estimates the tiles not loaded yet
+  uint64_t          frame { 0 };                               // number of `update` calls
+  size_t            max_loads;                                 // concurrent loads, half the pool so rendering keeps threads
+
+  // reduction tree over the tile bounds: node 1 is the root, node i has children 2i and 2i + 1,
+  // tile t is node `bounds_leaves + t`
+  std::vector<Bounds> bounds_tree;
+  size_t              bounds_leaves { 0 };
+
+  struct Load {
+    size_t                  tile;
+    std::future<PointCloud> cloud;
+  };
+  std::vector<Load> loads;
+
+  /** fill the bounds and point counts from the index files, scanning the tiles they miss */
+  void read_bounds();
+  /** mark loaded tile `t` unloaded and give back its memory */
+  void release(size_t t);
+
+ public:
+  /**
+   * @brief the tile files named by `pattern`: a directory, a glob like `tiles/tile_*.ply` or a single file
+   * @details Directories and globs yield the `.ply`, `.xyz` and `.txt` files in them, sorted by name;
+   * `*` and `?` are only expanded in the last path component.
+   */
+  static std::vector<std::string> expand(const std::string& pattern);
+
+  /** true when `pattern` names a directory or a glob rather than a single file */
+  static bool is_pattern(const std::string& pattern);
+
+  /** @param memory_budget bytes the loaded tiles may take; throws when no tile can be indexed */
+  TileSet(const std::vector<std::string>& paths, Loader loader_, size_t memory_budget);
+  /** waits for the loads still running */
+  ~TileSet();
+
+  TileSet(const TileSet&)            = delete;
+  TileSet& operator=(const TileSet&) = delete;
+
+  inline const std::vector<Tile>& get_tiles() const { return tiles; }
+  inline const Tile&              get_tile(size_t t) const { return tiles[t]; }
+  inline size_t                   size() const { return tiles.size(); }
+  /** position the tile bounds are relative to */
+  inline const glm::dvec3& get_origin() const { return origin; }
+  /** bounds of every tile, loaded or not, relative to `get_origin` */
+  inline Bounds get_bounds() const { return bounds_tree.size() > 1 ? bounds_tree[1] : Bounds(); }
+  inline size_t get_resident_bytes() const { return resident_bytes; }
+  inline size_t get_budget() const { return budget; }
+  inline void   set_budget(size_t bytes) { budget = bytes; }
+  inline bool   is_loading() const { return !loads.empty(); }
+  /** number of tiles in `state` */
+  size_t count(State state) const;
+
+  /**
+   * @brief tiles whose bounds `classify` does not rate `Coverage::None`
+   * @details Walks the tile bounds tree from the root, like `PointCloud::select_chunks`.
+   */
+  std::vector<size_t> select(const std::function<Coverage(const Bounds&)>& classify) const;
+
+  /**
+   * @brief start loading the `wanted` tiles, most important first, and return the tiles evicted for them
+   * @details Loaded tiles that are not wanted stay cached until their memory is needed. When the
+   * budget is full a load waits for a later call, except when nothing is resident, so a single tile
+   * larger than the budget still shows.
+   */
+  std::vector<size_t> update(const std::vector<size_t>& wanted);
+
+  /** the clouds of the loads finished since the last call, with their tile */
+  std::vector<std::pair<size_t, PointCloud>> take_loaded();
+};
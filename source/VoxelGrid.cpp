@@ -0,0 +1,147 @@
+#include "VoxelGrid.h"
+#include "Parallel.h"
+#include <glm/gtx/string_cast.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static constexpr size_t   BLOCK_SIZE   = 1 << 16;
+static constexpr size_t   BUCKET_COUNT = 256;
+static constexpr uint64_t AXIS_BITS    = 21; // three 21-bit cell coordinates per key
+
+static inline size_t bucket_of(uint64_t key) {
+  return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 56);
+}
+
+PointCloud voxel_grid_filter(const PointCloud& cloud, float leaf_size, VoxelReduction reduction) {
+  const auto&  points      = cloud.get_points();
+  const size_t count       = points.size();
+  const bool   has_colors  = cloud.colors.size() == count;
+  const bool   has_normals = cloud.normals.size() == count;
+
+  if (!(leaf_size > 0.0f)) {
+    spdlog::critical("Voxel leaf size must be positive, got {}", leaf_size);
+    throw std::runtime_error("invalid voxel leaf size.");
+  }
+  const glm::vec3 lower = cloud.get_bbox_min();
+  const glm::vec3 cells = glm::floor((cloud.get_bbox_max() - lower) / leaf_size);
+  if (count > 0 && std::max({ cells.x, cells.y, cells.z }) >= static_cast<float>(1u << AXIS_BITS)) {
+    spdlog::critical("Voxel leaf size {} is too small for a cloud of extent {}", leaf_size, glm::to_string(cloud.get_bbox_max() - lower));
+    throw std::runtime_error("invalid voxel leaf size.");
+  }
+
+  // ---- voxel key of every point, and how many points of each block fall in each bucket ----
+  std::vector<uint64_t> keys(count);
+  const size_t          block_count = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  std::vector<size_t>   offsets(block_count * BUCKET_COUNT, 0);
+  parallel_for(0, block_count, [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; block++) {
+      size_t* histogram = &offsets[block * BUCKET_COUNT];
+      for (size_t i = block * BLOCK_SIZE; i < std::min(count, (block + 1) * BLOCK_SIZE); i++) {
+        const glm::vec3 cell = glm::floor((points[i] - lower) / leaf_size);
+        keys[i]              = static_cast<uint64_t>(cell.x) | static_cast<uint64_t>(cell.y) << AXIS_BITS | static_cast<uint64_t>(cell.z) << (2 * AXIS_BITS);
+        histogram[bucket_of(keys[i])]++;
+      }
+    }
+  }, 1);
+
+  // ---- scatter point indices bucket by bucket, blocks in order so the result is deterministic ----
+  std::vector<size_t> bucket_begin(BUCKET_COUNT + 1, 0);
+  size_t              total = 0;
+  for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+    bucket_begin[bucket] = total;
+    for (size_t block = 0; block < block_count; block++) {
+      size_t n                                 = offsets[block * BUCKET_COUNT + bucket];
+      offsets[block * BUCKET_COUNT + bucket] = total;
+      total += n;
+    }
+  }
+  bucket_begin[BUCKET_COUNT] = total;
+
+  std::vector<uint32_t> bucketed(count);
+  parallel_for(0, block_count, [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; block++) {
+      size_t* next = &offsets[block * BUCKET_COUNT];
+      for (size_t i = block * BLOCK_SIZE; i < std::min(count, (block + 1) * BLOCK_SIZE); i++)
+        bucketed[next[bucket_of(keys[i])]++] = static_cast<uint32_t>(i);
+    }
+  }, 1);
+
+  // ---- reduce every bucket independently ----
+  struct Voxels {
+    std::vector<glm::vec3> points, colors, normals;
+    std::vector<uint32_t>  sources; // the input point whose attributes the voxel keeps
+  };
+  std::vector<Voxels> voxels(BUCKET_COUNT);
+  parallel_for(0, BUCKET_COUNT, [&](size_t begin, size_t end) {
+    for (size_t bucket = begin; bucket < end; bucket++) {
+      auto first = bucketed.begin() + static_cast<std::ptrdiff_t>(bucket_begin[bucket]);
+      auto last  = bucketed.begin() + static_cast<std::ptrdiff_t>(bucket_begin[bucket + 1]);
+      std::sort(first, last, [&](uint32_t a, uint32_t b) { return keys[a] < keys[b] || (keys[a] == keys[b] && a < b); });
+
+      Voxels& out = voxels[bucket];
+      for (auto run = first; run != last;) {
+        auto      run_end = std::find_if(run, last, [&](uint32_t i) { return keys[i] != keys[*run]; });
+        glm::vec3 position(0.0f), color(0.0f), normal(0.0f);
+        for (auto it = run; it != run_end; it++) {
+          position += points[*it];
+          if (has_colors)
+            color += cloud.colors[*it];
+          if (has_normals)
+            normal += cloud.normals[*it];
+        }
+        const float n = static_cast<float>(run_end - run);
+        position /= n;
+        uint32_t source = *run;
+        if (reduction == VoxelReduction::Representative) {
+          auto nearest = std::min_element(run, run_end, [&](uint32_t a, uint32_t b) {
+            return glm::dot(points[a] - position, points[a] - position) < glm::dot(points[b] - position, points[b] - position);
+          });
+          position = points[*nearest];
+          source   = *nearest;
+        }
+        out.points.push_back(position);
+        out.sources.push_back(source);
+        if (has_colors)
+          out.colors.push_back(color / n);
+        if (has_normals) {
+          // opposite normals cancel out, keep the first one rather than a zero vector
+          const float length = glm::length(normal);
+          out.normals.push_back(length > 1e-6f ? normal / length : cloud.normals[*run]);
+        }
+        run = run_end;
+      }
+    }
+  }, 1);
+
+  // ---- concatenate the buckets ----
+  std::vector<size_t> output_begin(BUCKET_COUNT + 1, 0);
+  for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+    output_begin[bucket + 1] = output_begin[bucket] + voxels[bucket].points.size();
+
+  PointCloud result;
+  result.origin = cloud.origin; // voxels were built on the offsets, so are the output points
+  result.points.resize(output_begin[BUCKET_COUNT]);
+  if (has_colors)
+    result.colors.resize(result.points.size());
+  if (has_normals)
+    result.normals.resize(result.points.size());
+  std::vector<uint32_t> sources(result.points.size());
+  parallel_for(0, BUCKET_COUNT, [&](size_t begin, size_t end) {
+    for (size_t bucket = begin; bucket < end; bucket++) {
+      const auto offset = static_cast<std::ptrdiff_t>(output_begin[bucket]);
+      std::copy(voxels[bucket].points.begin(), voxels[bucket].points.end(), result.points.begin() + offset);
+      if (has_colors)
+        std::copy(voxels[bucket].colors.begin(), voxels[bucket].colors.end(), result.colors.begin() + offset);
+      if (has_normals)
+        std::copy(voxels[bucket].normals.begin(), voxels[bucket].normals.end(), result.normals.begin() + offset);
+      std::copy(voxels[bucket].sources.begin(), voxels[bucket].sources.end(), sources.begin() + offset);
+    }
+  }, 1);
+  for (const auto& attribute : cloud.attributes)
+    if (attribute.size() == count)
+      result.attributes.add(attribute.get_name(), attribute.get_type(), attribute.get_components(), 0) = attribute.gather(sources);
+  result.update_bbox();
+  return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "PointCloud.h"
+
+/** @brief which position stands for the points of a voxel */
+enum class VoxelReduction {
+  Centroid,       ///< mean of the points
+  Representative, ///< the input point closest to the mean, keeps positions on the original samples
+};
+
+/**
+ * @brief keep one point per cubic voxel of edge `leaf_size`
+ * @details Points are hashed to voxels and bucketed in parallel, then every bucket is reduced
+ * independently. Colors and normals are averaged over the voxel when the cloud has one per point;
+ * normals are renormalized. Attributes, which may be categories like classification, are not averaged:
+ * a voxel keeps those of its first point, or of the representative. The output order only depends on the input, not on the thread count.
+ * Throws `std::runtime_error` when the leaf size is not positive or too small for the extent of the cloud.
+ */
+PointCloud voxel_grid_filter(const PointCloud& cloud, float leaf_size, VoxelReduction reduction = VoxelReduction::Centroid);
@@ -1,47 +1,165 @@
 #include "Window.h"
+#include "Parallel.h"
 #include "PointCloud.h"
+#include "Profiler.h"
 #include "Shader.h"
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/string_cast.hpp>
-
-extern PointCloud point_cloud;
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
 
 double mouse_scroll_state[2];
 void   scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
   spdlog::debug("Scrolling: {}, {}", xoffset, yoffset);
   mouse_scroll_state[0] = xoffset;
   mouse_scroll_state[1] = yoffset;
+  static_cast<Window*>(glfwGetWindowUserPointer(window))->RequestRedraw();
+}
+
+static void request_redraw(GLFWwindow* window) {
+  static_cast<Window*>(glfwGetWindowUserPointer(window))->RequestRedraw();
 }
 
-static const char* vertexShader = R"(#version 460 core
+/** bounds of the corners of `bounds` after `transform` */
+static Bounds transform_bounds(const glm::mat4& transform, const Bounds& bounds) {
+  Bounds result;
+  for (int corner = 0; corner < 8; corner++) {
+    const glm::vec3 p(corner & 1 ? bounds.max.x : bounds.min.x, corner & 2 ? bounds.max.y : bounds.min.y, corner & 4 ? bounds.max.z : bounds.min.z);
+    result.extend(glm::vec3(transform * glm::vec4(p, 1.0f)));
+  }
+  return result;
+}
+
+/**
+ * @brief how much of `bounds` lies inside the view frustum of `mvp`
+ * @details Conservative like `clip_classify`: a box outside no single plane but outside the frustum
+ * near one of its edges is rated `Coverage::Partial`.
+ */
+static Coverage frustum_classify(const glm::mat4& mvp, const Bounds& bounds) {
+  glm::vec4 corners[8];
+  for (int corner = 0; corner < 8; corner++) {
+    const glm::vec3 p(corner & 1 ? bounds.max.x : bounds.min.x, corner & 2 ? bounds.max.y : bounds.min.y, corner & 4 ? bounds.max.z : bounds.min.z);
+    corners[corner] = mvp * glm::vec4(p, 1.0f);
+  }
+  // planes -w <= x, y, z <= w in clip space
+  bool inside = true;
+  for (int plane = 0; plane < 6; plane++) {
+    const int   axis    = plane / 2;
+    const float sign    = plane % 2 ? -1.0f : 1.0f;
+    int         outside = 0;
+    for (const auto& c : corners)
+      outside += sign * c[axis] > c.w;
+    if (outside == 8)
+      return Coverage::None;
+    inside &= outside == 0;
+  }
+  return inside ? Coverage::All : Coverage::Partial;
+}
 
+// compiled after `clip_volume_glsl`; `SurfelRenderer` compiles it again with `SURFEL_PASS` defined
+static const char* vertexShader = R"(
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in float scalar;
+layout(location = 4) in float spacing; // mean distance to the nearest neighbours, 0 until computed
+
+// one entry per cloud, `CloudUniforms` on the CPU
+layout(std140, binding = 0) uniform Cloud {
+    mat4 model;
+    mat4 mvp;
+    int  shading;      // `Shading`: rgb, normal, height, scalar
+    int  height_axis;
+    int  colormap;
+    vec2 scalar_range; // values mapped to the ends of the colormap
+};
+
+uniform sampler2D colormaps; // one row per colormap
 
-uniform mat4 model;
+// splat size, shared by every cloud
+uniform mat4  projection;
+uniform float viewport_height;
+uniform float point_size;     // pixels, unless adaptive and the spacing is known
+uniform bool  adaptive;       // size from `spacing`, in world units
+uniform float spacing_scale;  // splat diameter over the spacing
+uniform float max_point_size; // pixels
+uniform float splat_scale;    // grows the splats, e.g. when only a subsample of the points is drawn
+
+out vec3  fColor;
+out float fDepthRange; // window depth between the center of the splat and its point nearest to the camera
+#ifdef SURFEL_PASS
 uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 mvp;
+out vec3  fCenter; // view space
+out vec3  fNormal; // view space, zero when the point has none
+out float fRadius; // world units
+#endif
 
-out vec3 fColor;
+vec3 apply_colormap(float value)
+{
+    ivec2 size = textureSize(colormaps, 0);
+    float t    = clamp((value - scalar_range.x) / max(scalar_range.y - scalar_range.x, 1e-30), 0.0, 1.0);
+    return texture(colormaps, vec2((t * float(size.x - 1) + 0.5) / float(size.x), (float(colormap) + 0.5) / float(size.y))).rgb;
+}
 
 void main()
 {
+    vec4 world = model * vec4(position, 1.0);
+    if (!clip_keeps(world.xyz)) {
+        gl_Position  = vec4(0.0, 0.0, 2.0, 1.0); // beyond the far plane, the point is dropped
+        gl_PointSize = 1.0;
+        fDepthRange  = 0.0;
+        return;
+    }
     gl_Position = mvp * vec4(position, 1.0);
-    if(model[2][2] > 0.5)
+
+    // a world length of 1 at this depth covers this many pixels
+    float pixels_per_unit = projection[1][1] * viewport_height * 0.5 / max(gl_Position.w, 1e-6);
+    float diameter        = adaptive && spacing > 0.0 ? spacing * spacing_scale * pixels_per_unit : point_size;
+    gl_PointSize          = clamp(diameter * splat_scale, 1.0, max_point_size * splat_scale);
+    float radius          = 0.5 * gl_PointSize / pixels_per_unit;
+    // the front of a sphere of the splat's radius, moved towards the camera in view space
+    vec4 front  = gl_Position + projection[2] * radius;
+    fDepthRange = front.w > 0.0 ? 0.5 * (gl_Position.z / gl_Position.w - front.z / front.w) : 0.0;
+#ifdef SURFEL_PASS
+    fCenter = (view * world).xyz;
+    fNormal = mat3(view) * mat3(model) * normal;
+    fRadius = radius;
+#endif
+    if (shading == 0) {
         fColor = color;
-    else 
-        fColor = color.xzy;
+    } else if (shading == 1) {
+        vec3 n = mat3(model) * normal;
+        fColor = length(n) > 0.0 ? normalize(n) * 0.5 + 0.5 : vec3(0.5);
+    } else if (shading == 2) {
+        fColor = apply_colormap(world[height_axis]);
+    } else {
+        fColor = apply_colormap(scalar);
+    }
 }
     )";
 
-static const char* fragmentShader = R"(#version 460 core
-
+// compiled after `#define SPLAT_SHAPE` and the `SplatShape` value; only the shapes that need it
+// discard fragments or write their depth, the square keeps early depth testing
+static const char* fragmentShader = R"(
 layout(location = 0) out vec4 FragColor;
-in vec3 fColor;
+in vec3  fColor;
+in float fDepthRange;
 
 void main()
 {
+#if SPLAT_SHAPE != 0
+    vec2  p  = gl_PointCoord * 2.0 - 1.0;
+    float r2 = dot(p, p);
+    if (r2 > 1.0)
+        discard;
+#endif
+#if SPLAT_SHAPE == 2
+    gl_FragDepth = gl_FragCoord.z - (1.0 - r2) * fDepthRange;
+#endif
     FragColor = vec4(fColor,1.0);
 }
     )";
@@ -63,7 +181,7 @@ void Window::CreateGLFWWindow() {
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #endif
   glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
-  glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+  glfwWindowHint(GLFW_VISIBLE, visible ? GL_TRUE : GL_FALSE);
   glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, GL_FALSE);
   glfwWindowHint(GLFW_SAMPLES, 4);
 
@@ -74,6 +192,20 @@ void Window::CreateGLFWWindow() {
   }
 }
 
+void Window::InstallInputCallbacks() {
+  glfwSetWindowUserPointer(window, this);
+
+  glfwSetScrollCallback(window, &scroll_callback);
+  glfwSetCursorPosCallback(window, [](GLFWwindow* w, double, double) { request_redraw(w); });
+  glfwSetMouseButtonCallback(window, [](GLFWwindow* w, int, int, int) { request_redraw(w); });
+  glfwSetKeyCallback(window, [](GLFWwindow* w, int, int, int, int) { request_redraw(w); });
+  glfwSetCharCallback(window, [](GLFWwindow* w, unsigned int) { request_redraw(w); });
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow* w, int, int) { request_redraw(w); });
+  glfwSetWindowRefreshCallback(window, [](GLFWwindow* w) { request_redraw(w); });
+  glfwSetWindowFocusCallback(window, [](GLFWwindow* w, int) { request_redraw(w); });
+  glfwSetCursorEnterCallback(window, [](GLFWwindow* w, int) { request_redraw(w); });
+}
+
 void Window::InitGL() {
   glfwMakeContextCurrent(window);
   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -104,7 +236,155 @@ void Window::InitGL() {
 #endif
 }
 
-void Window::Run() {
+void Window::RenderSoftware(const glm::mat4& view_projection) {
+  software_rasterizer.resize(scene_windowSize[0], scene_windowSize[1]);
+  software_rasterizer.clear();
+  for (const auto& cloud : clouds) {
+    if (!cloud->visible)
+      continue;
+    const glm::mat4 cloud_model = CloudModel(*cloud);
+    software_rasterizer.render(cloud->cloud.get_points(), cloud->get_packed_colors(cloud_model), view_projection * cloud_model, point_size);
+  }
+  const std::vector<uint32_t>& image = software_rasterizer.resolve(clearColor);
+
+  if (!software_texture) {
+    glGenTextures(1, &software_texture);
+    glBindTexture(GL_TEXTURE_2D, software_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  glBindTexture(GL_TEXTURE_2D, software_texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  int w = software_rasterizer.get_width(), h = software_rasterizer.get_height();
+  if (software_texture_size[0] != w || software_texture_size[1] != h) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+    software_texture_size[0] = w;
+    software_texture_size[1] = h;
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  scene_image           = software_texture;
+  scene_image_bottom_up = false;
+}
+
+void Window::RenderProgressive(const glm::mat4& view_projection) {
+  const size_t point_count = VisiblePoints();
+  if (!accumulation)
+    accumulation = std::make_unique<RenderTarget>(GL_RGBA8);
+
+  AccumulationKey key {};
+  key.mvp           = view_projection * model;
+  key.clear_color   = clearColor;
+  key.point_size    = point_size;
+  key.size[0]       = scene_windowSize[0];
+  key.size[1]       = scene_windowSize[1];
+  key.scene_version = scene_version;
+  key.clip_version  = clip_version;
+
+  bool resized = accumulation->resize(scene_windowSize[0], scene_windowSize[1]);
+  accumulation->bind();
+  if (resized || !(key == accumulation_key)) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    accumulation_key   = key;
+    progressive_offset = 0;
+  }
+  if (progressive_offset < point_count) {
+    size_t count = std::min<size_t>(std::max(progressive_budget, 1), point_count - progressive_offset);
+    for (size_t i = 0; i < clouds.size(); i++) {
+      if (!clouds[i]->visible)
+        continue;
+      const size_t size = clouds[i]->size();
+      BindCloud(i);
+      clouds[i]->draw_shuffled(size * progressive_offset / point_count, size * (progressive_offset + count) / point_count);
+    }
+    progressive_offset += count;
+    if (progressive_offset < point_count)
+      RequestRedraw(1);
+  }
+  RenderTarget::unbind();
+  glViewport(scene_windowPos[0], scene_windowPos[1], scene_windowSize[0], scene_windowSize[1]);
+
+  scene_image           = accumulation->get_color_texture();
+  scene_image_bottom_up = true;
+}
+
+void Window::ActivateRenderMode(RenderMode mode) {
+  if (mode == RenderMode::Compute) {
+    if (!compute_rasterizer)
+      compute_rasterizer = std::make_unique<ComputeRasterizer>();
+    if (!compute_rasterizer->init()) {
+      spdlog::warn("Compute rasterizer unavailable, falling back to GL_POINTS");
+      mode = RenderMode::Points;
+    }
+  } else if (mode == RenderMode::Surfels) {
+    if (!surfel_renderer)
+      surfel_renderer = std::make_unique<SurfelRenderer>();
+    if (!surfel_renderer->init(std::string(clip_volume_glsl) + vertexShader)) {
+      spdlog::warn("Surfel renderer unavailable, falling back to GL_POINTS");
+      mode = RenderMode::Points;
+    }
+  }
+  render_mode = mode;
+}
+
+void Window::DrawProfiler() {
+  if (ImGui::BeginTable("zones", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Zone");
+    ImGui::TableSetupColumn("p50 ms");
+    ImGui::TableSetupColumn("p95 ms");
+    ImGui::TableSetupColumn("p99 ms");
+    ImGui::TableHeadersRow();
+    for (const auto& [name, gpu] : Profiler::global().get_zones()) {
+      auto stats = Profiler::global().get_stats(name);
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", stats.p50);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", stats.p95);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", stats.p99);
+    }
+    ImGui::EndTable();
+  }
+  if (ImGui::Button("Export Chrome Trace"))
+    Profiler::global().export_chrome_trace("point_cloud_viewer_trace.json");
+}
+
+void Window::DrawPickedPoint() {
+  if (!picked_point || active_cloud >= clouds.size() || *picked_point >= clouds[active_cloud]->size()) {
+    ImGui::TextUnformatted(point_picker && point_picker->is_pending() ? "picking..." : "right-click a point in the scene");
+    return;
+  }
+  const SceneCloud& scene_cloud = *clouds[active_cloud];
+  const PointCloud& point_cloud = scene_cloud.cloud;
+  const size_t      i           = *picked_point;
+  const glm::dvec3  p           = point_cloud.origin + glm::dvec3(point_cloud.points[i]);
+  const glm::vec4   world       = CloudModel(scene_cloud) * glm::vec4(point_cloud.points[i], 1.0f);
+  ImGui::Text("Cloud: %s", scene_cloud.name.c_str());
+  ImGui::Text("Index: %zu", i);
+  ImGui::Text("Position: %.10g, %.10g, %.10g", p.x, p.y, p.z);
+  ImGui::Text("Displayed: %g, %g, %g", world.x, world.y, world.z);
+  if (i < point_cloud.colors.size())
+    ImGui::Text("Color: %.3f, %.3f, %.3f", point_cloud.colors[i].x, point_cloud.colors[i].y, point_cloud.colors[i].z);
+  if (i < point_cloud.normals.size())
+    ImGui::Text("Normal: %.3f, %.3f, %.3f", point_cloud.normals[i].x, point_cloud.normals[i].y, point_cloud.normals[i].z);
+  for (const auto& attribute : point_cloud.attributes) {
+    if (i >= attribute.size())
+      continue;
+    std::string values;
+    for (int c = 0; c < attribute.get_components(); c++)
+      values += fmt::format("{}{}", c > 0 ? ", " : "", attribute.get(i, c));
+    ImGui::Text("%s: %s", attribute.get_name().c_str(), values.c_str());
+  }
+}
+
+void Window::InitScene() {
   glEnable(GL_DEPTH_TEST);
   glDepthFunc(GL_LESS);
   glEnable(GL_CULL_FACE);
@@ -113,108 +393,857 @@ void Window::Run() {
   glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.w);
   glPointSize(point_size);
 
-  glfwSetScrollCallback(window, &scroll_callback);
+  ActivateRenderMode(render_mode);
+  if (!gpu_timer)
+    gpu_timer = std::make_unique<GpuTimer>();
 
-  if (camera_distance < 0) {
-    auto bbox       = point_cloud.get_AABB();
-    camera_distance = glm::l2Norm(std::get<0>(bbox) - std::get<1>(bbox));
-    spdlog::debug("Camera distance: {}", camera_distance);
+  UpdateSceneBounds();
+  if (camera.distance < 0) {
+    camera.distance = glm::l2Norm(scene_bounds.max - scene_bounds.min);
+    spdlog::debug("Camera distance: {}", camera.distance);
   }
+  for (auto& cloud : clouds)
+    cloud->upload();
+  if (point_cloud_shaders[0])
+    return;
 
   // ----------------------------- compile shaders -----------------------------
-  GLuint pointCloudShader = create_shader_program(vertexShader, fragmentShader);
+  const std::string vertex_source = std::string("#version 450 core\n") + clip_volume_glsl + vertexShader;
+  for (int shape = 0; shape < static_cast<int>(SplatShape::Count); shape++) {
+    const std::string fragment_source = fmt::format("#version 450 core\n#define SPLAT_SHAPE {}\n", shape) + fragmentShader;
+    point_cloud_shaders[shape]        = create_shader_program(vertex_source.c_str(), fragment_source.c_str());
+    if (!point_cloud_shaders[shape]) {
+      for (GLuint& shader : point_cloud_shaders) {
+        glDeleteProgram(shader);
+        shader = 0;
+      }
+      throw std::runtime_error("point shaders failed to compile");
+    }
+  }
+
+  // ----------------------------- uniform buffer -----------------------------
+  // at least 16 bytes, std140 rounds the size of the block up to its `vec4` alignment
+  GLint alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  const size_t align   = static_cast<size_t>(std::max(alignment, 16));
+  cloud_uniform_stride = (sizeof(CloudUniforms) + align - 1) / align * align;
+  glGenBuffers(1, &cloud_uniform_buffer);
 
-  // ----------------------------- buufer data -----------------------------
+  // ----------------------------- colormaps -----------------------------
+  const int              colormap_width = 256;
+  std::vector<glm::vec3> table          = colormap_table(colormap_width);
+  glGenTextures(1, &colormap_texture);
+  glBindTexture(GL_TEXTURE_2D, colormap_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, colormap_width, static_cast<GLsizei>(ColorMap::Count), 0, GL_RGB, GL_FLOAT, table.data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-  GLuint pointCloudVAO;
-  GLuint pointCloudVBO[2]; // position, color
+glm::mat4 Window::CloudModel(const SceneCloud& cloud) const {
+  const glm::dvec3 offset = cloud.cloud.origin - scene_origin.value_or(glm::dvec3(0.0));
+  return glm::mat4(glm::dmat4(model) * glm::dmat4(cloud.transform) * glm::translate(glm::dmat4(1.0), offset));
+}
 
-  glGenVertexArrays(1, &pointCloudVAO);
-  glGenBuffers(2, pointCloudVBO);
+glm::mat4 Window::TileSetModel() const {
+  const glm::dvec3 offset = tile_set->get_origin() - scene_origin.value_or(glm::dvec3(0.0));
+  return glm::mat4(glm::dmat4(model) * glm::translate(glm::dmat4(1.0), offset));
+}
 
-  glBindVertexArray(pointCloudVAO);
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
+void Window::AddPointCloud(std::string name, PointCloud cloud, const glm::mat4& transform, const std::string& source) {
+  if (!scene_origin)
+    scene_origin = cloud.origin;
+  clouds.push_back(std::make_unique<SceneCloud>(std::move(name), std::move(cloud)));
+  clouds.back()->transform = transform;
+  clouds.back()->source    = source;
+  if (file_watcher && !source.empty()) {
+    clouds.back()->source_snapshot = FileSnapshot::take(source);
+    file_watcher->watch(source);
+  }
+  const Bounds before = scene_bounds;
+  UpdateSceneBounds();
+  // height ranges follow the scene bounds, which the new cloud may have grown
+  const bool grown = std::memcmp(&before, &scene_bounds, sizeof(Bounds)) != 0;
+  for (auto& scene_cloud : clouds)
+    if (scene_cloud == clouds.back() || (grown && scene_cloud->shading.mode == Shading::Height))
+      ResetShadingRange(*scene_cloud);
+  scene_version++;
+}
 
-  glBindBuffer(GL_ARRAY_BUFFER, pointCloudVBO[0]);
-  glBufferData(GL_ARRAY_BUFFER, point_cloud.get_points().size() * sizeof(glm::vec3), &point_cloud.get_points()[0], GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+void Window::SetTileSet(std::unique_ptr<TileSet> tiles) {
+  tile_set = std::move(tiles);
+  if (!scene_origin)
+    scene_origin = tile_set->get_origin();
+  UpdateSceneBounds();
+  for (auto& cloud : clouds)
+    if (cloud->shading.mode == Shading::Height)
+      ResetShadingRange(*cloud);
+  scene_version++;
+}
 
-  glBindBuffer(GL_ARRAY_BUFFER, pointCloudVBO[1]);
-  glBufferData(GL_ARRAY_BUFFER, point_cloud.get_colors().size() * sizeof(glm::vec3), &point_cloud.get_colors()[0], GL_STATIC_DRAW);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+void Window::WatchFiles(std::function<PointCloud(const std::string&)> reload, std::function<void(PointCloud&)> prepare,
+                        std::function<bool(const std::string&)> appendable) {
+  reload_file      = std::move(reload);
+  prepare_appended = std::move(prepare);
+  appendable_file  = std::move(appendable);
+  file_watcher     = std::make_unique<FileWatcher>([this] {
+    RequestRedraw();
+    glfwPostEmptyEvent();
+  });
+  for (auto& cloud : clouds) {
+    if (cloud->source.empty())
+      continue;
+    cloud->source_snapshot = FileSnapshot::take(cloud->source);
+    file_watcher->watch(cloud->source);
+  }
+}
+
+void Window::UpdateReloads() {
+  if (!file_watcher)
+    return;
+  for (auto& path : file_watcher->take_changed())
+    if (std::find(reload_queue.begin(), reload_queue.end(), path) == reload_queue.end())
+      reload_queue.push_back(std::move(path));
+
+  // one reload per file at a time, each one starts from the snapshot the previous one left
+  for (auto path = reload_queue.begin(); path != reload_queue.end();) {
+    if (std::any_of(reloads.begin(), reloads.end(), [&](const auto& reload) { return reload.first == *path; })) {
+      ++path;
+      continue;
+    }
+    auto cloud = std::find_if(clouds.begin(), clouds.end(), [&](const auto& c) { return c->source == *path; });
+    if (cloud != clouds.end()) {
+      // a copy of what the worker needs, the cloud itself may change or go before it finishes
+      const bool         appendable = std::filesystem::path(*path).extension() != ".ply" && (!appendable_file || appendable_file(*path));
+      const bool         has_data   = (*cloud)->size() > 0;
+      const FileSnapshot previous   = (*cloud)->source_snapshot;
+      const glm::dvec3   origin     = (*cloud)->cloud.origin;
+      auto task = [path = *path, appendable, has_data, previous, origin, load = reload_file, prepare = prepare_appended] {
+        Reload reload;
+        reload.appended = appendable && has_data && previous.is_prefix_of(path);
+        if (reload.appended) {
+          reload.cloud.origin = origin;
+          reload.snapshot     = FileSnapshot::take(path, reload.cloud.append_points_from(path, previous.size));
+          prepare(reload.cloud);
+        } else {
+          // taken first: lines appended while loading are read again by the next reload rather than lost
+          reload.snapshot = FileSnapshot::take(path);
+          reload.cloud    = load(path);
+        }
+        return reload;
+      };
+      reloads.emplace_back(*path, ThreadPool::global().submit(std::move(task)));
+    }
+    path = reload_queue.erase(path);
+  }
+
+  for (auto reload = reloads.begin(); reload != reloads.end();) {
+    if (reload->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++reload;
+      continue;
+    }
+    const std::string path = reload->first;
+    Reload            result;
+    bool              loaded = true;
+    try {
+      result = reload->second.get();
+    } catch (const std::exception& e) {
+      spdlog::error("Could not reload {}, keeping the points loaded before: {}", path, e.what());
+      loaded = false;
+    }
+    reload     = reloads.erase(reload);
+    auto found = std::find_if(clouds.begin(), clouds.end(), [&](const auto& c) { return c->source == path; });
+    if (!loaded || found == clouds.end())
+      continue;
+
+    // the table may still be sorting the points, and a pick may still name them
+    SceneCloud& cloud = **found;
+    point_table.invalidate();
+    pick_draws.clear();
+    const size_t before = cloud.size();
+    if (result.appended) {
+      cloud.append(std::move(result.cloud));
+      spdlog::info("{}: appended {} points", cloud.name, cloud.size() - before);
+    } else {
+      if (static_cast<size_t>(found - clouds.begin()) == active_cloud)
+        picked_point.reset();
+      cloud.replace(std::move(result.cloud));
+      spdlog::info("{}: reloaded {} points", cloud.name, cloud.size());
+    }
+    cloud.source_snapshot = result.snapshot;
+
+    const Bounds bounds_before = scene_bounds;
+    UpdateSceneBounds(false);
+    const bool grown = std::memcmp(&bounds_before, &scene_bounds, sizeof(Bounds)) != 0;
+    for (auto& scene_cloud : clouds)
+      if ((scene_cloud.get() == &cloud && !result.appended) || (grown && scene_cloud->shading.mode == Shading::Height))
+        ResetShadingRange(*scene_cloud);
+    scene_version++;
+  }
+  if (!reloads.empty())
+    RequestRedraw(1);
+}
+
+void Window::UpdateTiles(const glm::mat4& view_projection) {
+  if (!tile_set)
+    return;
+  PROFILE_SCOPE("tiles");
+  const glm::mat4 tiles_model = TileSetModel();
+  const glm::mat4 mvp         = view_projection * tiles_model;
+  const glm::vec3 eye         = camera.get_position();
+
+  // nearest first, they cover the most pixels
+  std::vector<std::pair<float, size_t>> in_view;
+  for (size_t tile : tile_set->select([&](const Bounds& bounds) { return frustum_classify(mvp, bounds); })) {
+    const Bounds&   bounds = tile_set->get_tile(tile).bounds;
+    const glm::vec3 center = glm::vec3(tiles_model * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+    in_view.emplace_back(glm::distance2(eye, center), tile);
+  }
+  std::sort(in_view.begin(), in_view.end());
+  std::vector<size_t> wanted;
+  wanted.reserve(in_view.size());
+  for (const auto& [distance, tile] : in_view)
+    wanted.push_back(tile);
+
+  for (size_t tile : tile_set->update(wanted)) {
+    auto cloud = std::find_if(clouds.begin(), clouds.end(), [&](const auto& c) { return c->tile == static_cast<int64_t>(tile); });
+    if (cloud != clouds.end())
+      RemoveCloud(static_cast<size_t>(cloud - clouds.begin()));
+  }
+  for (auto& [tile, point_cloud] : tile_set->take_loaded()) {
+    const std::string name = std::filesystem::path(tile_set->get_tile(tile).path).filename().string();
+    clouds.push_back(std::make_unique<SceneCloud>(name, std::move(point_cloud)));
+    clouds.back()->tile = static_cast<int64_t>(tile);
+    // the scene bounds already hold every tile, the other clouds keep their ranges
+    ResetShadingRange(*clouds.back());
+    scene_version++;
+  }
+  if (tile_set->is_loading())
+    RequestRedraw(1);
+}
+
+void Window::RemoveCloud(size_t i) {
+  // the table may still be sorting the points of the cloud, and a pick may still name it
+  point_table.invalidate();
+  pick_draws.clear();
+  if (i == active_cloud)
+    picked_point.reset();
+  clouds.erase(clouds.begin() + static_cast<std::ptrdiff_t>(i));
+  if (i < active_cloud)
+    active_cloud--;
+  active_cloud = std::min(active_cloud, clouds.size() > 0 ? clouds.size() - 1 : 0);
+  UpdateSceneBounds();
+  scene_version++;
+}
+
+size_t Window::VisiblePoints() const {
+  size_t count = 0;
+  for (const auto& cloud : clouds)
+    if (cloud->visible)
+      count += cloud->size();
+  return count;
+}
+
+void Window::UpdateSceneBounds(bool recenter_camera) {
+  scene_bounds = Bounds();
+  for (const auto& cloud : clouds)
+    if (cloud->tile < 0)
+      scene_bounds.extend(cloud->cloud.get_transformed_bounds(CloudModel(*cloud)));
+  // the tiles count whether loaded or not, so the camera does not move as they stream in
+  if (tile_set)
+    scene_bounds.extend(transform_bounds(TileSetModel(), tile_set->get_bounds()));
+  if (scene_bounds.empty())
+    scene_bounds = Bounds { glm::vec3(-1.0f), glm::vec3(1.0f) };
+  if (recenter_camera)
+    camera.center = (scene_bounds.min + scene_bounds.max) / 2.0f;
+}
+
+void Window::ResetShadingRange(SceneCloud& cloud) {
+  ShadingSettings& shading = cloud.shading;
+  if (shading.mode == Shading::Height) {
+    // the scene bounds rather than the cloud's, so overlapping clouds agree on the colors
+    const int axis   = std::clamp(shading.height_axis, 0, 2);
+    shading.range[0] = scene_bounds.min[axis];
+    shading.range[1] = scene_bounds.max[axis];
+  } else if (shading.mode == Shading::Scalar && static_cast<size_t>(shading.attribute) < cloud.cloud.attributes.size()) {
+    const PointAttribute& attribute  = cloud.cloud.attributes[static_cast<size_t>(shading.attribute)];
+    const size_t          components = static_cast<size_t>(attribute.get_components());
+    double                lo = std::numeric_limits<double>::max(), hi = std::numeric_limits<double>::lowest();
+    attribute.visit([&](const auto* values) {
+      for (size_t i = 0; i < attribute.size(); i++) {
+        lo = std::min(lo, static_cast<double>(values[i * components]));
+        hi = std::max(hi, static_cast<double>(values[i * components]));
+      }
+    });
+    if (lo <= hi) {
+      shading.range[0] = static_cast<float>(lo);
+      shading.range[1] = static_cast<float>(hi);
+    }
+  }
+}
+
+void Window::UploadCloudUniforms(const glm::mat4& view_projection) {
+  cloud_uniform_data.assign(std::max<size_t>(clouds.size(), 1) * cloud_uniform_stride, 0);
+  for (size_t i = 0; i < clouds.size(); i++) {
+    const CloudUniforms uniforms = clouds[i]->uniforms(CloudModel(*clouds[i]), view_projection);
+    std::memcpy(cloud_uniform_data.data() + i * cloud_uniform_stride, &uniforms, sizeof(uniforms));
+  }
+  // orphaned every frame, the driver hands out fresh storage instead of waiting on the last draws
+  glBindBuffer(GL_UNIFORM_BUFFER, cloud_uniform_buffer);
+  glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(cloud_uniform_data.size()), cloud_uniform_data.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void Window::BindCloud(size_t i) {
+  glBindBufferRange(GL_UNIFORM_BUFFER, 0, cloud_uniform_buffer, static_cast<GLintptr>(i * cloud_uniform_stride), static_cast<GLsizeiptr>(cloud_uniform_stride));
+  glBindVertexArray(clouds[i]->get_vao());
+}
 
+static const char* splat_shape_names[] = { "Square", "Circle", "Paraboloid" };
+static const char* splat_zone_names[]  = { "points", "points_circle", "points_paraboloid" }; // GPU zones of the GL_POINTS renderer
+
+bool Window::DrawSplatSize() {
+  bool changed = ImGui::Checkbox("Adaptive Size", &adaptive_point_size);
+  if (adaptive_point_size) {
+    changed |= ImGui::DragFloat("Spacing Scale", &spacing_scale, 0.01f, 0.1f, 10.0f);
+    changed |= ImGui::SliderFloat("Max Point Size", &max_point_size, 1.0f, 64.0f);
+  }
+  return changed;
+}
+
+void Window::DrawSurfels() {
+  ImGui::DragInt("Points per Frame", &progressive_budget, 10000.0f, 10000, 100000000);
+  ImGui::Text("\tdrawing %zu of %zu points", surfel_drawn_points, VisiblePoints());
+  DrawSplatSize();
+  ImGui::SliderFloat("Blend Depth", &surfel_depth_offset, 0.0f, 4.0f);
+  const auto stats = Profiler::global().get_stats("gpu/surfels");
+  if (stats.count > 0)
+    ImGui::Text("\tGPU: %.2f ms", stats.p50);
+  else
+    ImGui::Text("\tGPU: -");
+}
+
+void Window::DrawSplats() {
+  bool changed     = false;
+  int  shape_index = static_cast<int>(splat_shape);
+  if (ImGui::Combo("Splats", &shape_index, splat_shape_names, IM_ARRAYSIZE(splat_shape_names))) {
+    splat_shape = static_cast<SplatShape>(shape_index);
+    changed     = true;
+  }
+  changed |= DrawSplatSize();
+  // GPU time of the points pass for every shape tried so far
+  for (int i = 0; i < IM_ARRAYSIZE(splat_shape_names); i++) {
+    const auto stats = Profiler::global().get_stats(std::string("gpu/") + splat_zone_names[i]);
+    if (stats.count > 0)
+      ImGui::Text("\t%s: %.2f ms", splat_shape_names[i], stats.p50);
+    else
+      ImGui::Text("\t%s: -", splat_shape_names[i]);
+  }
+  if (changed)
+    scene_version++; // restarts progressive accumulation
+}
+
+void Window::DrawClouds() {
+  bool changed = false;
+  for (size_t i = 0; i < clouds.size(); i++) {
+    SceneCloud& cloud = *clouds[i];
+    ImGui::PushID(static_cast<int>(i));
+    changed |= ImGui::Checkbox("##visible", &cloud.visible);
+    ImGui::SameLine();
+    const std::string label = fmt::format("{} ({} points)", cloud.name, cloud.size());
+    if (ImGui::Selectable(label.c_str(), i == active_cloud) && i != active_cloud) {
+      active_cloud = i;
+      picked_point.reset();
+    }
+    ImGui::PopID();
+  }
+  if (active_cloud >= clouds.size())
+    return;
+
+  // tiles are placed by the tile set and come and go with the view
+  SceneCloud& cloud = *clouds[active_cloud];
+  const float speed = std::max(glm::length(scene_bounds.max - scene_bounds.min), 1e-6f) * 0.002f;
+  if (cloud.tile < 0 && ImGui::DragFloat3("Offset", &cloud.transform[3].x, speed)) {
+    UpdateSceneBounds();
+    changed = true;
+  }
+  if (cloud.tile < 0 && ImGui::Button("Remove Cloud"))
+    RemoveCloud(active_cloud);
+  if (changed)
+    scene_version++;
+}
+
+void Window::DrawTiles() {
+  const size_t loaded  = tile_set->count(TileSet::State::Loaded);
+  const size_t loading = tile_set->count(TileSet::State::Loading);
+  const size_t failed  = tile_set->count(TileSet::State::Failed);
+  ImGui::Text("Tiles: %zu loaded, %zu loading of %zu", loaded, loading, tile_set->size());
+  if (failed > 0)
+    ImGui::Text("\t%zu failed, see the log", failed);
+  int budget_mb = static_cast<int>(tile_set->get_budget() >> 20);
+  ImGui::Text("Memory: %zu MB", tile_set->get_resident_bytes() >> 20);
+  if (ImGui::DragInt("Memory Budget (MB)", &budget_mb, 16.0f, 16, 1 << 20))
+    tile_set->set_budget(static_cast<size_t>(budget_mb) << 20);
+}
+
+bool Window::DrawShading(SceneCloud& cloud) {
+  ShadingSettings& shading       = cloud.shading;
+  const auto&      attributes    = cloud.cloud.attributes;
+  bool             changed       = false;
+  int              shading_index = static_cast<int>(shading.mode);
+  if (ImGui::Combo("Shading", &shading_index, shading_names, IM_ARRAYSIZE(shading_names))) {
+    shading.mode = static_cast<Shading>(shading_index);
+    ResetShadingRange(cloud);
+    changed = true;
+  }
+  if (shading.mode == Shading::Height || shading.mode == Shading::Scalar) {
+    int colormap_index = static_cast<int>(shading.colormap);
+    if (ImGui::Combo("Colormap", &colormap_index, colormap_names, IM_ARRAYSIZE(colormap_names))) {
+      shading.colormap = static_cast<ColorMap>(colormap_index);
+      changed          = true;
+    }
+    if (shading.mode == Shading::Scalar) {
+      const char* preview = static_cast<size_t>(shading.attribute) < attributes.size() ? attributes[static_cast<size_t>(shading.attribute)].get_name().c_str() : "none";
+      if (ImGui::BeginCombo("Attribute", preview)) {
+        for (size_t i = 0; i < attributes.size(); i++) {
+          const PointAttribute& attribute = attributes[i];
+          std::string           label     = fmt::format("{} ({})", attribute.get_name(), attribute_type_name(attribute.get_type()));
+          if (ImGui::Selectable(label.c_str(), static_cast<int>(i) == shading.attribute)) {
+            shading.attribute = static_cast<int>(i);
+            ResetShadingRange(cloud);
+            changed = true;
+          }
+        }
+        ImGui::EndCombo();
+      }
+    }
+    static const char* axis_names[] = { "X", "Y", "Z" };
+    if (shading.mode == Shading::Height && ImGui::Combo("Axis", &shading.height_axis, axis_names, IM_ARRAYSIZE(axis_names))) {
+      ResetShadingRange(cloud);
+      changed = true;
+    }
+    const float speed = std::max(shading.range[1] - shading.range[0], 1e-6f) * 0.005f;
+    changed |= ImGui::DragFloatRange2("Range", &shading.range[0], &shading.range[1], speed);
+    ImGui::SameLine();
+    if (ImGui::Button("Fit")) {
+      ResetShadingRange(cloud);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void Window::DrawClipVolumes() {
+  const glm::vec3 extent  = scene_bounds.max - scene_bounds.min;
+  const glm::vec3 middle  = (scene_bounds.min + scene_bounds.max) / 2.0f;
+  const float     speed   = std::max(glm::length(extent), 1e-6f) * 0.002f;
+  bool            changed = false;
+
+  for (int shape = 0; shape < static_cast<int>(ClipShape::Count); shape++) {
+    if (shape > 0)
+      ImGui::SameLine();
+    if (ImGui::Button(fmt::format("Add {}", clip_shape_names[shape]).c_str())) {
+      ClipVolume volume;
+      volume.shape  = static_cast<ClipShape>(shape);
+      volume.center = middle;
+      volume.size   = volume.shape == ClipShape::Cylinder ? glm::vec3(std::max(extent.x, extent.y) * 0.25f, extent.z * 0.5f, 0.0f) : extent * 0.25f;
+      clip_volumes.push_back(volume);
+      changed = true;
+    }
+  }
+
+  for (size_t i = 0; i < clip_volumes.size(); i++) {
+    ClipVolume& volume = clip_volumes[i];
+    ImGui::PushID(static_cast<int>(i));
+    ImGui::Separator();
+    changed |= ImGui::Checkbox(clip_shape_names[static_cast<int>(volume.shape)], &volume.enabled);
+    ImGui::SameLine();
+    changed |= ImGui::Checkbox("Invert", &volume.invert);
+    ImGui::SameLine();
+    const bool remove = ImGui::Button("Remove");
+    changed |= ImGui::DragFloat3("Center", &volume.center.x, speed);
+    if (volume.shape == ClipShape::Box) {
+      changed |= ImGui::DragFloat3("Half Size", &volume.size.x, speed, 0.0f, std::numeric_limits<float>::max());
+    } else {
+      changed |= ImGui::DragFloat3(volume.shape == ClipShape::Plane ? "Normal" : "Axis", &volume.normal.x, 0.01f, -1.0f, 1.0f);
+      if (volume.shape == ClipShape::Cylinder) {
+        changed |= ImGui::DragFloat("Radius", &volume.size.x, speed, 0.0f, std::numeric_limits<float>::max());
+        changed |= ImGui::DragFloat("Half Height", &volume.size.y, speed, 0.0f, std::numeric_limits<float>::max());
+      }
+    }
+    ImGui::PopID();
+    if (remove) {
+      clip_volumes.erase(clip_volumes.begin() + static_cast<std::ptrdiff_t>(i--));
+      changed = true;
+    }
+  }
+  if (changed)
+    clip_version++;
+
+  if (!IsClipping())
+    return;
+  size_t clip_drawn_points = 0;
+  for (const auto& cloud : clouds)
+    if (cloud->visible)
+      clip_drawn_points += cloud->get_clip_drawn_points();
+  ImGui::Separator();
+  if (render_mode != RenderMode::Points && render_mode != RenderMode::Surfels)
+    ImGui::TextDisabled("clip volumes apply to the GL_POINTS and Surfels renderers");
+  else if (!progressive)
+    ImGui::Text("drawing %zu of %zu points", clip_drawn_points, VisiblePoints());
+  ImGui::InputText("##export", clip_export_path, sizeof(clip_export_path));
+  ImGui::SameLine();
+  if (ImGui::Button("Export"))
+    ExportClipped();
+  if (!clip_export_status.empty())
+    ImGui::TextUnformatted(clip_export_status.c_str());
+}
+
+void Window::ExportClipped() {
+  PROFILE_SCOPE("clip_export");
+  if (active_cloud >= clouds.size())
+    return;
+  const SceneCloud&           cloud   = *clouds[active_cloud];
+  const std::vector<uint32_t> indices = clip_select(*cloud.cloud.get_index(), clip_volumes, CloudModel(cloud));
+  try {
+    cloud.cloud.save_points(clip_export_path, indices);
+    clip_export_status = fmt::format("wrote {} points of {} to {}", indices.size(), cloud.name, clip_export_path);
+  } catch (const std::exception& e) {
+    clip_export_status = e.what();
+  }
+  spdlog::info("Clip export: {}", clip_export_status);
+}
+
+void Window::SetSplatUniforms(GLuint shader, const glm::mat4& projection, float splat_scale) {
+  shader_set_uniform(shader, "colormaps", 0);
+  shader_set_uniform(shader, "projection", projection);
+  shader_set_uniform(shader, "viewport_height", static_cast<float>(scene_windowSize[1]));
+  shader_set_uniform(shader, "point_size", point_size);
+  shader_set_uniform(shader, "adaptive", adaptive_point_size);
+  shader_set_uniform(shader, "spacing_scale", spacing_scale);
+  shader_set_uniform(shader, "max_point_size", max_point_size);
+  shader_set_uniform(shader, "splat_scale", splat_scale);
+  glEnable(GL_PROGRAM_POINT_SIZE);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, colormap_texture);
+  clip_set_uniforms(shader, clip_volumes);
+}
+
+void Window::PrepareSplats(const glm::mat4& view_projection) {
+  for (auto& cloud : clouds) {
+    if (!cloud->visible)
+      continue;
+    cloud->bind_scalar_attribute();
+    if (adaptive_point_size && !cloud->request_spacing())
+      RequestRedraw(1); // keep polling until the spacing is computed
+  }
+  UploadCloudUniforms(view_projection);
+}
+
+void Window::RenderSurfels(const glm::mat4& view, const glm::mat4& projection) {
+  // every visible cloud draws the same prefix of its shuffled points; thinning a surface to a
+  // fraction f of its points spreads them by 1 / sqrt(f), the discs grow as much to keep it closed
+  const size_t point_count = VisiblePoints();
+  const size_t budget      = static_cast<size_t>(std::max(progressive_budget, 1));
+  const double fraction    = point_count > budget ? static_cast<double>(budget) / static_cast<double>(point_count) : 1.0;
+  const bool   clipping    = IsClipping();
+  PrepareSplats(projection * view);
+
+  surfel_renderer->resize(scene_windowSize[0], scene_windowSize[1]);
+  for (int pass = 0; pass < 2; pass++) {
+    const GLuint shader = pass == 0 ? surfel_renderer->begin_visibility() : surfel_renderer->begin_accumulation();
+    SetSplatUniforms(shader, projection, static_cast<float>(1.0 / std::sqrt(fraction)));
+    shader_set_uniform(shader, "view", view);
+    shader_set_uniform(shader, "inverse_projection", glm::inverse(projection));
+    shader_set_uniform(shader, "depth_offset", surfel_depth_offset);
+    for (size_t i = 0; i < clouds.size(); i++) {
+      if (!clouds[i]->visible)
+        continue;
+      BindCloud(i);
+      if (fraction < 1.0)
+        clouds[i]->draw_shuffled(0, static_cast<size_t>(static_cast<double>(clouds[i]->size()) * fraction));
+      else if (clipping)
+        clouds[i]->draw_clipped(clip_volumes, clip_version, CloudModel(*clouds[i]));
+      else
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(clouds[i]->size()));
+    }
+  }
   glBindVertexArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glDisable(GL_PROGRAM_POINT_SIZE);
+  surfel_renderer->resolve(scene_windowPos[0], scene_windowPos[1]);
+  surfel_drawn_points = static_cast<size_t>(static_cast<double>(point_count) * fraction);
+}
+
+void Window::RenderScene(const glm::mat4& view, const glm::mat4& projection) {
+  const glm::mat4 view_projection = projection * view;
+  for (auto& cloud : clouds)
+    cloud->upload();
+
+  scene_image = 0;
+  if (render_mode == RenderMode::Points) {
+    // state shared by every cloud is set once, each cloud then costs a buffer range, a VAO and a draw
+    const GLuint shader = point_cloud_shaders[static_cast<int>(splat_shape)];
+    glUseProgram(shader);
+    SetSplatUniforms(shader, projection, 1.0f);
+    PrepareSplats(view_projection);
+
+    if (progressive) {
+      RenderProgressive(view_projection);
+    } else {
+      const bool clipping = IsClipping();
+      for (size_t i = 0; i < clouds.size(); i++) {
+        if (!clouds[i]->visible)
+          continue;
+        BindCloud(i);
+        if (clipping)
+          clouds[i]->draw_clipped(clip_volumes, clip_version, CloudModel(*clouds[i]));
+        else
+          glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(clouds[i]->size()));
+      }
+    }
+    glBindVertexArray(0);
+    glDisable(GL_PROGRAM_POINT_SIZE); // the other programs size points with `glPointSize`
+  } else if (render_mode == RenderMode::Compute) {
+    compute_rasterizer->resize(scene_windowSize[0], scene_windowSize[1]);
+    compute_rasterizer->clear();
+    for (auto& cloud : clouds) {
+      if (!cloud->visible)
+        continue;
+      const glm::mat4 cloud_model = CloudModel(*cloud);
+      compute_rasterizer->render(cloud->get_position_buffer(), cloud->get_baked_color_buffer(cloud_model), static_cast<GLsizei>(cloud->size()),
+                                 view_projection * cloud_model, point_size);
+    }
+    compute_rasterizer->resolve(scene_windowPos[0], scene_windowPos[1]);
+  } else if (render_mode == RenderMode::Surfels) {
+    RenderSurfels(view, projection);
+  } else {
+    RenderSoftware(view_projection);
+  }
+}
+
+static const char* render_mode_names[] = { "GL_POINTS", "Compute", "Software", "Surfels" };
+
+BenchmarkReport Window::RunBenchmark(const CameraPath& path, int frames, int frame_width, int frame_height) {
+  InitScene();
+  const bool progressive_was = progressive;
+  progressive                = false;
+
+  RenderTarget target(GL_RGBA8);
+  target.resize(frame_width, frame_height);
+  scene_windowPos[0]  = 0;
+  scene_windowPos[1]  = 0;
+  scene_windowSize[0] = frame_width;
+  scene_windowSize[1] = frame_height;
+
+  const float default_distance = glm::l2Norm(scene_bounds.max - scene_bounds.min);
+  camera.center                = (scene_bounds.min + scene_bounds.max) / 2.0f;
+
+  BenchmarkReport report;
+  report.renderer    = render_mode_names[static_cast<int>(render_mode)];
+  report.gl_renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  report.width       = frame_width;
+  report.height      = frame_height;
+  report.frame_ms.reserve(static_cast<size_t>(std::max(frames, 0)));
+
+  // the software image is only handed to ImGui when interactive, here it is blitted into the target
+  // inside the timed region, so its frames pay for presentation like those of the GPU modes
+  GLuint software_framebuffer = 0;
+  if (render_mode == RenderMode::Software)
+    glGenFramebuffers(1, &software_framebuffer);
+
+  // warm-up frames absorb shader compilation, buffer uploads and first-touch allocations
+  const int warmup = 5;
+  for (int i = -warmup; i < frames; i++) {
+    const float t = frames > 1 ? static_cast<float>(std::max(i, 0)) / static_cast<float>(frames - 1) : 0.0f;
+    camera        = path.sample(t, camera, default_distance);
+
+    const double    start_us   = Profiler::global().now_us();
+    const glm::mat4 view       = camera.get_view();
+    const glm::mat4 projection = camera.get_projection(static_cast<float>(frame_width) / static_cast<float>(frame_height));
+    UpdateTiles(projection * view);
+    target.bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    RenderScene(view, projection);
+    if (software_framebuffer && scene_image) {
+      // rows of the software image run top-down, the blit flips them
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, software_framebuffer);
+      glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scene_image, 0);
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.get_framebuffer());
+      glBlitFramebuffer(0, 0, frame_width, frame_height, 0, frame_height, frame_width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glFinish();
+    const double duration_us = Profiler::global().now_us() - start_us;
+
+    if (i >= 0) {
+      Profiler::global().record_cpu("benchmark_frame", start_us, duration_us);
+      report.frame_ms.push_back(duration_us / 1000.0);
+    }
+    glfwPollEvents();
+  }
+
+  RenderTarget::unbind();
+  glDeleteFramebuffers(1, &software_framebuffer);
+  progressive   = progressive_was;
+  report.points = VisiblePoints(); // tiles stream in along the path, this is what the last frame drew
+  return report;
+}
+
+void Window::Run() {
+  InitScene();
 
-  double current_frame_time = glfwGetTime();
-  double last_frame_time    = current_frame_time;
-  double FPS                = 0;
-  size_t frame_count        = 0;
   // ----------------------------- main loop -----------------------------
   while (!glfwWindowShouldClose(window)) {
-    last_frame_time    = current_frame_time;
-    current_frame_time = glfwGetTime();
-    frame_count++;
-    if (frame_count % 30 == 0)
-      FPS = 1 / (current_frame_time - last_frame_time);
+    // nothing changed since the last frame: sleep until input arrives instead of redrawing
+    if (redraw_frames > 0) {
+      glfwPollEvents();
+    } else {
+      glfwWaitEventsTimeout(idle_timeout);
+      if (redraw_frames <= 0)
+        continue;
+    }
+    redraw_frames--;
+    PROFILE_SCOPE("frame");
+    double frame_start_time = glfwGetTime();
+    gpu_timer->collect();
+    if (point_picker && point_picker->poll()) {
+      // ids were handed out in draw order, the last draw starting at or before the id holds the point
+      picked_point.reset();
+      if (const auto& id = point_picker->get_result()) {
+        auto draw = std::upper_bound(pick_draws.begin(), pick_draws.end(), *id, [](uint32_t v, const auto& d) { return v < d.first; });
+        if (draw != pick_draws.begin()) {
+          --draw;
+          auto cloud = std::find_if(clouds.begin(), clouds.end(), [&](const auto& c) { return c.get() == draw->second; });
+          if (cloud != clouds.end()) {
+            active_cloud = static_cast<size_t>(cloud - clouds.begin());
+            picked_point = *id - draw->first;
+          }
+        }
+      }
+      RequestRedraw();
+    }
 
     glfwGetWindowSize(window, &width, &height);
     glfwGetFramebufferSize(window, &framebufferSize[0], &framebufferSize[1]);
-    glfwPollEvents();
 
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
       glfwSetWindowShouldClose(window, GLFW_TRUE);
 
     // ------------------------------- window update -------------------------------
     glViewport(0, 0, framebufferSize[0], framebufferSize[1]);
+    gpu_timer->begin("clear");
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gpu_timer->end();
 
     // -------------------------------- scene update --------------------------------
     glViewport(scene_windowPos[0], scene_windowPos[1], scene_windowSize[0], scene_windowSize[1]);
-    glUseProgram(pointCloudShader);
-
-    static auto      bbox       = point_cloud.get_AABB();
-    static auto      center     = glm::vec3(std::get<0>(bbox) + std::get<1>(bbox)) / 2.0f;
-    static glm::mat4 model      = glm::mat4(1.0f);
-    float&&          camera_x   = camera_distance * sin(camera_phi) * cos(camera_theta);
-    float&&          camera_y   = camera_distance * sin(camera_phi) * sin(camera_theta);
-    float&&          camera_z   = camera_distance * cos(camera_phi);
-    glm::vec3        camera_pos = glm::vec3(camera_x, camera_y, camera_z) + center;
-    glm::mat4        view       = glm::lookAt(camera_pos, center, glm::vec3(0.0f, 0.0f, 1.0f));
-    glm::mat4        projection = glm::perspective(glm::radians(camera_fov), static_cast<float>(scene_windowSize[0]) / static_cast<float>(scene_windowSize[1]), 0.1f, camera_distance * 2.0f);
-    glm::mat4        mvp        = projection * view * model;
-    shader_set_uniform(pointCloudShader, "model", model);
-    shader_set_uniform(pointCloudShader, "view", view);
-    shader_set_uniform(pointCloudShader, "projection", projection);
-    shader_set_uniform(pointCloudShader, "mvp", mvp);
-
-    glBindVertexArray(pointCloudVAO);
-    glDrawArrays(GL_POINTS, 0, point_cloud.get_points().size());
+
+    UpdateReloads();
+    glm::mat4       view       = camera.get_view();
+    glm::mat4       projection = camera.get_projection(static_cast<float>(scene_windowSize[0]) / static_cast<float>(scene_windowSize[1]));
+    glm::mat4       mvp        = projection * view * model; // shown in the Scene Matrices panel
+
+    UpdateTiles(projection * view);
+    gpu_timer->begin(render_mode == RenderMode::Points    ? splat_zone_names[static_cast<int>(splat_shape)]
+                     : render_mode == RenderMode::Surfels ? "surfels"
+                                                          : "points");
+    RenderScene(view, projection);
+    gpu_timer->end();
+
+    if (pick_request) {
+      PROFILE_SCOPE("pick");
+      if (!point_picker) {
+        point_picker = std::make_unique<PointPicker>();
+        point_picker->init();
+      }
+      gpu_timer->begin("pick");
+      std::vector<PickDraw> draws;
+      uint32_t              first_id = 0;
+      pick_draws.clear();
+      for (const auto& cloud : clouds) {
+        if (!cloud->visible)
+          continue;
+        draws.push_back({ cloud->get_vao(), static_cast<GLsizei>(cloud->size()), CloudModel(*cloud), first_id });
+        pick_draws.emplace_back(first_id, cloud.get());
+        first_id += static_cast<uint32_t>(cloud->size());
+      }
+      // picked points cover what the drawn ones cover; the compute and software rasterizers draw every point `point_size` wide
+      const bool    splats = render_mode == RenderMode::Points || render_mode == RenderMode::Surfels;
+      PickPointSize size;
+      size.point_size     = point_size;
+      size.adaptive       = splats && adaptive_point_size;
+      size.spacing_scale  = spacing_scale;
+      size.max_point_size = splats ? max_point_size : std::max(point_size, 1.0f);
+      size.projection     = projection;
+      point_picker->request(draws, projection * view, clip_volumes, size, scene_windowSize[0], scene_windowSize[1], pick_request->x, pick_request->y);
+      gpu_timer->end();
+      pick_request.reset();
+    }
+    if (point_picker && point_picker->is_pending())
+      RequestRedraw(1);
 
     // -------------------------------- UI update  ----------------------------------
+    auto ui_start_us = Profiler::global().now_us();
     BeginUIFrame();
 
     ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_Always);
     ImGui::SetNextWindowSize(ImVec2 { -1, (float)framebufferSize[1] }, ImGuiCond_Always);
     if (ImGui::Begin("Properties", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_HorizontalScrollbar)) {
-      ImGui::Text("FPS: %d\n", (int)FPS);
+      auto frame_stats = Profiler::global().get_stats("frame");
+      ImGui::Text("Frame: %.2f ms p50, %.2f ms p99 (%d FPS)\n", frame_stats.p50, frame_stats.p99, frame_stats.p50 > 0 ? (int)(1000.0 / frame_stats.p50) : 0);
+      if (ImGui::CollapsingHeader("Profiler"))
+        DrawProfiler();
+      if (ImGui::CollapsingHeader("Picked Point", ImGuiTreeNodeFlags_DefaultOpen))
+        DrawPickedPoint();
       ImGui::Separator();
 
-      auto               current_window_size = ImGui::GetWindowSize();
-      static std::string bbox_min_str        = glm::to_string(std::get<0>(bbox));
-      static std::string bbox_max_str        = glm::to_string(std::get<1>(bbox));
       ImGui::Text("Lower Bounding Box:");
-      ImGui::Text("\t%.2f, %.2f, %.2f", std::get<0>(bbox).x, std::get<0>(bbox).y, std::get<0>(bbox).z);
+      ImGui::Text("\t%.2f, %.2f, %.2f", scene_bounds.min.x, scene_bounds.min.y, scene_bounds.min.z);
       ImGui::Text("Upper Bounding Box:");
-      ImGui::Text("\t%.2f, %.2f, %.2f", std::get<1>(bbox).x, std::get<1>(bbox).y, std::get<1>(bbox).z);
-      ImGui::Text("Center: %.2f, %.2f, %.2f", center.x, center.y, center.z);
-      ImGui::Text("Camera Distance: %f", camera_distance);
+      ImGui::Text("\t%.2f, %.2f, %.2f", scene_bounds.max.x, scene_bounds.max.y, scene_bounds.max.z);
+      ImGui::Text("Center: %.2f, %.2f, %.2f", camera.center.x, camera.center.y, camera.center.z);
+      if (scene_origin && glm::length(*scene_origin) > 0.0)
+        ImGui::Text("Origin: %.3f, %.3f, %.3f", scene_origin->x, scene_origin->y, scene_origin->z);
+      ImGui::Text("Camera Distance: %f", camera.distance);
 
       ImGui::Separator(); // --------------------------------------------------
+      int render_mode_index = static_cast<int>(render_mode);
+      if (ImGui::Combo("Renderer", &render_mode_index, render_mode_names, IM_ARRAYSIZE(render_mode_names)))
+        ActivateRenderMode(static_cast<RenderMode>(render_mode_index));
+      if (render_mode == RenderMode::Compute) {
+        ImGui::SameLine();
+        ImGui::Text(compute_rasterizer->uses_int64_atomics() ? "(64-bit atomics)" : "(32-bit, 2 passes)");
+      }
+      if (render_mode == RenderMode::Points) {
+        ImGui::Checkbox("Progressive", &progressive);
+        if (progressive) {
+          ImGui::DragInt("Points per Frame", &progressive_budget, 10000.0f, 10000, 100000000);
+          size_t point_count = std::max<size_t>(VisiblePoints(), 1);
+          ImGui::Text("\tconverged %.0f%%", 100.0 * std::min(progressive_offset, point_count) / point_count);
+        }
+      }
+      for (int i = 0; i < IM_ARRAYSIZE(render_mode_names); i++) {
+        if (render_mode_frame_time[i] > 0)
+          ImGui::Text("\t%s: %.2f ms", render_mode_names[i], render_mode_frame_time[i]);
+        else
+          ImGui::Text("\t%s: -", render_mode_names[i]);
+      }
       if (ImGui::SliderFloat("Point Size", &point_size, 0.1f, 20.0f)) {
         glPointSize(point_size);
       }
+      if (render_mode == RenderMode::Points)
+        DrawSplats();
+      else if (render_mode == RenderMode::Surfels)
+        DrawSurfels();
+      ImGui::Separator(); // --------------------------------------------------
+      if (tile_set && ImGui::CollapsingHeader("Tiles", ImGuiTreeNodeFlags_DefaultOpen))
+        DrawTiles();
+      if (ImGui::CollapsingHeader("Clouds", ImGuiTreeNodeFlags_DefaultOpen))
+        DrawClouds();
+      if (active_cloud < clouds.size() && DrawShading(*clouds[active_cloud]))
+        scene_version++;
       if (ImGui::Button("Flip YZ")) {
         if (flip_yz == false) {
           model[1][1] = 0;
@@ -229,58 +1258,32 @@ void Window::Run() {
           model[2][2] = 1;
           flip_yz     = false;
         }
-
-        std::get<0>(bbox) = glm::mat3(model) * point_cloud.get_bbox_min();
-        std::get<1>(bbox) = glm::mat3(model) * point_cloud.get_bbox_max();
-        center            = glm::vec3(std::get<0>(bbox) + std::get<1>(bbox)) / 2.0f;
+        UpdateSceneBounds();
+        for (auto& cloud : clouds)
+          if (cloud->shading.mode == Shading::Height)
+            ResetShadingRange(*cloud);
       }
       if (flip_yz) {
         ImGui::SameLine();
         ImGui::Text("flipped");
       }
-      static std::string point_window = fmt::format("Points({})", point_cloud.points.size());
-      if (ImGui::CollapsingHeader(point_window.c_str())) {
-        ImGui::Text("X,Y,Z");
-        const auto& points = point_cloud.get_points();
-        for (int i = 0; i < std::min<size_t>(points.size(), 10); i++) {
-          std::string str;
-
-          if (flip_yz)
-            str = fmt::format("{},{},{}", points[i].x, points[i].z, points[i].y);
-          else
-            str = fmt::format("{},{},{}", points[i].x, points[i].y, points[i].z);
-          ImGui::Text(str.c_str());
-        }
-        if (points.size() > 10) {
-          std::string&& str = fmt::format("...and {} more", points.size() - 10);
-          ImGui::Text(str.c_str());
-        }
-      }
-
-      static std::string color_window = fmt::format("Colors({})", point_cloud.colors.size());
-      if (ImGui::CollapsingHeader(color_window.c_str())) {
-        ImGui::Text("R,G,B");
-        const auto& colors = point_cloud.get_colors();
-        for (int i = 0; i < std::min<size_t>(colors.size(), 10); i++) {
-          std::string str;
-          if (flip_yz)
-            str = fmt::format("{},{},{}", colors[i].x, colors[i].z, colors[i].y);
-          else
-            str = fmt::format("{},{},{}", colors[i].x, colors[i].y, colors[i].z);
-          ImGui::Text(str.c_str());
-        }
-        if (colors.size() > 10) {
-          std::string&& str = fmt::format("...and {} more", colors.size() - 10);
-          ImGui::Text(str.c_str());
+      if (ImGui::CollapsingHeader("Clip Volumes"))
+        DrawClipVolumes();
+      if (active_cloud < clouds.size()) {
+        const SceneCloud& cloud         = *clouds[active_cloud];
+        std::string       points_header = fmt::format("Points of {}({})###Points", cloud.name, cloud.size());
+        if (ImGui::CollapsingHeader(points_header.c_str())) {
+          if (auto clicked = point_table.draw(cloud.cloud, CloudModel(cloud), picked_point))
+            picked_point = clicked;
         }
       }
 
       ImGui::Separator(); // --------------------------------------------------
       if (ImGui::CollapsingHeader("Camera")) {
-        ImGui::DragFloat("Fov", &camera_fov, 1.0f, 1.0f, 179.0f);
-        ImGui::DragFloat("Distance", &camera_distance);
-        ImGui::DragFloat("Theta", &camera_theta, 0.1f);
-        ImGui::DragFloat("Phi", &camera_phi, 0.1f, 0.01, M_PI_2 - 0.01);
+        ImGui::DragFloat("Fov", &camera.fov, 1.0f, 1.0f, 179.0f);
+        ImGui::DragFloat("Distance", &camera.distance);
+        ImGui::DragFloat("Theta", &camera.theta, 0.1f);
+        ImGui::DragFloat("Phi", &camera.phi, 0.1f, 0.01, M_PI_2 - 0.01);
       }
 
       ImGui::Separator(); // --------------------------------------------------
@@ -325,6 +1328,12 @@ void Window::Run() {
       scene_windowPos[1]           = (int)window_pos.y;
       scene_windowSize[0]          = (int)window_size.x;
       scene_windowSize[1]          = (int)window_size.y;
+      if (scene_image) {
+        // GL textures start at the bottom row, the CPU image at the top one
+        ImVec2 uv0 { 0.0f, scene_image_bottom_up ? 1.0f : 0.0f };
+        ImVec2 uv1 { 1.0f, scene_image_bottom_up ? 0.0f : 1.0f };
+        ImGui::GetBackgroundDrawList()->AddImage((ImTextureID)(intptr_t)scene_image, window_pos, ImVec2 { window_pos.x + window_size.x, window_pos.y + window_size.y }, uv0, uv1);
+      }
       static bool       mouse_down = false;
       static glm::dvec2 current_cursor, last_cursor;
       if (ImGui::IsWindowHovered()) {
@@ -341,26 +1350,31 @@ void Window::Run() {
             float dx = current_cursor.x - last_cursor.x;
             float dy = current_cursor.y - last_cursor.y;
 
-            camera_theta -= 0.001f * dx;
+            camera.theta -= 0.001f * dx;
             float dphi = -0.001f * dy;
             if (dphi < 0) {
-              if (camera_phi > glm::radians(10.0f))
-                camera_phi += dphi;
+              if (camera.phi > glm::radians(10.0f))
+                camera.phi += dphi;
             } else if (dphi > 0)
-              if (camera_phi < glm::radians(170.0f))
-                camera_phi += dphi;
+              if (camera.phi < glm::radians(170.0f))
+                camera.phi += dphi;
           }
         } else {
           scene_windowHovered = false;
           mouse_down          = false;
         }
+        if (ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
+          ImVec2 mouse = ImGui::GetMousePos();
+          pick_request = glm::ivec2(static_cast<int>(mouse.x - window_pos.x), static_cast<int>(window_pos.y + window_size.y - mouse.y));
+          RequestRedraw();
+        }
 
-        static float d = glm::distance(std::get<0>(bbox), std::get<1>(bbox));
+        const float d = glm::distance(scene_bounds.min, scene_bounds.max);
         if (mouse_scroll_state[1] > 0.5) {
-          camera_distance       = std::max(d * 0.1f, camera_distance - 0.03f * d);
+          camera.distance       = std::max(d * 0.1f, camera.distance - 0.03f * d);
           mouse_scroll_state[1] = 0;
         } else if (mouse_scroll_state[1] < -0.5) {
-          camera_distance += 0.03f * d;
+          camera.distance += 0.03f * d;
           mouse_scroll_state[1] = 0;
         }
       }
@@ -368,8 +1382,20 @@ void Window::Run() {
     ImGui::End();
 
     EndUIFrame();
+    Profiler::global().record_cpu("ui", ui_start_us, Profiler::global().now_us() - ui_start_us);
 
+    gpu_timer->begin("imgui");
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    gpu_timer->end();
     glfwSwapBuffers(window);
+
+    // widgets being dragged or edited change state without producing new events
+    if (ImGui::IsAnyItemActive())
+      RequestRedraw(1);
+
+    // timed per frame rather than between frames, idle gaps would skew it otherwise
+    double& frame_time = render_mode_frame_time[static_cast<int>(render_mode)];
+    double  delta_ms   = (glfwGetTime() - frame_start_time) * 1000.0;
+    frame_time         = frame_time <= 0 ? delta_ms : 0.95 * frame_time + 0.05 * delta_ms;
   }
 }
\ No newline at end of file
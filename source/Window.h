@@ -8,12 +8,50 @@
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_glfw.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <cstdlib>
 #include <string>
 #include <limits.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include "Benchmark.h"
+#include "Camera.h"
+#include "ClipVolume.h"
+#include "ColorMap.h"
+#include "PointCloud.h"
+#include "ComputeRasterizer.h"
+#include "FileWatcher.h"
+#include "GpuTimer.h"
+#include "PointPicker.h"
+#include "PointTable.h"
+#include "RenderTarget.h"
+#include "SceneCloud.h"
+#include "SoftwareRasterizer.h"
+#include "SurfelRenderer.h"
+#include "TileSet.h"
 
 using namespace glm;
 
+/** @brief how the point cloud is turned into pixels */
+enum class RenderMode {
+  Points,   ///< fixed-function `GL_POINTS`
+  Compute,  ///< compute-shader rasterizer, for very dense clouds
+  Software, ///< CPU rasterizer, for hosts without a usable GPU
+  Surfels,  ///< discs oriented by the normals and blended together, for presentation renders
+  Count,
+};
+
+/** @brief footprint of a point drawn by `RenderMode::Points` */
+enum class SplatShape {
+  Square,     ///< the whole `GL_POINTS` square, no fragment is discarded
+  Circle,     ///< the disc inscribed in the square, the corners are discarded
+  Paraboloid, ///< a disc whose depth bulges towards the camera, so overlapping splats intersect smoothly
+  Count,
+};
+
 /**
  * @brief OpenGL window class
  * @details This class is used to create an OpenGL window and handle events.
@@ -23,6 +61,7 @@ using namespace glm;
  * #include "Window.h"
  *
  * Window window("point cloud viewer", 1600, 1000);
+ * window.AddPointCloud("bunny", std::move(point_cloud));
  * try
  * {
  *     window.Run();
@@ -38,6 +77,7 @@ class Window {
  private:
   const std::string appName;
   int               width, height;
+  bool              visible;
   GLFWwindow*       window;
 
   vec4 clearColor { 1, 1, 1, 1 };
@@ -47,21 +87,221 @@ class Window {
   int  scene_windowSize[2] { 800, 800 };
   bool scene_windowHovered = false;
 
-  float camera_fov { 45.0f };
-  float camera_distance { -1.0f };
-  float camera_theta {};
-  float camera_phi { static_cast<float>(M_PI_2) };
+  Camera camera;
+
+  // every cloud of the scene; the Properties panel shows the shading and the points of `active_cloud`
+  std::vector<std::unique_ptr<SceneCloud>> clouds;
+  size_t                                   active_cloud { 0 };
+  uint64_t                                 scene_version { 0 }; // bumped on edits of the clouds' visibility, placement or shading
+
+  glm::mat4 model { 1.0f }; // applied to every cloud after its own transform
+  Bounds    scene_bounds;   // exact bounds of all the clouds after their transforms, and of every tile
+
+  // the world the camera sees is relative to this, the origin of the first cloud, so that float
+  // matrices stay precise for georeferenced clouds; unset until a cloud or a tile set is added
+  std::optional<glm::dvec3> scene_origin;
+
+  // tiles streamed in as the view needs them, each one a cloud of `clouds` while loaded
+  std::unique_ptr<TileSet> tile_set;
+
+  // clouds read again when their `source` file changes, see `WatchFiles`
+  struct Reload {
+    bool         appended { false }; // `cloud` holds only the points appended to the file
+    PointCloud   cloud;
+    FileSnapshot snapshot;
+  };
+  std::unique_ptr<FileWatcher>                             file_watcher;
+  std::function<PointCloud(const std::string&)>            reload_file;
+  std::function<void(PointCloud&)>                         prepare_appended;
+  std::function<bool(const std::string&)>                  appendable_file;
+  std::vector<std::string>                                 reload_queue; // changed files waiting for their previous reload
+  std::vector<std::pair<std::string, std::future<Reload>>> reloads;      // running, one per file
 
   bool  flip_yz { false };
   float point_size = 5.0f;
 
+  // splats of the GL_POINTS renderer; discarding fragments or writing their depth turns off early
+  // depth testing, so every shape has its own program and its own GPU zone in the profiler
+  SplatShape splat_shape { SplatShape::Square };
+  bool       adaptive_point_size { false }; // size points from their spacing, see `SceneCloud::request_spacing`
+  float      spacing_scale { 1.5f };        // splat diameter over the spacing
+  float      max_point_size { 32.0f };      // pixels, bounds adaptive splats of isolated points
+
+  std::atomic<int> redraw_frames { 3 };  // frames left to draw before the loop goes idle
+  double           idle_timeout { 0.5 }; // seconds, upper bound on a blocking event wait
+
+  RenderMode         render_mode { RenderMode::Points };
+  double             render_mode_frame_time[static_cast<int>(RenderMode::Count)] {}; // smoothed, in ms
+
+  // one program per splat shape draws every cloud, switching clouds only rebinds its VAO and its uniform block
+  GLuint            point_cloud_shaders[static_cast<int>(SplatShape::Count)] {};
+  GLuint            colormap_texture { 0 };     // one row per `ColorMap`
+  GLuint            cloud_uniform_buffer { 0 }; // one `CloudUniforms` entry per cloud, rewritten every frame
+  size_t            cloud_uniform_stride { 0 }; // entry size rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  std::vector<char> cloud_uniform_data;
+
+  std::unique_ptr<ComputeRasterizer> compute_rasterizer;
+  std::unique_ptr<SurfelRenderer>    surfel_renderer;
+  float                              surfel_depth_offset { 0.5f }; // radii behind the nearest surface still blended with it
+  size_t                             surfel_drawn_points { 0 };    // by the last frame, at most `progressive_budget`
+  std::unique_ptr<GpuTimer>          gpu_timer;
+
+  // right-click picking: the request is rendered with the next frame, the result arrives a few frames later
+  std::unique_ptr<PointPicker>                  point_picker;
+  std::optional<glm::ivec2>                     pick_request; // pixel in the scene viewport, from its lower-left corner
+  std::optional<uint32_t>                       picked_point; // index in the active cloud
+  std::vector<std::pair<uint32_t, SceneCloud*>> pick_draws;   // first id and cloud of every draw of the last request
+  PointTable                                    point_table;  // points of the active cloud, a clicked row becomes `picked_point`
+
+  // clip volumes are evaluated by the point shaders; chunks they hide entirely are not even drawn
+  std::vector<ClipVolume>       clip_volumes;
+  uint64_t                      clip_version { 0 }; // bumped on every edit of `clip_volumes`
+  char                          clip_export_path[256] { "clipped.xyz" };
+  std::string                   clip_export_status;
+
+  // texture drawn behind the Scene window instead of the GL viewport, 0 when the scene is drawn directly
+  GLuint scene_image { 0 };
+  bool   scene_image_bottom_up { false };
+
+  // progressive accumulation: points are drawn in a shuffled order, one budget-sized slice per frame
+  struct AccumulationKey {
+    glm::mat4       mvp;
+    glm::vec4       clear_color;
+    float           point_size;
+    int             size[2];
+    uint64_t        scene_version;
+    uint64_t        clip_version;
+
+    // field by field, the padding before `scene_version` is indeterminate
+    bool operator==(const AccumulationKey& other) const {
+      return mvp == other.mvp && clear_color == other.clear_color && point_size == other.point_size && size[0] == other.size[0]
+          && size[1] == other.size[1] && scene_version == other.scene_version && clip_version == other.clip_version;
+    }
+  };
+  bool                          progressive { false };
+  int                           progressive_budget { 2000000 }; // points per frame, also bounds the surfel renderer
+  size_t                        progressive_offset { 0 };
+  AccumulationKey               accumulation_key {};
+  std::unique_ptr<RenderTarget> accumulation;
+
+  SoftwareRasterizer software_rasterizer;
+  GLuint             software_texture { 0 };
+  int                software_texture_size[2] { 0, 0 };
+
  private:
   void InitGLFW();
 
   void CreateGLFWWindow();
 
+  /** redraw on any input; installed before ImGui so its own callbacks chain to these */
+  void InstallInputCallbacks();
+
   void InitGL();
 
+  /** GL state, shaders, point buffers and the active renderer shared by `Run` and `RunBenchmark` */
+  void InitScene();
+
+  /**
+   * @brief recompute `scene_bounds`, whenever `model`, a cloud transform or the clouds change
+   * @param recenter_camera false to keep the camera where it is, e.g. when a file is reloaded
+   */
+  void UpdateSceneBounds(bool recenter_camera = true);
+
+  /** start reloading the files that changed and swap in the clouds of the reloads that finished */
+  void UpdateReloads();
+
+  /**
+   * @brief load the tiles in view, nearest first, and drop the ones the tile set evicts
+   * @details Only the tile bounds are tested against the frustum, tiles outside it are not read.
+   */
+  void UpdateTiles(const glm::mat4& view_projection);
+
+  /** remove cloud `i` from the scene, keeping the active cloud and the pick consistent */
+  void RemoveCloud(size_t i);
+
+  /** fit the shading range of `cloud` to the values of its shading mode */
+  void ResetShadingRange(SceneCloud& cloud);
+
+  /**
+   * @brief the transform from the points of `cloud` to the world
+   * @details Composed in double: the origins of the cloud and of the scene, both possibly far from
+   * zero, cancel before anything is rounded to float.
+   */
+  glm::mat4 CloudModel(const SceneCloud& cloud) const;
+
+  /** the transform from the tile bounds of `tile_set` to the world, like `CloudModel` */
+  glm::mat4 TileSetModel() const;
+
+  /** number of points of the visible clouds */
+  size_t VisiblePoints() const;
+
+  /** splat shape, adaptive sizing and their GPU cost, drawn inside the Properties panel */
+  void DrawSplats();
+
+  /** adaptive sizing controls shared by the splat and surfel renderers; returns true on any change */
+  bool DrawSplatSize();
+
+  /** point budget, blend depth and GPU cost of the surfel renderer, drawn inside the Properties panel */
+  void DrawSurfels();
+
+  /** cloud list, placement of the active cloud and removal, drawn inside the Properties panel */
+  void DrawClouds();
+
+  /** residency and memory budget of the tile set, drawn inside the Properties panel */
+  void DrawTiles();
+
+  /** shading controls of `cloud`, drawn inside the Properties panel; returns true on any change */
+  bool DrawShading(SceneCloud& cloud);
+
+  /** fill the `Cloud` uniform block of every cloud for this frame */
+  void UploadCloudUniforms(const glm::mat4& view_projection);
+
+  /** bind the uniform block and the vertex array of cloud `i` */
+  void BindCloud(size_t i);
+
+  /** true when some clip volume is enabled */
+  inline bool IsClipping() const {
+    return std::any_of(clip_volumes.begin(), clip_volumes.end(), [](const ClipVolume& v) { return v.enabled; });
+  }
+
+  /** clip volume editor and export, drawn inside the Properties panel */
+  void DrawClipVolumes();
+
+  /** write the points of the active cloud kept by the clip volumes to `clip_export_path`, selected through its kd-tree */
+  void ExportClipped();
+
+  /** draw the visible clouds with the current render mode into the scene viewport */
+  void RenderScene(const glm::mat4& view, const glm::mat4& projection);
+
+  void RenderSoftware(const glm::mat4& view_projection);
+
+  /** uniforms of the splat vertex shader and the clip volumes for `shader`, which must be in use */
+  void SetSplatUniforms(GLuint shader, const glm::mat4& projection, float splat_scale);
+
+  /** bind the scalar attributes of the visible clouds, request their spacing if needed and upload their uniform blocks */
+  void PrepareSplats(const glm::mat4& view_projection);
+
+  /**
+   * @brief draw the visible clouds with `surfel_renderer`, at most `progressive_budget` points of them
+   * @details Every visible cloud contributes the same fraction of its points, a prefix of its shuffled order.
+   */
+  void RenderSurfels(const glm::mat4& view, const glm::mat4& projection);
+
+  /** position, color, normal and attributes of `picked_point`, drawn inside the Properties panel */
+  void DrawPickedPoint();
+
+  /** per-zone percentiles and trace export, drawn inside the Properties panel */
+  void DrawProfiler();
+
+  /**
+   * @brief draw the next slice into the accumulation buffer, restarting whenever the view changed
+   * @details Every visible cloud contributes the same fraction of its points to a slice.
+   */
+  void RenderProgressive(const glm::mat4& view_projection);
+
+  /** create the renderer behind `mode` if needed, falls back to `RenderMode::Points` on failure */
+  void ActivateRenderMode(RenderMode mode);
+
   inline void InitImGui() {
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -92,17 +332,40 @@ class Window {
   }
 
  public:
-  Window(const char* _appName, int _width, int _height)
+  /** @param _visible false for a hidden window, used as a GL context for offscreen benchmarks */
+  Window(const char* _appName, int _width, int _height, bool _visible = true)
       : appName { _appName }
       , width { _width }
-      , height { _height } {
+      , height { _height }
+      , visible { _visible } {
     InitGLFW();
     CreateGLFWWindow();
+    InstallInputCallbacks();
     InitGL();
     InitImGui();
   };
 
   ~Window() {
+    if (software_texture)
+      glDeleteTextures(1, &software_texture);
+    compute_rasterizer.reset();
+    surfel_renderer.reset();
+    gpu_timer.reset();
+    point_picker.reset();
+    accumulation.reset();
+    point_table.invalidate();
+    file_watcher.reset();
+    for (auto& [path, reload] : reloads)
+      reload.wait();
+    clouds.clear();
+    tile_set.reset();
+    if (point_cloud_shaders[0]) {
+      glDeleteBuffers(1, &cloud_uniform_buffer);
+      glDeleteTextures(1, &colormap_texture);
+      for (GLuint shader : point_cloud_shaders)
+        glDeleteProgram(shader);
+    }
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -111,8 +374,47 @@ class Window {
     glfwTerminate();
   }
 
+  /**
+   * @brief add `cloud` to the scene under `name`, placed by `transform`
+   * @details The buffers are uploaded by the next frame, the first cloud added becomes the active one.
+   * @param source file `cloud` was read from, reloaded when it changes once `WatchFiles` is called
+   */
+  void AddPointCloud(std::string name, PointCloud cloud, const glm::mat4& transform = glm::mat4(1.0f), const std::string& source = "");
+
+  /**
+   * @brief reload the clouds added with a `source` whenever their file changes, on a worker thread
+   * @details `reload` reads a whole file again. When a text file was only appended to, only the new
+   * lines are parsed, passed through `prepare` on their own and uploaded. Either way the camera stays
+   * where it is. Files `appendable` rejects, e.g. ones whose colors come from a companion file that
+   * does not grow with them or whose processing looks at neighbouring points, are always read whole.
+   */
+  void WatchFiles(std::function<PointCloud(const std::string&)> reload, std::function<void(PointCloud&)> prepare,
+                  std::function<bool(const std::string&)> appendable = {});
+
+  /** stream the tiles of `tiles` into the scene as the camera reaches them, alongside the clouds added */
+  void SetTileSet(std::unique_ptr<TileSet> tiles);
+
   void Run();
 
+  /**
+   * @brief render `frames` frames of size `frame_width` x `frame_height` offscreen along `path` and time each of them
+   * @details Every frame is finished with `glFinish`, so the times include the GPU work and do not
+   * depend on vsync or on the window being shown. A few warm-up frames are rendered first and not
+   * reported. Progressive accumulation is disabled, each frame draws the whole cloud.
+   */
+  BenchmarkReport RunBenchmark(const CameraPath& path, int frames, int frame_width, int frame_height);
+
+  /**
+   * @brief schedule at least `frames` more frames, the loop blocks in `glfwWaitEventsTimeout` otherwise
+   * @details Several frames are needed because ImGui settles hover and layout state one frame late.
+   * Other threads must follow this with `glfwPostEmptyEvent()` to wake the loop.
+   */
+  inline void RequestRedraw(int frames = 3) {
+    int current = redraw_frames.load();
+    while (current < frames && !redraw_frames.compare_exchange_weak(current, frames)) {
+    }
+  }
+
   inline vec4 GetClearColor() {
     return clearColor;
   }
@@ -122,6 +424,14 @@ class Window {
     glClearColor(color.r, color.g, color.b, color.a);
   }
 
+  inline RenderMode GetRenderMode() const {
+    return render_mode;
+  }
+
+  inline void SetRenderMode(RenderMode mode) {
+    render_mode = mode;
+  }
+
   inline const std::string& GetApplicationName() {
     return appName;
   }
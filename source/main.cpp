@@ -1,32 +1,170 @@
 #include "Window.h"
+#include "Benchmark.h"
+#include "NormalEstimation.h"
+#include "OutlierRemoval.h"
 #include "PointCloud.h"
+#include "Profiler.h"
+#include "SpatialIndex.h"
+#include "TileSet.h"
+#include "VoxelGrid.h"
 #include "structopt.hpp"
+#include <array>
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <filesystem>
 namespace fs = std::filesystem;
 #include <algorithm>
 
 struct Options {
-  std::string                point_cloud;
+  std::vector<std::string>   point_clouds; // files shown together, directories and globs streamed as tiles; `normals`, `colors` and `scalars` belong to the first
   std::optional<std::string> normals;
   std::optional<std::string> colors;
+  std::optional<bool>        software = false;
+  std::optional<std::string> scalars; // after `software`, which keeps `-s`; loaded as the `scalar` attribute
+  std::optional<std::string> trace;
+  std::optional<std::string> benchmark;
+  std::optional<std::string> keyframes;
+  std::optional<int>         frames = 300;
+  std::optional<int>                   estimate_normals = 16;
+  std::optional<std::array<double, 3>> orient; // in the coordinates of the file, however large
+  std::optional<float>                 leaf_size;
+  std::optional<bool>                  representative = false;
+  std::optional<std::array<float, 2>>  denoise;
+  std::optional<std::array<float, 2>>  min_neighbours;
+  std::optional<int>                   memory_budget = 2048;  // MB of loaded tiles; after `min_neighbours`, which keeps `-m`
+  std::optional<bool>                  watch         = false; // reload the files given directly when they change
 };
-STRUCTOPT(Options, point_cloud, normals, colors);
+STRUCTOPT(Options, point_clouds, normals, colors, software, scalars, trace, benchmark, keyframes, frames, estimate_normals, orient, leaf_size,
+          representative, denoise, min_neighbours, memory_budget, watch);
 Options options;
 
-//-------------- global variables --------------------------------
+//-------------- functions ----------------------------------------
 
-PointCloud point_cloud;
+/** whether `value` is a neighbour count: at least 1 and small enough to convert to `size_t`, fractions are dropped */
+static bool is_count(float value) {
+  return std::isfinite(value) && value >= 1.0f && value <= static_cast<float>(1 << 24);
+}
 
-//-------------- functions ----------------------------------------
+/** whether `value` is a length, finite and over 0 */
+static bool is_length(float value) {
+  return std::isfinite(value) && value > 0.0f;
+}
+
+/** print what is wrong with the filter and normal estimation options, if anything, before any of them runs */
+static bool check_options() {
+  if (options.denoise && (!is_count(options.denoise.value()[0]) || !std::isfinite(options.denoise.value()[1]))) {
+    std::cout << "--denoise needs k >= 1 and a finite number of std deviations\n";
+    return false;
+  }
+  if (options.min_neighbours && (!is_length(options.min_neighbours.value()[0]) || !is_count(options.min_neighbours.value()[1]))) {
+    std::cout << "--min-neighbours needs a radius > 0 and n >= 1\n";
+    return false;
+  }
+  if (options.estimate_normals.value() < 0 || options.estimate_normals.value() > (1 << 24)) {
+    std::cout << "--estimate-normals needs k >= 1, or 0 to disable it\n";
+    return false;
+  }
+  if (options.leaf_size && !is_length(options.leaf_size.value())) {
+    std::cout << "--leaf-size needs a size > 0\n";
+    return false;
+  }
+  return true;
+}
+
+/** @brief run the filters and the normal estimation asked for on `point_cloud` */
+static void prepare_point_cloud(PointCloud& point_cloud) {
+  //-------------- filters --------------------------------
+  if (options.denoise || options.min_neighbours) {
+    // both filters look at the unfiltered cloud through the same index, their masks are combined
+    PROFILE_SCOPE("outlier_removal");
+    auto                 start_us = Profiler::global().now_us();
+    const auto&          points   = point_cloud.get_points();
+    SpatialIndex         index(points);
+    std::vector<uint8_t> keep(points.size(), 1);
+    auto                 combine = [&](const char* name, const std::vector<uint8_t>& mask) {
+      size_t removed = 0;
+      for (size_t i = 0; i < keep.size(); i++) {
+        removed += !mask[i];
+        keep[i] &= mask[i];
+      }
+      spdlog::info("{} outliers: {} of {} points", name, removed, mask.size());
+    };
+    if (options.denoise)
+      combine("Statistical", statistical_outlier_mask(points, index, static_cast<size_t>(options.denoise.value()[0]), options.denoise.value()[1]));
+    if (options.min_neighbours)
+      combine("Radius", radius_outlier_mask(points, index, options.min_neighbours.value()[0], static_cast<size_t>(options.min_neighbours.value()[1])));
+
+    size_t before = points.size();
+    point_cloud.keep_points(keep);
+    spdlog::info("Outlier removal: removed {} of {} points in {:.0f} ms", before - point_cloud.get_points().size(), before,
+                 (Profiler::global().now_us() - start_us) / 1000.0);
+  }
+  if (options.leaf_size) {
+    PROFILE_SCOPE("voxel_grid");
+    auto   start_us = Profiler::global().now_us();
+    size_t before   = point_cloud.get_points().size();
+    point_cloud     = voxel_grid_filter(point_cloud, options.leaf_size.value(),
+                                        options.representative.value() ? VoxelReduction::Representative : VoxelReduction::Centroid);
+    spdlog::info("Voxel grid {}: {} -> {} points in {:.0f} ms", options.leaf_size.value(), before, point_cloud.get_points().size(),
+                 (Profiler::global().now_us() - start_us) / 1000.0);
+  }
+
+  //-------------- normals --------------------------------
+  // colors are computed by the point shader from whatever is loaded, only missing normals need work here
+  if (point_cloud.colors.empty() && point_cloud.normals.empty() && point_cloud.attributes.empty() && options.estimate_normals.value() > 0) {
+    PROFILE_SCOPE("estimate_normals");
+    auto start_us = Profiler::global().now_us();
+    std::optional<glm::vec3> viewpoint;
+    if (options.orient)
+      viewpoint = glm::vec3(glm::dvec3(options.orient.value()[0], options.orient.value()[1], options.orient.value()[2]) - point_cloud.origin);
+    SpatialIndex index(point_cloud.get_points());
+    point_cloud.normals = estimate_normals(point_cloud.get_points(), index, static_cast<size_t>(options.estimate_normals.value()), viewpoint);
+    spdlog::info("Estimated {} normals from {} neighbours in {:.0f} ms", point_cloud.normals.size(), options.estimate_normals.value(),
+                 (Profiler::global().now_us() - start_us) / 1000.0);
+  }
+}
+
+/**
+ * @brief load `filename` and run the filters and the normal estimation asked for; the `first` cloud also gets the companion files
+ * @details Throws on failure. Tiles are loaded through here too, on pool threads.
+ */
+static PointCloud load_point_cloud(const std::string& filename, bool first) {
+  //-------------- initialize Point Cloud --------------------------------
+  PointCloud point_cloud;
+  {
+    PROFILE_SCOPE("load_points");
+    point_cloud.load_points(filename);
+  }
+  spdlog::debug("PointCloud loaded {} points from {}", point_cloud.get_points().size(), filename);
+
+  if (options.colors && first) {
+    PROFILE_SCOPE("load_colors");
+    point_cloud.load_colors(options.colors.value());
+    spdlog::debug("PointCloud loaded {} colors", point_cloud.get_colors().size());
+  }
+  if (options.normals && first) {
+    PROFILE_SCOPE("load_normals");
+    point_cloud.load_normals(options.normals.value());
+    spdlog::debug("PointCloud loaded {} normals", point_cloud.normals.size());
+  }
+  if (options.scalars && first) {
+    PROFILE_SCOPE("load_scalars");
+    point_cloud.load_attribute(options.scalars.value(), "scalar");
+    spdlog::debug("PointCloud loaded {} scalars", point_cloud.attributes.find("scalar")->size());
+  }
+
+  prepare_point_cloud(point_cloud);
+  return point_cloud;
+}
 
 int main(int argc, char** argv) {
 #ifndef NDEBUG
   spdlog::set_level(spdlog::level::level_enum::debug);
 #else
-  spdlog::set_level(spdlog::level::level_enum::warn);
+  spdlog::set_level(spdlog::level::level_enum::info);
 #endif
 
   try {
@@ -36,34 +174,90 @@ int main(int argc, char** argv) {
     std::cout << e.help();
     exit(EXIT_FAILURE);
   }
+  if (!check_options())
+    exit(EXIT_FAILURE);
 
-  //-------------- initialize Point Cloud --------------------------------
-  point_cloud.load_points(options.point_cloud);
-  spdlog::debug("PointCloud loaded {} points", point_cloud.get_points().size());
-
-  if (options.colors) {
-    point_cloud.load_colors(options.colors.value());
-    spdlog::debug("PointCloud loaded {} colors", point_cloud.get_colors().size());
-  } else {
-    if (options.normals) {
-      point_cloud.load_normals(options.normals.value());
-      spdlog::debug("PointCloud loaded {} normals", point_cloud.normals.size());
-      const std::vector<glm::vec3>& normals = point_cloud.normals;
-      std::vector<glm::vec3>        colors(normals.size());
-      std::transform(normals.begin(), normals.end(), colors.begin(),
-                     [](const glm::vec3& n) { return (glm::normalize(n) + 1.0f) / 2.0f; });
-      point_cloud.set_colors(colors);
+  //-------------- initialize Point Clouds --------------------------------
+  if (options.point_clouds.empty()) {
+    std::cout << "no point cloud given\n";
+    exit(EXIT_FAILURE);
+  }
+  // single files are loaded now, directories and globs become one tile set read as the view needs it
+  std::vector<std::string> files, tiles;
+  for (const auto& path : options.point_clouds) {
+    if (TileSet::is_pattern(path)) {
+      auto expanded = TileSet::expand(path);
+      if (expanded.empty())
+        spdlog::warn("{}: no .ply, .xyz or .txt files", path);
+      tiles.insert(tiles.end(), expanded.begin(), expanded.end());
     } else {
-      spdlog::debug("PointCloud loaded no colors, set all colors to black");
-      std::vector<glm::vec3> colors(point_cloud.get_points().size(), glm::vec3(0.0f, 0.0f, 0.0f));
-      point_cloud.set_colors(colors);
+      files.push_back(path);
     }
   }
+  std::vector<PointCloud>  point_clouds;
+  std::unique_ptr<TileSet> tile_set;
+  try {
+    for (const auto& file : files)
+      point_clouds.push_back(load_point_cloud(file, file == options.point_clouds.front()));
+    if (!tiles.empty())
+      tile_set = std::make_unique<TileSet>(tiles, [](const std::string& path) { return load_point_cloud(path, false); },
+                                           static_cast<size_t>(std::max(options.memory_budget.value(), 1)) << 20);
+  } catch (const std::exception& e) {
+    spdlog::critical("{}", e.what());
+    exit(EXIT_FAILURE);
+  }
+  if (point_clouds.empty() && !tile_set) {
+    std::cout << "no point cloud given\n";
+    exit(EXIT_FAILURE);
+  }
+  auto add_point_clouds = [&](Window& window) {
+    for (size_t i = 0; i < point_clouds.size(); i++)
+      window.AddPointCloud(fs::path(files[i]).filename().string(), std::move(point_clouds[i]), glm::mat4(1.0f), files[i]);
+    if (tile_set)
+      window.SetTileSet(std::move(tile_set));
+  };
 
-  assert(point_cloud.get_points().size() == point_cloud.get_colors().size());
+  //-------------- offscreen benchmark --------------------------------
+  if (options.benchmark) {
+    try {
+      CameraPath path = options.keyframes ? CameraPath::load(options.keyframes.value()) : CameraPath::orbit();
+      Window     window("point cloud viewer", 1280, 720, false);
+      add_point_clouds(window);
+      if (options.software.value())
+        window.SetRenderMode(RenderMode::Software);
+      BenchmarkReport report = window.RunBenchmark(path, options.frames.value(), 1280, 720);
+      if (!report.write_json(options.benchmark.value()))
+        exit(EXIT_FAILURE);
+    } catch (const std::exception& e) {
+      spdlog::critical("{}", e.what());
+      exit(EXIT_FAILURE);
+    }
+    if (options.trace)
+      Profiler::global().export_chrome_trace(options.trace.value());
+    return EXIT_SUCCESS;
+  }
 
   //-------------- initialize Window --------------------------------
   Window window("point cloud viewer", 1600, 1000);
+  add_point_clouds(window);
+  if (options.watch.value()) {
+    // companion files only cover the points the first cloud had, appended lines would get none of their values
+    const bool companions = options.colors || options.normals || options.scalars;
+    if (companions)
+      spdlog::warn("--colors, --normals and --scalars belong to {}, it is read whole with them whenever it changes", options.point_clouds.front());
+    // the filters and the normal estimation look at the neighbours of each point, which a tail alone
+    // lacks at its border with the points already loaded, so the whole file is processed again
+    const bool neighbourhood = options.denoise || options.min_neighbours || options.leaf_size || options.estimate_normals.value() > 0;
+    if (neighbourhood)
+      spdlog::warn("--denoise, --min-neighbours, --leaf-size and --estimate-normals need every point, watched files are read whole whenever "
+                   "they change; pass --estimate-normals 0 without the filters to only read appended lines");
+    window.WatchFiles([](const std::string& path) { return load_point_cloud(path, path == options.point_clouds.front()); }, prepare_point_cloud,
+                      [companions, neighbourhood](const std::string& path) {
+                        return !neighbourhood && (!companions || path != options.point_clouds.front());
+                      });
+  }
+  if (options.software.value())
+    window.SetRenderMode(RenderMode::Software);
   try {
     window.Run();
   } catch (const std::exception& e) {
@@ -71,5 +265,8 @@ int main(int argc, char** argv) {
     exit(EXIT_FAILURE);
   }
 
+  if (options.trace)
+    Profiler::global().export_chrome_trace(options.trace.value());
+
   return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "SyntheticCloud.h"
+#include "Profiler.h"
+#include "structopt.hpp"
+#include <spdlog/spdlog.h>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+
+struct Options {
+  std::string                output;
+  std::optional<size_t>      points       = 1000000;
+  std::optional<std::string> distribution = "box";
+  std::optional<uint64_t>    seed         = 0;
+  std::optional<float>       extent       = 100.0f;
+  std::optional<bool>        normals      = false;
+  std::optional<bool>        colors       = false;
+  std::optional<size_t>      clusters     = 16; // after `colors`, which keeps `-c`
+};
+STRUCTOPT(Options, output, points, distribution, seed, extent, normals, colors, clusters);
+
+int main(int argc, char** argv) {
+  spdlog::set_level(spdlog::level::level_enum::info);
+
+  Options options;
+  try {
+    options = structopt::app("point_cloud_generator", "0.1").parse<Options>(argc, argv);
+  } catch (structopt::exception& e) {
+    std::cout << e.what() << "\n";
+    std::cout << e.help();
+    exit(EXIT_FAILURE);
+  }
+
+  auto distribution = parse_distribution(options.distribution.value());
+  if (!distribution) {
+    spdlog::critical("Unknown distribution {}, expected box, scanlines, clusters or sphere", options.distribution.value());
+    exit(EXIT_FAILURE);
+  }
+
+  SyntheticCloudOptions cloud;
+  cloud.count        = options.points.value();
+  cloud.distribution = distribution.value();
+  cloud.seed         = options.seed.value();
+  cloud.extent       = options.extent.value();
+  cloud.clusters     = options.clusters.value();
+  cloud.normals      = options.normals.value();
+  cloud.colors       = options.colors.value();
+
+  const double start_us = Profiler::global().now_us();
+  try {
+    write_synthetic_cloud(cloud, options.output);
+  } catch (const std::exception& e) {
+    spdlog::critical("{}", e.what());
+    exit(EXIT_FAILURE);
+  }
+  const double seconds = (Profiler::global().now_us() - start_us) / 1e6;
+  spdlog::info("Wrote {} points in {:.2f} s ({:.1f} M points/s)", cloud.count, seconds,
+               static_cast<double>(cloud.count) / seconds / 1e6);
+  return EXIT_SUCCESS;
+}
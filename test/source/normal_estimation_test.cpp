@@ -0,0 +1,40 @@
+#include "NormalEstimation.h"
+#include "test_data.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+TEST_CASE("estimate_normals finds the normal of a plane and faces the viewpoint", "[NormalEstimation]") {
+  // random points on the plane through the origin with normal (1, 2, 2) / 3
+  const glm::vec3        n(1.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f);
+  const glm::vec3        u = glm::normalize(glm::cross(n, glm::vec3(1.0f, 0.0f, 0.0f)));
+  const glm::vec3        v = glm::cross(n, u);
+  std::vector<glm::vec3> points;
+  for (const auto& r : random_points(500, 11))
+    points.push_back(r.x * u + r.y * v);
+  const SpatialIndex index(points);
+
+  SECTION("without a viewpoint the plane is found up to its sign") {
+    for (const auto& normal : estimate_normals(points, index, 12)) {
+      REQUIRE(glm::length(normal) == Catch::Approx(1.0f));
+      REQUIRE(std::abs(glm::dot(normal, n)) == Catch::Approx(1.0f).epsilon(1e-4));
+    }
+  }
+  SECTION("with a viewpoint every normal faces it") {
+    for (const auto& normal : estimate_normals(points, index, 12, 5.0f * n))
+      REQUIRE(glm::dot(normal, n) == Catch::Approx(1.0f).epsilon(1e-4));
+    for (const auto& normal : estimate_normals(points, index, 12, -5.0f * n))
+      REQUIRE(glm::dot(normal, n) == Catch::Approx(-1.0f).epsilon(1e-4));
+  }
+}
+
+TEST_CASE("estimate_normals faces away from the center without a viewpoint", "[NormalEstimation]") {
+  std::vector<glm::vec3> points;
+  for (const auto& r : random_points(4000, 12))
+    if (glm::length(r) > 0.1f)
+      points.push_back(glm::normalize(r));
+  const SpatialIndex           index(points);
+  const std::vector<glm::vec3> normals = estimate_normals(points, index, 16);
+  for (size_t i = 0; i < points.size(); i++)
+    REQUIRE(glm::dot(normals[i], points[i]) > 0.95f);
+}
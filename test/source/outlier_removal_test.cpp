@@ -0,0 +1,43 @@
+#include "OutlierRemoval.h"
+#include "test_data.h"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+
+/** a dense random cube with one point planted far from it, last */
+static std::vector<glm::vec3> cloud_with_outlier() {
+  std::vector<glm::vec3> points = random_points(1000, 5);
+  points.push_back(glm::vec3(10.0f, 10.0f, 10.0f));
+  return points;
+}
+
+TEST_CASE("statistical_outlier_mask drops a planted outlier only", "[OutlierRemoval]") {
+  const std::vector<glm::vec3> points = cloud_with_outlier();
+  const SpatialIndex           index(points);
+  const std::vector<uint8_t>   keep = statistical_outlier_mask(points, index, 8, 3.0f);
+  REQUIRE(keep.size() == points.size());
+  REQUIRE(keep.back() == 0);
+  REQUIRE(std::count(keep.begin(), keep.end(), uint8_t(0)) == 1);
+}
+
+TEST_CASE("radius_outlier_mask drops a planted outlier only", "[OutlierRemoval]") {
+  const std::vector<glm::vec3> points = cloud_with_outlier();
+  const SpatialIndex           index(points);
+  const std::vector<uint8_t>   keep = radius_outlier_mask(points, index, 0.5f, 2);
+  REQUIRE(keep.size() == points.size());
+  REQUIRE(keep.back() == 0);
+  REQUIRE(std::count(keep.begin(), keep.end(), uint8_t(0)) == 1);
+
+  // a pair of isolated points keeps each other with one neighbour required, not with two
+  std::vector<glm::vec3> pair = points;
+  pair.push_back(glm::vec3(10.1f, 10.0f, 10.0f));
+  const SpatialIndex pair_index(pair);
+  REQUIRE(radius_outlier_mask(pair, pair_index, 0.5f, 1).back() == 1);
+  REQUIRE(radius_outlier_mask(pair, pair_index, 0.5f, 2).back() == 0);
+}
+
+TEST_CASE("mean_neighbour_distance excludes the point itself", "[OutlierRemoval]") {
+  const std::vector<glm::vec3> points { { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 3.0f, 0.0f, 0.0f } };
+  const SpatialIndex           index(points);
+  const std::vector<float>     distance = mean_neighbour_distance(points, index, 1);
+  REQUIRE(distance == std::vector<float> { 1.0f, 1.0f, 2.0f });
+}
@@ -0,0 +1,152 @@
+#include "PlyReader.h"
+#include "test_data.h"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+static const char* vertex_header = "element vertex 2\n"
+                                   "property float x\n"
+                                   "property float y\n"
+                                   "property float z\n"
+                                   "property uchar red\n"
+                                   "property uchar green\n"
+                                   "property uchar blue\n"
+                                   "property ushort intensity\n"
+                                   "end_header\n";
+
+/** append `value` to `bytes` in the byte order of the format */
+template <typename T>
+static void put(std::string& bytes, T value, bool big_endian) {
+  char raw[sizeof(T)];
+  std::memcpy(raw, &value, sizeof(T));
+  if (big_endian)
+    std::reverse(raw, raw + sizeof(T));
+  bytes.append(raw, sizeof(T));
+}
+
+/** the two vertices of `vertex_header` as a binary body */
+static std::string binary_vertices(bool big_endian) {
+  std::string body;
+  const float   positions[2][3] = { { 1.0f, 2.0f, 3.0f }, { -4.0f, 5.5f, 6.0f } };
+  const uint8_t colors[2][3]    = { { 255, 0, 51 }, { 0, 255, 0 } };
+  const uint16_t intensity[2]   = { 1000, 65535 };
+  for (int i = 0; i < 2; i++) {
+    for (float v : positions[i])
+      put(body, v, big_endian);
+    for (uint8_t c : colors[i])
+      put(body, c, big_endian);
+    put(body, intensity[i], big_endian);
+  }
+  return body;
+}
+
+static void check_vertices(const PointCloud& cloud) {
+  REQUIRE(cloud.points.size() == 2);
+  REQUIRE(cloud.points[0] == glm::vec3(1.0f, 2.0f, 3.0f));
+  REQUIRE(cloud.points[1] == glm::vec3(-4.0f, 5.5f, 6.0f));
+  REQUIRE(cloud.colors.size() == 2);
+  REQUIRE(cloud.colors[0] == glm::vec3(1.0f, 0.0f, 0.2f));
+  REQUIRE(cloud.colors[1] == glm::vec3(0.0f, 1.0f, 0.0f));
+  REQUIRE(cloud.normals.empty());
+  REQUIRE(cloud.get_bbox_min() == glm::vec3(-4.0f, 2.0f, 3.0f));
+  REQUIRE(cloud.get_bbox_max() == glm::vec3(1.0f, 5.5f, 6.0f));
+
+  const PointAttribute* intensity = cloud.attributes.find("intensity");
+  REQUIRE(intensity != nullptr);
+  REQUIRE(intensity->get_type() == AttributeType::UInt16);
+  REQUIRE(intensity->values<uint16_t>()[0] == 1000);
+  REQUIRE(intensity->values<uint16_t>()[1] == 65535);
+}
+
+TEST_CASE("read_ply reads ascii and binary files of either endianness", "[PlyReader]") {
+  PointCloud cloud;
+  SECTION("ascii") {
+    const std::string path =
+      write_temp("ply_reader_test_ascii.ply", std::string("ply\nformat ascii 1.0\ncomment made by hand\n") + vertex_header + "1 2 3 255 0 51 1000\n-4 5.5 6 0 255 0 65535\n");
+    read_ply(path, cloud);
+    check_vertices(cloud);
+    std::filesystem::remove(path);
+  }
+  SECTION("binary little endian") {
+    const std::string path = write_temp("ply_reader_test_le.ply", std::string("ply\nformat binary_little_endian 1.0\n") + vertex_header + binary_vertices(false));
+    read_ply(path, cloud);
+    check_vertices(cloud);
+    std::filesystem::remove(path);
+  }
+  SECTION("binary big endian") {
+    const std::string path = write_temp("ply_reader_test_be.ply", std::string("ply\nformat binary_big_endian 1.0\n") + vertex_header + binary_vertices(true));
+    read_ply(path, cloud);
+    check_vertices(cloud);
+    std::filesystem::remove(path);
+  }
+}
+
+TEST_CASE("read_ply rejects list properties it would have to skip", "[PlyReader]") {
+  PointCloud cloud;
+  const std::string in_vertex = write_temp("ply_reader_test_list_vertex.ply", "ply\nformat ascii 1.0\n"
+                                                                               "element vertex 1\n"
+                                                                               "property float x\nproperty float y\nproperty float z\n"
+                                                                               "property list uchar int neighbours\n"
+                                                                               "end_header\n"
+                                                                               "0 0 0 1 0\n");
+  REQUIRE_THROWS_AS(read_ply(in_vertex, cloud), std::runtime_error);
+  const std::string before_vertex = write_temp("ply_reader_test_list_before.ply", "ply\nformat ascii 1.0\n"
+                                                                                  "element face 1\n"
+                                                                                  "property list uchar int vertex_indices\n"
+                                                                                  "element vertex 1\n"
+                                                                                  "property float x\nproperty float y\nproperty float z\n"
+                                                                                  "end_header\n"
+                                                                                  "3 0 0 0\n"
+                                                                                  "0 0 0\n");
+  REQUIRE_THROWS_AS(read_ply(before_vertex, cloud), std::runtime_error);
+
+  // faces after the vertices are never read, their lists do not matter
+  const std::string after_vertex = write_temp("ply_reader_test_list_after.ply", "ply\nformat ascii 1.0\n"
+                                                                                "element vertex 1\n"
+                                                                                "property float x\nproperty float y\nproperty float z\n"
+                                                                                "element face 1\n"
+                                                                                "property list uchar int vertex_indices\n"
+                                                                                "end_header\n"
+                                                                                "7 8 9\n"
+                                                                                "3 0 0 0\n");
+  read_ply(after_vertex, cloud);
+  REQUIRE(cloud.points.size() == 1);
+  REQUIRE(cloud.points[0] == glm::vec3(7.0f, 8.0f, 9.0f));
+
+  for (const auto& path : { in_vertex, before_vertex, after_vertex })
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("read_ply keeps partial normal and color sets as attributes", "[PlyReader]") {
+  const std::string path = write_temp("ply_reader_test_partial.ply", "ply\nformat ascii 1.0\n"
+                                                                     "element vertex 2\n"
+                                                                     "property float x\nproperty float y\nproperty float z\n"
+                                                                     "property float nx\nproperty float ny\n"
+                                                                     "property uchar red\n"
+                                                                     "end_header\n"
+                                                                     "0 0 0 0.5 -0.5 10\n"
+                                                                     "1 1 1 0.25 1 20\n");
+  PointCloud cloud;
+  read_ply(path, cloud);
+  REQUIRE(cloud.points.size() == 2);
+  REQUIRE(cloud.normals.empty());
+  REQUIRE(cloud.colors.empty());
+  REQUIRE(cloud.attributes.size() == 3);
+
+  const PointAttribute* nx  = cloud.attributes.find("nx");
+  const PointAttribute* ny  = cloud.attributes.find("ny");
+  const PointAttribute* red = cloud.attributes.find("red");
+  REQUIRE(nx != nullptr);
+  REQUIRE(ny != nullptr);
+  REQUIRE(red != nullptr);
+  REQUIRE(nx->get_type() == AttributeType::Float32);
+  REQUIRE(red->get_type() == AttributeType::UInt8);
+  REQUIRE(nx->get(1) == 0.25);
+  REQUIRE(ny->get(0) == -0.5);
+  REQUIRE(red->get(0) == 10.0); // kept as stored, not scaled like a color
+  REQUIRE(red->get(1) == 20.0);
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,56 @@
+#include "PointCloud.h"
+#include "Profiler.h"
+#include "test_data.h"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+namespace fs = std::filesystem;
+
+TEST_CASE("PointCloud bounds follow the last file loaded into it", "[PointCloud]") {
+  // the first file spans more chunks than the second, so stale chunk bounds would widen the bbox
+  std::string wide;
+  for (size_t i = 0; i < 3 * PointCloud::CHUNK_SIZE; i++)
+    wide += std::to_string(static_cast<float>(i % 100) - 50.0f) + " -50 50\n";
+  const std::string first  = write_temp("point_cloud_viewer_test_wide.xyz", wide);
+  const std::string second = write_temp("point_cloud_viewer_test_small.xyz", "1 2 3\n2 3 4\n");
+
+  PointCloud cloud;
+  cloud.load_points(first);
+  REQUIRE(cloud.get_bbox_min() == glm::vec3(-50.0f, -50.0f, 50.0f));
+  REQUIRE(cloud.get_bbox_max() == glm::vec3(49.0f, -50.0f, 50.0f));
+
+  cloud.load_points(second);
+  REQUIRE(cloud.points.size() == 2);
+  REQUIRE(cloud.get_bbox_min() == glm::vec3(1.0f, 2.0f, 3.0f));
+  REQUIRE(cloud.get_bbox_max() == glm::vec3(2.0f, 3.0f, 4.0f));
+  REQUIRE(cloud.select_chunks([](const Bounds&) { return Coverage::All; }) == std::vector<std::pair<size_t, size_t>> { { 0, 2 } });
+  REQUIRE(cloud.query_box(glm::vec3(-100.0f), glm::vec3(100.0f)).size() == 2);
+
+  fs::remove(first);
+  fs::remove(second);
+}
+
+TEST_CASE("PointCloud save_points writes what load_points reads and reports failed writes", "[PointCloud]") {
+  PointCloud cloud;
+  cloud.append_points({ { 1.0f, 2.0f, 3.0f }, { 4.0f, 5.0f, 6.0f }, { 7.0f, 8.0f, 9.0f } });
+  const std::string path = (fs::temp_directory_path() / "point_cloud_viewer_test_saved.xyz").string();
+  cloud.save_points(path, { 2, 0 });
+
+  PointCloud saved;
+  saved.load_points(path);
+  REQUIRE(saved.points == std::vector<glm::vec3> { { 7.0f, 8.0f, 9.0f }, { 1.0f, 2.0f, 3.0f } });
+  fs::remove(path);
+
+  REQUIRE_THROWS_AS(cloud.save_points((fs::temp_directory_path() / "no_such_directory" / "saved.xyz").string(), { 0 }), std::runtime_error);
+  // writes to /dev/full fail as on a full disk
+  if (fs::exists("/dev/full"))
+    REQUIRE_THROWS_AS(cloud.save_points("/dev/full", { 0, 1, 2 }), std::runtime_error);
+}
+
+TEST_CASE("write_json_string escapes quotes, backslashes and control characters", "[Profiler]") {
+  std::ostringstream out;
+  write_json_string(out, "a\"b\\c\nd\x01\x1f");
+  REQUIRE(out.str() == R"("a\"b\\c\u000ad\u0001\u001f")");
+}
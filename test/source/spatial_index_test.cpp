@@ -0,0 +1,129 @@
+#include "SpatialIndex.h"
+#include "test_data.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+static float distance2(const glm::vec3& a, const glm::vec3& b) {
+  return glm::dot(a - b, a - b);
+}
+
+/** indices of the points `keep` accepts, by scanning them all */
+static std::vector<uint32_t> brute_force(const std::vector<glm::vec3>& points, const std::function<bool(const glm::vec3&)>& keep) {
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 0; i < points.size(); i++)
+    if (keep(points[i]))
+      indices.push_back(i);
+  return indices;
+}
+
+static std::vector<uint32_t> sorted(std::vector<uint32_t> indices) {
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+static std::vector<uint32_t> flatten(const std::vector<SpatialIndex::Span>& spans) {
+  std::vector<uint32_t> indices;
+  for (const auto& span : spans)
+    indices.insert(indices.end(), span.begin(), span.end());
+  return sorted(indices);
+}
+
+TEST_CASE("SpatialIndex leaves hold at most LEAF_SIZE points", "[SpatialIndex]") {
+  const size_t L = SpatialIndex::LEAF_SIZE;
+  // one more than a power of two times the leaf size leaves one leaf with a point more than its sibling
+  for (size_t count : { size_t(0), size_t(1), L, L + 1, 2 * L + 1, 64 * L + 1 }) {
+    CAPTURE(count);
+    const SpatialIndex index(random_points(count, static_cast<uint32_t>(count)));
+    REQUIRE(index.size() == count);
+    for (uint32_t node = 0; node < index.get_nodes().size(); node++)
+      if (index.is_leaf(node))
+        REQUIRE(index.get_nodes()[node].end - index.get_nodes()[node].begin <= L);
+  }
+}
+
+TEST_CASE("SpatialIndex queries match brute force", "[SpatialIndex]") {
+  const std::vector<glm::vec3> points = random_points(2000, 1);
+  const SpatialIndex           index(points);
+  std::vector<glm::vec3>       queries = random_points(8, 2);
+  queries.push_back(points[0]);
+  queries.push_back(glm::vec3(3.0f, 0.0f, 0.0f)); // outside the cloud
+
+  for (const auto& query : queries) {
+    CAPTURE(query.x, query.y, query.z);
+
+    SECTION("knn") {
+      std::vector<SpatialIndex::Neighbour> result;
+      for (size_t k : { size_t(1), size_t(7), size_t(SpatialIndex::LEAF_SIZE + 5) }) {
+        index.knn(query, k, result);
+        std::vector<float> expected;
+        for (const auto& p : points)
+          expected.push_back(distance2(p, query));
+        std::sort(expected.begin(), expected.end());
+        expected.resize(k);
+        REQUIRE(result.size() == k);
+        for (size_t j = 0; j < k; j++) {
+          REQUIRE(result[j].distance2 == Catch::Approx(expected[j]));
+          REQUIRE(distance2(points[result[j].index], query) == Catch::Approx(result[j].distance2));
+        }
+      }
+    }
+
+    SECTION("radius") {
+      std::vector<SpatialIndex::Neighbour> result;
+      index.radius_search(query, 0.3f, result);
+      std::vector<uint32_t> found;
+      for (const auto& neighbour : result)
+        found.push_back(neighbour.index);
+      REQUIRE(sorted(found) == brute_force(points, [&](const glm::vec3& p) { return distance2(p, query) <= 0.3f * 0.3f; }));
+      REQUIRE(index.count_within(query, 0.3f) == result.size());
+      REQUIRE(index.count_within(query, 0.3f, 2) == std::min<size_t>(result.size(), 2));
+    }
+
+    SECTION("sphere spans") {
+      std::vector<SpatialIndex::Span> spans;
+      for (float radius : { 0.1f, 0.5f, 4.0f }) {
+        index.sphere_search(query, radius, spans);
+        REQUIRE(flatten(spans) == brute_force(points, [&](const glm::vec3& p) { return distance2(p, query) <= radius * radius; }));
+      }
+    }
+
+    SECTION("box spans") {
+      std::vector<SpatialIndex::Span> spans;
+      for (float half : { 0.1f, 0.5f, 4.0f }) {
+        const glm::vec3 min = query - half, max = query + half;
+        index.box_search(min, max, spans);
+        REQUIRE(flatten(spans) == brute_force(points, [&](const glm::vec3& p) {
+                  return p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x && p.y <= max.y && p.z <= max.z;
+                }));
+      }
+    }
+  }
+}
+
+TEST_CASE("SpatialIndex ray search matches brute force and sorts along the ray", "[SpatialIndex]") {
+  const std::vector<glm::vec3> points = random_points(2000, 3);
+  const SpatialIndex           index(points);
+  const glm::vec3              origin(-2.0f, 0.1f, -0.2f);
+  const glm::vec3              direction(2.0f, 0.2f, 0.3f); // not unit length
+  const glm::vec3              d = glm::normalize(direction);
+
+  std::vector<SpatialIndex::RayHit> hits;
+  for (float max_distance : { 1.5f, 100.0f }) {
+    CAPTURE(max_distance);
+    index.ray_search(origin, direction, 0.15f, max_distance, hits);
+    std::vector<uint32_t> found;
+    for (size_t j = 0; j < hits.size(); j++) {
+      found.push_back(hits[j].index);
+      if (j > 0)
+        REQUIRE(hits[j - 1].t <= hits[j].t);
+    }
+    REQUIRE(!found.empty());
+    REQUIRE(sorted(found) == brute_force(points, [&](const glm::vec3& p) {
+              const float t = std::clamp(glm::dot(p - origin, d), 0.0f, max_distance);
+              return distance2(p, origin + t * d) <= 0.15f * 0.15f;
+            }));
+  }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+/** `count` points uniform in the cube [-1, 1]^3, the same for the same `seed` */
+inline std::vector<glm::vec3> random_points(size_t count, uint32_t seed) {
+  std::mt19937                          random(seed);
+  std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+  std::vector<glm::vec3>                points(count);
+  for (auto& p : points)
+    p = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+  return points;
+}
+
+/** write `bytes` to a file called `name` in the temp directory and return its path */
+inline std::string write_temp(const std::string& name, const std::string& bytes) {
+  const std::string path = (std::filesystem::temp_directory_path() / name).string();
+  std::ofstream(path, std::ios::binary) << bytes;
+  return path;
+}
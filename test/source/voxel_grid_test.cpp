@@ -0,0 +1,57 @@
+#include "VoxelGrid.h"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+
+/** index of the output point in the voxel of `near`, the output order is not specified */
+static size_t voxel_of(const PointCloud& cloud, const glm::vec3& near) {
+  for (size_t i = 0; i < cloud.points.size(); i++)
+    if (glm::length(cloud.points[i] - near) < 0.5f)
+      return i;
+  FAIL("no output point near the voxel");
+  return 0;
+}
+
+TEST_CASE("voxel_grid_filter keeps the centroid or the point closest to it", "[VoxelGrid]") {
+  // three points in the voxel at the bbox minimum, one in the voxel diagonally above it
+  PointCloud cloud;
+  cloud.append_points({ { 0.1f, 0.1f, 0.1f }, { 0.5f, 0.1f, 0.1f }, { 0.25f, 0.3f, 0.1f }, { 1.5f, 1.5f, 1.5f } });
+  cloud.colors = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.5f, 0.5f } };
+  PointAttribute& classification = cloud.attributes.add("classification", AttributeType::UInt8, 1, 4);
+  for (size_t i = 0; i < 4; i++)
+    classification.set(i, 0, static_cast<double>(i + 1));
+  const glm::vec3 centroid(0.85f / 3.0f, 0.5f / 3.0f, 0.1f);
+
+  SECTION("centroid") {
+    const PointCloud filtered = voxel_grid_filter(cloud, 1.0f, VoxelReduction::Centroid);
+    REQUIRE(filtered.points.size() == 2);
+    const size_t a = voxel_of(filtered, centroid);
+    REQUIRE(filtered.points[a].x == Catch::Approx(centroid.x));
+    REQUIRE(filtered.points[a].y == Catch::Approx(centroid.y));
+    REQUIRE(filtered.points[a].z == Catch::Approx(centroid.z));
+    REQUIRE(filtered.colors[a].x == Catch::Approx(1.0f / 3.0f));
+    REQUIRE(filtered.colors[a].z == Catch::Approx(1.0f / 3.0f));
+    REQUIRE(filtered.attributes.find("classification")->get(a) == 1.0); // of the first point, not averaged
+
+    const size_t b = voxel_of(filtered, glm::vec3(1.5f));
+    REQUIRE(filtered.points[b] == glm::vec3(1.5f));
+    REQUIRE(filtered.attributes.find("classification")->get(b) == 4.0);
+    REQUIRE(filtered.get_bbox_max() == glm::vec3(1.5f));
+  }
+
+  SECTION("representative") {
+    const PointCloud filtered = voxel_grid_filter(cloud, 1.0f, VoxelReduction::Representative);
+    REQUIRE(filtered.points.size() == 2);
+    const size_t a = voxel_of(filtered, centroid);
+    REQUIRE(filtered.points[a] == glm::vec3(0.25f, 0.3f, 0.1f)); // an input point, the closest to the centroid
+    REQUIRE(filtered.attributes.find("classification")->get(a) == 3.0);
+    REQUIRE(filtered.points[voxel_of(filtered, glm::vec3(1.5f))] == glm::vec3(1.5f));
+  }
+}
+
+TEST_CASE("voxel_grid_filter rejects leaf sizes that are not positive", "[VoxelGrid]") {
+  PointCloud cloud;
+  cloud.append_points({ { 0.0f, 0.0f, 0.0f } });
+  REQUIRE_THROWS_AS(voxel_grid_filter(cloud, 0.0f), std::runtime_error);
+  REQUIRE_THROWS_AS(voxel_grid_filter(cloud, -1.0f), std::runtime_error);
+}